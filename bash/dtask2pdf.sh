@@ -2,7 +2,8 @@
 tex=${1%.*}.tex
 pdf=${1%.*}.pdf
 new=${2:-${pdf}}
-dot2tex -tmath -p --autosize $1 > $tex
+# Tasks are written without a layout, lay them out for drawing
+dot -Tdot $1 | dot2tex -tmath -p --autosize > $tex
 latexmk -pdf $tex
 latexmk -c $tex
 rm $tex
@@ -174,7 +174,7 @@ summary(dtask_t *task) {
 
 	sprintf(buff, "%-19s %6d %6ld %6ld %6ld %6ld %6.2f %35s %6s",
 		task->dt_name,
-		agnnodes(task->dt_graph),
+		dtask_nnodes(task),
 		dtask_workload(task),
 		dtask_cpathlen(task),
 		task->dt_period,
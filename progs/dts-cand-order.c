@@ -22,11 +22,15 @@ static struct {
 	int c_arb;	/**< arbitrary heuristic */
 	int c_maxb;	/**< max benefit */
 	int c_minp;	/**< min penalty */
+	int c_jobs;	/**< worker threads scoring the candidates */
+	int c_top;	/**< only the best c_top candidates, 0 for all */
 } clc;
 
-static const char* short_options = "hl:o:vt:abp";
+static const char* short_options = "hj:k:l:o:vt:abp";
 static struct option long_options[] = {
     {"help",		no_argument, 		0, 'h'},
+    {"jobs",		required_argument,	0, 'j'},
+    {"top",		required_argument,	0, 'k'},
     {"log", 		required_argument, 	0, 'l'},
     {"output", 		required_argument, 	0, 'o'},
     {"verbose", 	no_argument, 		&clc.c_verbose, 1},
@@ -42,6 +46,8 @@ static const char *usagec[] = {
 "Usage: dts-cand-order -t <TASK FILE> [OPTIONS]",
 "OPTIONS:",
 "	-h/-help		This message",
+"	-j/--jobs <N>		Score the candidates on N threads (default 1)",
+"	-k/--top <K>		Only the K best candidates",
 "	-l/-log <FILE>		Auditible log file",
 "	-o/--output <FILE>	Output file",
 "	-v/--verbose		Verbose output",
@@ -54,10 +60,13 @@ static const char *usagec[] = {
 "",
 "OPERATION:",
 "	dts-collapse produces the list of candidates per object",
+"	The order does not depend on the number of jobs.",
 "",
 "EXAMPLES:",
 "	# Order candidates of dtask.dot by max benefit",
 "	> dts-cand-order -t dtask.dot -o dtask.cands -b",
+"	# Same on 4 threads",
+"	> dts-cand-order -t dtask.dot -o dtask.cands -b -j 4",
 };
 
 void
@@ -72,6 +81,7 @@ main(int argc, char** argv) {
 	FILE *ofile = stdout;
 	gsl_rng *r = NULL;
 	dtask_t *task = NULL;
+	ctab_t *ct = NULL;
 	int rv = -1; /* Assume failure */
 
 	/*
@@ -97,6 +107,24 @@ main(int argc, char** argv) {
 		case 'h':
 			usage();
 			goto bail;
+		case 'j':
+			clc.c_jobs = atoi(optarg);
+			if (clc.c_jobs < 1) {
+				fprintf(stderr, "Invalid number of jobs %s\n",
+				    optarg);
+				usage();
+				goto bail;
+			}
+			break;
+		case 'k':
+			clc.c_top = atoi(optarg);
+			if (clc.c_top < 1) {
+				fprintf(stderr, "Invalid number of candidates %s\n",
+				    optarg);
+				usage();
+				goto bail;
+			}
+			break;
 		case 'l':
 			/* Needs to be implemented */
 			printf("Log file not implemented\n");
@@ -154,26 +182,27 @@ main(int argc, char** argv) {
 		goto bail;
 	}
 
-	cand_list_t *cand_list;
-	if (clc.c_arb) {
-		cand_list = corder_arb(task);
-	}
+	enum corder order = CORDER_ARB;
+	int deltas = 0;
 	if (clc.c_maxb) {
-		cand_list = corder_maxb(task);
+		order = CORDER_MAXB;
+		deltas = CTAB_DELTA_C;
 	}
 	if (clc.c_minp) {
-		cand_list = corder_minp(task);
+		order = CORDER_MINP;
+		deltas = CTAB_DELTA_L;
 	}
-	cand_t *cand = NULL;
-	for(cand = cand_first(cand_list); cand; cand = cand_next(cand)) {
-		fprintf(ofile, "%s %s\n", cand->c_a->dn_name,
-			cand->c_b->dn_name);
+	ct = ctab_build(task, deltas, clc.c_jobs);
+	if (!ct || !(clc.c_top ? ctab_top(ct, order, clc.c_top) :
+	    ctab_sort(ct, order))) {
+		fprintf(stderr, "Unable to order the candidates\n");
+		goto bail;
 	}
+	ctab_write(ct, ofile);
 
-	cand_list_destroy(cand_list);
-	
 	rv = 0;
 bail:
+	ctab_free(ct);
 	if (task) {
 		dtask_free(task);
 	}
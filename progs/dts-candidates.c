@@ -150,7 +150,7 @@ main(int argc, char** argv) {
 	}
 
 	if (clc.c_count) {
-		fprintf(ofile, "Total Candidates: %d\n",
+		fprintf(ofile, "Total Candidates: %lu\n",
 			dtask_count_cand(task));
 	}
 	
@@ -20,10 +20,12 @@ static struct {
 	char* c_tname;
 	char* c_list_name;
 	int c_ignore; /** ignore beneficial test */
+	int c_greedy; /** collapse greedily instead of from a list */
 } clc;
 
-static const char* short_options = "hl:o:vt:L:I";
+static const char* short_options = "ghl:o:vt:L:I";
 static struct option long_options[] = {
+    {"greedy",		no_argument,		0, 'g'},
     {"help",		no_argument, 		0, 'h'},
     {"log", 		required_argument, 	0, 'l'},
     {"output", 		required_argument, 	0, 'o'},
@@ -36,21 +38,26 @@ static const char *usagec[] = {
 "dts-collapse-list: DAG Task Collapsing of a Candidate List"
 "Usage: dts-collapse-list -L <LIST FILE> <TASK FILE> [OPTIONS]",
 "OPTIONS:",
+"	-g/--greedy		Collapse greedily, without a list",
 "	-h/-help		This message",
 "	-l/-log <FILE>		Auditible log file",
 "	-o/--output <FILE>	Output file",
 "	-v/--verbose		Verbose output",
 "	-I/--ignore		Ignore \"beneficial\" test",
-"REQUIRED:",
+"REQUIRED, UNLESS --greedy:",
 "	-L/--list <FILE>	Collapse list, from dts-cand-order",
 "",
 "OPERATION:",
 "	dts-collapse-list collapses nodes as a list given by",
 "	dts-cand-order.",
+"	With --greedy, the candidate that decreases the cores the most",
+"	is collapsed until none does, see dag_collapse_all().",
 "",
 "EXAMPLES:"
 "	# Collapse from cand.list in dtask.dot",
 "	> dts-collapse-list -L cand.list dtask.dot",
+"	# Collapse dtask.dot greedily",
+"	> dts-collapse-list -g -v dtask.dot",
 };
 
 void
@@ -94,6 +101,9 @@ main(int argc, char** argv) {
 		switch(c) {
 		case 0:
 			break;
+		case 'g':
+			clc.c_greedy = 1;
+			break;
 		case 'h':
 			usage();
 			goto bail;
@@ -127,16 +137,18 @@ main(int argc, char** argv) {
 	}
 	clc.c_tname = strdup(argv[optind]);
 
-	if (!clc.c_list_name) {
+	if (!clc.c_greedy && !clc.c_list_name) {
 		fprintf(stderr, "--list-file is a required option\n");
 		usage();
 		goto bail;
 	}
-	lfile = fopen(clc.c_list_name, "r");
-	if (!lfile) {
-		fprintf(stderr, "Unable to open %s for reading\n",
-			clc.c_list_name);
-		goto bail;
+	if (!clc.c_greedy) {
+		lfile = fopen(clc.c_list_name, "r");
+		if (!lfile) {
+			fprintf(stderr, "Unable to open %s for reading\n",
+				clc.c_list_name);
+			goto bail;
+		}
 	}
 	if (clc.c_oname) {
 		ofile = fopen(clc.c_oname, "w");
@@ -155,6 +167,19 @@ main(int argc, char** argv) {
 		goto bail;
 	}
 
+	if (clc.c_greedy) {
+		dcollapse_stat_t stat;
+		if (dag_collapse_all(task, &stat) < 0) {
+			fprintf(stderr, "Unable to allocate memory\n");
+			goto bail;
+		}
+		vprintf("%d collapses, %d scored, L %ld, C %ld, m %f\n",
+			stat.dcs_collapses, stat.dcs_scored,
+			(long) stat.dcs_cpathlen, (long) stat.dcs_workload,
+			stat.dcs_cores);
+		goto write_task;
+	}
+
 	char a_name[DT_NAMELEN], b_name[DT_NAMELEN];
 	while (fscanf(lfile, "%s %s\n", a_name, b_name) != EOF) {
 		dnode_t *a = dtask_name_match(task, a_name);
@@ -179,49 +204,46 @@ main(int argc, char** argv) {
 			dnode_free(b);
 			continue;
 		}
-		dtask_t *copy = dtask_copy(task);
-		dnode_t *ca = dtask_name_match(copy, a_name);
-		dnode_t *cb = dtask_name_match(copy, b_name);
+		/* The collapse is tried in place, and undone unless kept */
+		float_t pre_m = dtask_coresf(task);
+		if (!dtask_begin(task)) {
+			fprintf(stderr, "Unable to allocate memory\n");
+			goto bail;
+		}
 		int beneficial = 1;
-		if (!dag_collapse(ca, cb)) {
+		if (!dag_collapse(a, b)) {
 			fprintf(stderr, "Collapse of %s and %s failed\n",
-				ca->dn_name, cb->dn_name);
+				a->dn_name, b->dn_name);
 			goto bail;
 		}
-		float_t pre_m = dtask_coresf(task);
-		float_t post_m = dtask_coresf(copy);
+		float_t post_m = dtask_coresf(task);
 		if (pre_m < post_m) {
 			vprintf("Collapse of %s and %s is not "
 				"beneficial: m increases\n",
-				ca->dn_name, cb->dn_name);
+				a->dn_name, b->dn_name);
 			beneficial = 0;
 		}
-		tint_t post_l = dtask_cpathlen(copy);
+		tint_t post_l = dtask_cpathlen(task);
 		if (post_l > task->dt_deadline) {
 			vprintf("Collapse of %s and %s is not "
 				"beneficial: L > D\n",
-				ca->dn_name, cb->dn_name);
+				a->dn_name, b->dn_name);
 			beneficial = 0;
 		}
-		dnode_free(ca);
-		dnode_free(cb);
-		dtask_free(copy);
 
-		if (!beneficial && !clc.c_ignore) {
-			goto next_iter;
-		}
-		
-		if (!dag_collapse(a, b)) {
-			fprintf(stderr, "Collapse of %s and %s failed\n",
-				a->dn_name, b->dn_name);
+		if (beneficial || clc.c_ignore) {
+			dtask_commit(task);
+			task->dt_collapsed++;
+		} else if (!dtask_rollback(task)) {
+			fprintf(stderr, "Unable to undo the collapse of %s and "
+				"%s\n", a->dn_name, b->dn_name);
 			goto bail;
 		}
-		task->dt_collapsed++;
-	next_iter:
 		dtask_update(task);
 		dnode_free(a); a = NULL;
 		dnode_free(b); b = NULL;
 	}
+write_task:
 	dtask_update(task);
 	dtask_write(task, ofile);
 	
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "dag-task.h"
+
+/**
+ * global command line configuration
+ */
+static struct {
+	int c_verbose;
+	int c_dot;
+	char* c_oname;
+	char* c_tname;
+} clc;
+
+static const char* short_options = "bdho:v";
+static struct option long_options[] = {
+    {"binary",		no_argument, 		&clc.c_dot, 0},
+    {"dot",		no_argument, 		&clc.c_dot, 1},
+    {"help",		no_argument, 		0, 'h'},
+    {"output", 		required_argument, 	0, 'o'},
+    {"verbose", 	no_argument, 		&clc.c_verbose, 1},
+    {0, 0, 0, 0}
+};
+
+static const char *usagec[] = {
+"dts-convert: converts a DAG task between the dot and binary formats",
+"Usage: dts-convert <TASK FILE> [OPTIONS]",
+"OPTIONS:",
+"	-b/--binary		Write the binary format (default)",
+"	-d/--dot		Write the dot format",
+"	-h/--help		This message",
+"	-o/--output <FILE>	Output file",
+"	-v/--verbose		Verbose output",
+"",
+"OPERATION:",
+"	dts-convert reads a task in either format and writes it in the",
+"	requested one. Binary tasks are mapped by the tools instead of",
+"	being parsed, and can be referenced from .dts files like dot ones.",
+"",
+"EXAMPLES:",
+"	# Convert task_3.dot to binary",
+"	> dts-convert -o task_3.dtb task_3.dot",
+"	# And back",
+"	> dts-convert -d -o task_3.dot task_3.dtb",
+};
+
+void
+usage() {
+	for (int i = 0; i < sizeof(usagec) / sizeof(usagec[0]); i++) {
+		printf("%s\n", usagec[i]);
+	}
+}
+
+int
+main(int argc, char** argv) {
+	FILE *ofile = stdout;
+	dtask_t *task = NULL;
+	int rv = -1; /* Assume failure */
+
+	/* Parse those arguments! */
+	while(1) {
+		int opt_idx = 0;
+		int c = getopt_long(argc, argv, short_options,
+		    long_options, &opt_idx);
+		if (c == -1) {
+			break;
+		}
+
+		switch(c) {
+		case 0:
+			break;
+		case 'b':
+			clc.c_dot = 0;
+			break;
+		case 'd':
+			clc.c_dot = 1;
+			break;
+		case 'h':
+			usage();
+			goto bail;
+		case 'o':
+			clc.c_oname = strdup(optarg);
+			break;
+		case 'v':
+			clc.c_verbose = 1;
+			break;
+		default:
+			printf("Unknown option %c\n", c);
+			usage();
+			goto bail;
+		}
+	}
+
+	if (optind < argc) {
+		clc.c_tname = strdup(argv[optind]);
+	}
+	if (!clc.c_tname) {
+		fprintf(stderr, "DAG task file required\n");
+		goto bail;
+	}
+
+	task = dtask_read_path(clc.c_tname);
+	if (!task) {
+		fprintf(stderr, "Unable to read file %s\n", clc.c_tname);
+		goto bail;
+	}
+	if (clc.c_oname) {
+		ofile = fopen(clc.c_oname, "w");
+		if (!ofile) {
+			fprintf(stderr, "Unable to open %s for writing\n",
+			    clc.c_oname);
+			ofile = stdout;
+			goto bail;
+		}
+	}
+
+	if (clc.c_verbose) {
+		fprintf(stderr, "%s: %d nodes, writing %s\n", task->dt_name,
+		    dtask_nnodes(task), clc.c_dot ? "dot" : "binary");
+	}
+	if (!(clc.c_dot ? dtask_write(task, ofile) :
+	    dtask_write_bin(task, ofile))) {
+		fprintf(stderr, "Unable to write %s\n",
+		    clc.c_oname ? clc.c_oname : "the task");
+		goto bail;
+	}
+
+	rv = 0;
+bail:
+	if (task) {
+		dtask_free(task);
+	}
+	if (clc.c_oname) {
+		free(clc.c_oname);
+	}
+	if (clc.c_tname) {
+		free(clc.c_tname);
+	}
+	if (ofile != stdout) {
+		fclose(ofile);
+	}
+	return rv;
+}
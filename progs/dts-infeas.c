@@ -168,7 +168,7 @@ summary(dtask_elem_t *e) {
 
 	sprintf(buff, "%-31s %-19s %6d %6ld %6ld %6ld %6ld %6.2f %6ld %6s",
 		e->dts_path, e->dts_task->dt_name,
-		agnnodes(e->dts_task->dt_graph),
+		dtask_nnodes(e->dts_task),
 		dtask_workload(e->dts_task),
 		dtask_cpathlen(e->dts_task),
 		e->dts_task->dt_period,
@@ -7,7 +7,8 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <time.h>
-#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 
 #include "dag-collapse.h"
@@ -25,19 +26,22 @@ static struct {
 	int c_verbose;
 	char* c_lname;
 	char* c_oname;
-	char* c_sname;
+	char* c_fname;
 	int c_m;
 	int c_nonp;
 	int c_p;
 	int c_best_fit;
 	int c_worst_fit;
 	int c_timeout;
+	int c_jobs;
 } clc;
 
 
-static const char* short_options = "hl:o:vm:pPewt:";
+static const char* short_options = "f:hj:l:o:vm:pPewt:";
 static struct option long_options[] = {
+    {"files",		required_argument,	0, 'f'},
     {"help",		no_argument, 		0, 'h'},
+    {"jobs",		required_argument,	0, 'j'},
     {"log", 		required_argument, 	0, 'l'},
     {"output", 		required_argument, 	0, 'o'},
     {"verbose", 	no_argument, 		&clc.c_verbose, 1},
@@ -52,13 +56,15 @@ static struct option long_options[] = {
 
 static const char *usagec[] = {
 "dts-sched: Determines if a DAG task is schedulable",
-"Usage: dts-sched <TASK SET FILE> [OPTIONS]",
+"Usage: dts-sched <TASK SET FILE> [TASK SET FILE ...] [OPTIONS]",
 "OPTIONS:",
+"	-f/--files <FILE>	File listing task set files, - for stdin",
 "	-h/-help		This message",
 "	-l/-log <FILE>		Auditible log file",
 "	-o/--output <FILE>	Output file",
 "	-v/--verbose		Verbose output",
 "	-t/--timeout <MINUTES>	Execution time cap (default:unset)",
+"	-j/--jobs <INT>		Threads to test with (default:1)",
 "",
 "REQUIRED OPTIONS:",
 "	-m/--cores <INT>	Number of cores",
@@ -81,17 +87,86 @@ static const char *usagec[] = {
 "	unschedulable if the schedulability test taks MIN or more minutes",
 "	to complete.",
 "",
+"	With -j <INT> the per-core tests run on that many threads. The",
+"	first core found unschedulable stops the others. The timeout",
+"	counts the CPU time of all of the threads.",
+"",
+"BATCH MODE:",
+"	Given more than one task set file, or a -f list of them (one per",
+"	line, # comments), dts-sched evaluates the sets concurrently on",
+"	-j threads, one set per thread, with the same cores, scheduling",
+"	and partitioning options. The header is written once, followed by",
+"	one summary row per set in input order. The timeout is per set",
+"	and counts the CPU time of the thread testing it, a row that ran",
+"	out of time ends in -- TIMEOUT!. A set that cannot be read is",
+"	reported in a # comment row.",
+"",
 "EXAMPLES:"
 "	# Determine if 4dtasks.dts is schedulable on 16 cores"
 "	> dts-sched -m 16 4dtsk.dts",
+"	# Every .dts file of a sweep, 8 at a time",
+"	> find sweep -name '*.dts' | dts-sched -m 16 -j 8 -f -",
+};
+
+/** Size of the error message of a set */
+#define SJ_MSGLEN 512
+
+/**
+ * A task set to be evaluated, and its outcome
+ */
+typedef struct {
+	char *sj_name;		/**< Task set file */
+	int sj_done;		/**< Evaluated, may be printed */
+	int sj_error;		/**< Not evaluated, see sj_msg */
+	char sj_msg[SJ_MSGLEN];
+	int sj_ntasks;
+	int sj_infeas;
+	int sj_sched;
+	int sj_m_high;
+	int sj_m_low;
+	float_t sj_util;
+	int sj_timeout;		/**< The tests were cancelled by -t */
+	atomic_int sj_cancel;	/**< Ends the tests of the set, dlm_watch() */
+} sched_job_t;
+
+/**
+ * A thread of the batch, as seen by the timeout
+ */
+typedef struct {
+	sched_job_t *sw_job;	/**< Set under test, NULL otherwise */
+	clockid_t sw_clock;	/**< CPU clock the timeout counts */
+	struct timespec sw_start;
+} sched_worker_t;
+
+/**
+ * The batch of task sets, shared between the threads
+ */
+static struct {
+	sched_job_t *b_jobs;
+	int b_njobs;
+	int b_next;		/**< Next set to evaluate */
+	int b_printed;		/**< Sets written, in input order */
+	int b_done;		/**< Every set is evaluated */
+	int b_batch;		/**< One row per set instead of the report */
+	int b_rv;
+	sched_worker_t *b_workers;
+	FILE *b_ofile;
+	pthread_mutex_t b_lock;
+	pthread_cond_t b_cond;	/**< Signaled when b_done is set */
+} batch = {
+	.b_lock = PTHREAD_MUTEX_INITIALIZER,
+	.b_cond = PTHREAD_COND_INITIALIZER
 };
 
 static char* header();
 static char* summary(int ntasks, int infeas, int sched, int m_high,
     int m_low, float_t util);
-static int low_sched(int m_low, dtask_set_t* low);
-static void set_timeout(int minutes, int ntasks, int mhigh, int mlow,
-			float util, FILE *ofile);
+static int low_sched(int m_low, dtask_set_t* low, int jobs,
+    atomic_int *cancel);
+static int add_job(char *name);
+static int add_jobs(const char *fname);
+static void *sched_worker(void *arg);
+static void *sched_timeout(void *arg);
 
 void
 usage() {
@@ -104,15 +179,13 @@ int
 main(int argc, char** argv) {
 	clc.c_nonp = 1;
 	clc.c_best_fit = 1;
+	clc.c_jobs = 1;
 
 	FILE *ofile = stdout;
-	config_t cfg;
-	dtask_set_t *dts = NULL;
+	pthread_t *threads = NULL, watchdog;
+	int nthreads = 0, started = 0, watching = 0;
 	int rv = -1; /* Assume failure */
 
-	/* Initilialize the config object */
-	config_init(&cfg);
-
 	/* Parse those arguments! */
 	while(1) {
 		int opt_idx = 0;
@@ -125,9 +198,15 @@ main(int argc, char** argv) {
 		switch(c) {
 		case 0:
 			break;
+		case 'f':
+			clc.c_fname = strdup(optarg);
+			break;
 		case 'h':
 			usage();
 			goto bail;
+		case 'j':
+			clc.c_jobs = atoi(optarg);
+			break;
 		case 'l':
 			/* Needs to be implemented */
 			printf("Log file not implemented\n");
@@ -136,9 +215,6 @@ main(int argc, char** argv) {
 		case 'o':
 			clc.c_oname = strdup(optarg);
 			break;
-		case 's':
-			clc.c_sname = strdup(optarg);
-			break;
 		case 'v':
 			clc.c_verbose = 1;
 			break;
@@ -167,21 +243,30 @@ main(int argc, char** argv) {
 		}
 	}
 
-	if (optind < argc) {
-		clc.c_sname = strdup(argv[optind]);
+	for (; optind < argc; optind++) {
+		if (!add_job(argv[optind])) {
+			fprintf(stderr, "Unable to allocate the task sets\n");
+			goto bail;
+		}
 	}
-	if (!clc.c_sname) {
+	if (clc.c_fname && !add_jobs(clc.c_fname)) {
+		goto bail;
+	}
+	if (batch.b_njobs == 0) {
 		fprintf(stderr, "DAG task set file required\n");
 		goto bail;
 	}
-	char *dir = strdup(clc.c_sname);
-	dir = dirname(dir);
+	batch.b_batch = batch.b_njobs > 1 || clc.c_fname;
 
 	if (clc.c_m <= 0) {
 		fprintf(stderr, "Number of --cores requird\n");
 		goto bail;
 	}
-	
+	if (clc.c_jobs <= 0) {
+		fprintf(stderr, "Number of --jobs must be positive\n");
+		goto bail;
+	}
+
 	if (clc.c_oname) {
 		ofile = fopen(clc.c_oname, "w");
 		if (!ofile) {
@@ -191,41 +276,178 @@ main(int argc, char** argv) {
 			goto bail;
 		}
 	}
+	batch.b_ofile = ofile;
+	if (batch.b_batch) {
+		fprintf(ofile, "%s\n", header());
+	}
 
-	if (CONFIG_TRUE != config_read_file(&cfg, clc.c_sname)) {
-		printf("Unable to read configuration file: %s\n",
-		       clc.c_sname);
-		printf("%s:%i %s\n", config_error_file(&cfg),
-		       config_error_line(&cfg),
-		       config_error_text(&cfg));
+	/* A lone set has the threads for its cores, a batch for its sets */
+	nthreads = clc.c_jobs < batch.b_njobs ? clc.c_jobs : batch.b_njobs;
+	threads = calloc(nthreads, sizeof(pthread_t));
+	batch.b_workers = calloc(nthreads, sizeof(sched_worker_t));
+	if (!threads || !batch.b_workers) {
+		fprintf(stderr, "Unable to allocate the workers\n");
 		goto bail;
 	}
+	if (clc.c_timeout > 0) {
+		if (pthread_create(&watchdog, NULL, sched_timeout, NULL)) {
+			fprintf(stderr, "Unable to start the timeout\n");
+			goto bail;
+		}
+		watching = 1;
+	}
+	/* Fewer threads than asked for only makes it slower */
+	for (started = 1; started < nthreads; started++) {
+		if (pthread_create(&threads[started], NULL, sched_worker,
+		    &batch.b_workers[started])) {
+			break;
+		}
+	}
+	sched_worker(&batch.b_workers[0]);
+	for (int i = 1; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
 
+	rv = batch.b_rv;
+bail:
+	if (watching) {
+		pthread_mutex_lock(&batch.b_lock);
+		batch.b_done = 1;
+		pthread_cond_signal(&batch.b_cond);
+		pthread_mutex_unlock(&batch.b_lock);
+		pthread_join(watchdog, NULL);
+	}
+	for (int i = 0; i < batch.b_njobs; i++) {
+		free(batch.b_jobs[i].sj_name);
+	}
+	free(batch.b_jobs);
+	free(batch.b_workers);
+	free(threads);
+	if (clc.c_oname) {
+		free(clc.c_oname);
+	}
+	if (clc.c_fname) {
+		free(clc.c_fname);
+	}
+	if (ofile != stdout) {
+		fclose(ofile);
+	}
+	return rv;
+}
+
+/**
+ * Appends a task set file to the batch
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+static int
+add_job(char *name) {
+	if (batch.b_njobs % 64 == 0) {
+		sched_job_t *jobs = realloc(batch.b_jobs,
+		    (batch.b_njobs + 64) * sizeof(sched_job_t));
+		if (!jobs) {
+			return 0;
+		}
+		batch.b_jobs = jobs;
+	}
+	sched_job_t *job = &batch.b_jobs[batch.b_njobs];
+	memset(job, 0, sizeof(sched_job_t));
+	job->sj_name = strdup(name);
+	if (!job->sj_name) {
+		return 0;
+	}
+	batch.b_njobs++;
+	return 1;
+}
+
+/**
+ * Appends the task set files listed in fname, - is stdin
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+static int
+add_jobs(const char *fname) {
+	FILE *list = stdin;
+	char *line = NULL;
+	size_t len = 0;
+	int rv = 0;
+
+	if (strcmp(fname, "-")) {
+		list = fopen(fname, "r");
+		if (!list) {
+			fprintf(stderr, "Unable to open %s for reading\n", fname);
+			return 0;
+		}
+	}
+	while (getline(&line, &len, list) != -1) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+		if (!add_job(line)) {
+			fprintf(stderr, "Unable to allocate the task sets\n");
+			goto bail;
+		}
+	}
+	rv = 1;
+bail:
+	free(line);
+	if (list != stdin) {
+		fclose(list);
+	}
+	return rv;
+}
+
+/**
+ * Evaluates a task set, the outcome is left in the job
+ *
+ * @param[in|out] job the set
+ * @param[in] jobs the threads the cores may be tested with
+ * @param[in|out] w the thread, its clock is watched by the timeout
+ */
+static void
+sched_set(sched_job_t *job, int jobs, sched_worker_t *w) {
+	config_t cfg;
+	dtask_set_t *dts = NULL, *low = NULL;
+	char *dir = NULL;
+
+	job->sj_error = 1; /* Assume failure */
+
+	/* Initilialize the config object */
+	config_init(&cfg);
 
+	if (CONFIG_TRUE != config_read_file(&cfg, job->sj_name)) {
+		snprintf(job->sj_msg, SJ_MSGLEN,
+		    "Unable to read configuration file: %s\n%s:%i %s\n",
+		    job->sj_name, config_error_file(&cfg),
+		    config_error_line(&cfg), config_error_text(&cfg));
+		goto bail;
+	}
+
+	dir = strdup(job->sj_name);
 	dts = dts_alloc();
-	int succ = dts_config_process(&cfg, dir, dts);
+	int succ = dir && dts && dts_config_process(&cfg, dirname(dir), dts);
 	if (!succ) {
-		printf("Unable to process configuration file: %s\n",
-		       clc.c_sname);
+		snprintf(job->sj_msg, SJ_MSGLEN,
+		    "Unable to process configuration file: %s\n", job->sj_name);
 		goto bail;
 	}
 
 	if (!dts_implicit(dts)) {
-		printf("Taskset must include only implicit deadline tasks\n");
+		snprintf(job->sj_msg, SJ_MSGLEN,
+		    "Taskset must include only implicit deadline tasks\n");
 		goto bail;
 	}
 
 	int m_high = 0, m_low = 0, sched = 0, infeas = 0, ntasks=0;
 	float_t util = 0;
 	dtask_elem_t *cursor;
-	dtask_set_t *low = dts_alloc();
+	low = dts_alloc();
 
 	util = dts_util(dts);
 	dts_foreach(dts, cursor) {
 		dtask_t *task = cursor->dts_task;
-		/* Remove the task from the original task set */
-		dtask_elem_t *elem = dtse_alloc(task);
-		
+
 		int cores;
 		ntasks++;
 		if (dtask_infeasible(task)) {
@@ -237,57 +459,179 @@ main(int argc, char** argv) {
 		if (task_util > 1) {
 			m_high += cores;
 		} else {
+			/* low shares the task, dts still frees it */
+			dtask_elem_t *elem = dtse_alloc(task);
 			dts_insert_head(low, elem);
 		}
 	}
 
-	dts_free(dts);
-	dts = NULL;
-
 	if (util > clc.c_m) {
-		/* If utilization is above the number of cores, 
+		/* If utilization is above the number of cores,
 		 * it's infeasible */
 		goto done;
 	}
-	
+
 	if (infeas) {
 		goto done;
 	}
 
 	m_low = clc.c_m - m_high;
-	set_timeout(clc.c_timeout, ntasks, m_high, m_low < 0 ? 0 : m_low , util, ofile);
-	if (low_sched(m_low, low)) {
+
+	/* The timeout covers the tests, from here on */
+	pthread_mutex_lock(&batch.b_lock);
+	if (jobs > 1 || pthread_getcpuclockid(pthread_self(), &w->sw_clock)) {
+		w->sw_clock = CLOCK_PROCESS_CPUTIME_ID;
+	}
+	clock_gettime(w->sw_clock, &w->sw_start);
+	w->sw_job = job;
+	pthread_mutex_unlock(&batch.b_lock);
+
+	if (low_sched(m_low, low, jobs, &job->sj_cancel)) {
 		sched = 1;
 	}
 
+	pthread_mutex_lock(&batch.b_lock);
+	w->sw_job = NULL;
+	if (job->sj_timeout) {
+		sched = 0;
+	}
+	pthread_mutex_unlock(&batch.b_lock);
+
 	if (m_low < 0) {
 		m_low = 0;
 	}
 
 done:
-	dts_clear(low); dts_free(low);
-
-	fprintf(ofile, "%s\n", header());
-	fprintf(ofile, "%s\n",
-		summary(ntasks, infeas, sched, m_high, m_low, util));
-	
-	rv = 0;
+	while ((cursor = dts_first(low))) {
+		dts_remove(cursor);
+		dtse_free(cursor);
+	}
+	dts_free(low);
+
+	job->sj_ntasks = ntasks;
+	job->sj_infeas = infeas;
+	job->sj_sched = sched;
+	job->sj_m_high = m_high;
+	job->sj_m_low = m_low;
+	job->sj_util = util;
+	job->sj_error = 0;
 bail:
 	config_destroy(&cfg);
 	if (dts) {
 		dts_clear(dts);
 		dts_free(dts);
 	}
-	if (clc.c_oname) {
-		free(clc.c_oname);
+	free(dir);
+}
+
+/**
+ * Writes the evaluated sets at the front of the batch, in input order
+ *
+ * Called with b_lock held.
+ */
+static void
+sched_flush() {
+	FILE *ofile = batch.b_ofile;
+
+	while (batch.b_printed < batch.b_njobs &&
+	    batch.b_jobs[batch.b_printed].sj_done) {
+		sched_job_t *job = &batch.b_jobs[batch.b_printed++];
+		char *row = summary(job->sj_ntasks, job->sj_infeas,
+		    job->sj_sched, job->sj_m_high, job->sj_m_low, job->sj_util);
+
+		if (!batch.b_batch) {
+			/* The report of a lone set */
+			if (job->sj_error) {
+				printf("%s", job->sj_msg);
+			} else if (job->sj_timeout) {
+				fprintf(ofile, "%s -- TIMEOUT!\n", header());
+				fprintf(ofile, "%s\n", row);
+			} else {
+				fprintf(ofile, "%s\n", header());
+				fprintf(ofile, "%s\n", row);
+			}
+			continue;
+		}
+		if (job->sj_error) {
+			/* One comment line, keeping the rows in order */
+			char *nl;
+			while ((nl = strchr(job->sj_msg, '\n')) && nl[1]) {
+				*nl = ' ';
+			}
+			fprintf(ofile, "# %s: %s", job->sj_name, job->sj_msg);
+		} else {
+			fprintf(ofile, "%s%s\n", row,
+			    job->sj_timeout ? " -- TIMEOUT!" : "");
+		}
 	}
-	if (clc.c_sname) {
-		free(clc.c_sname);
+	fflush(ofile);
+}
+
+/**
+ * Evaluates sets of the batch until there are none left
+ */
+static void *
+sched_worker(void *arg) {
+	sched_worker_t *w = arg;
+	int jobs = batch.b_njobs == 1 ? clc.c_jobs : 1;
+
+	while (1) {
+		pthread_mutex_lock(&batch.b_lock);
+		if (batch.b_next == batch.b_njobs) {
+			pthread_mutex_unlock(&batch.b_lock);
+			break;
+		}
+		sched_job_t *job = &batch.b_jobs[batch.b_next++];
+		pthread_mutex_unlock(&batch.b_lock);
+
+		sched_set(job, jobs, w);
+
+		pthread_mutex_lock(&batch.b_lock);
+		job->sj_done = 1;
+		if (job->sj_error) {
+			batch.b_rv = -1;
+		}
+		sched_flush();
+		pthread_mutex_unlock(&batch.b_lock);
 	}
-	if (ofile != stdout) {
-		fclose(ofile);
+	return NULL;
+}
+
+/**
+ * Cancels the tests of any set that used up its -t minutes of CPU
+ */
+static void *
+sched_timeout(void *arg) {
+	double limit = clc.c_timeout * 60.0;
+
+	pthread_mutex_lock(&batch.b_lock);
+	while (!batch.b_done) {
+		struct timespec now, wake;
+
+		for (int i = 0; i < clc.c_jobs && i < batch.b_njobs; i++) {
+			sched_worker_t *w = &batch.b_workers[i];
+			if (!w->sw_job || clock_gettime(w->sw_clock, &now)) {
+				continue;
+			}
+			double used = (now.tv_sec - w->sw_start.tv_sec) +
+			    (now.tv_nsec - w->sw_start.tv_nsec) / 1e9;
+			if (used >= limit &&
+			    !atomic_exchange(&w->sw_job->sj_cancel, 1)) {
+				w->sw_job->sj_timeout = 1;
+			}
+		}
+
+		/* CPU time is checked ten times a second */
+		clock_gettime(CLOCK_REALTIME, &wake);
+		wake.tv_nsec += 100000000;
+		if (wake.tv_nsec >= 1000000000) {
+			wake.tv_sec++;
+			wake.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&batch.b_cond, &batch.b_lock, &wake);
 	}
-	return rv;
+	pthread_mutex_unlock(&batch.b_lock);
+	return NULL;
 }
 
 static int
@@ -325,15 +669,112 @@ worst_fit(int m_low, task_set_t** ts, task_t *task) {
 }
 
 
+/**
+ * The test of a single core
+ *
+ * @return non-zero if the partition is schedulable, zero otherwise
+ */
 static int
-low_sched(int m_low, dtask_set_t* low) {
+part_sched(task_set_t *ts) {
+	if (clc.c_nonp) {
+		/* Non preemptive */
+		if (tpj(ts, NULL) != 0) {
+			return 0;
+		}
+	}
+	if (clc.c_p) {
+		/* Preemptive */
+		if (max_chunks(ts) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Partitions shared between the workers of low_test()
+ */
+typedef struct {
+	task_set_t **lw_parts;
+	int lw_m;
+	int lw_next;		/**< Next partition to be tested */
+	int lw_failed;		/**< A partition is unschedulable */
+	atomic_int *lw_cancel;	/**< Ends the running tests, dlm_watch() */
+	pthread_mutex_t lw_lock;
+} low_work_t;
+
+/**
+ * Tests partitions until there are none left, one has failed or the
+ * set is cancelled
+ */
+static void *
+low_worker(void *arg) {
+	low_work_t *lw = arg;
+
+	dlm_watch(lw->lw_cancel);
+	while (1) {
+		pthread_mutex_lock(&lw->lw_lock);
+		if (lw->lw_failed || lw->lw_next == lw->lw_m ||
+		    atomic_load(lw->lw_cancel)) {
+			pthread_mutex_unlock(&lw->lw_lock);
+			break;
+		}
+		int i = lw->lw_next++;
+		pthread_mutex_unlock(&lw->lw_lock);
+
+		if (!part_sched(lw->lw_parts[i])) {
+			pthread_mutex_lock(&lw->lw_lock);
+			lw->lw_failed = 1;
+			pthread_mutex_unlock(&lw->lw_lock);
+			/* The other cores no longer matter */
+			atomic_store(lw->lw_cancel, 1);
+		}
+	}
+	dlm_watch(NULL);
+	return NULL;
+}
+
+/**
+ * Tests every partition on up to jobs threads, the calling thread
+ * included
+ *
+ * @return non-zero if every partition is schedulable, zero otherwise
+ */
+static int
+low_test(int m_low, task_set_t** parts, int jobs, atomic_int *cancel) {
+	int nthreads = jobs < m_low ? jobs : m_low;
+	pthread_t threads[nthreads];
+	int started = 0;
+	low_work_t lw = {
+		.lw_parts = parts,
+		.lw_m = m_low,
+		.lw_cancel = cancel,
+		.lw_lock = PTHREAD_MUTEX_INITIALIZER
+	};
+
+	/* Fewer threads than asked for only makes it slower */
+	for (; started < nthreads - 1; started++) {
+		if (pthread_create(&threads[started], NULL, low_worker, &lw)) {
+			break;
+		}
+	}
+	low_worker(&lw);
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_mutex_destroy(&lw.lw_lock);
+	return !lw.lw_failed && !atomic_load(cancel);
+}
+
+static int
+low_sched(int m_low, dtask_set_t* low, int jobs, atomic_int *cancel) {
 	int rv = 0;
 
 	if (!dts_first(low) && m_low >= 0) {
 		/* 0 low utilization tasks are always schedulable */
 		return 1;
 	}
-	
+
 	if (m_low <= 0) {
 		return rv;
 	}
@@ -355,26 +796,16 @@ low_sched(int m_low, dtask_set_t* low) {
 			idx = worst_fit(m_low, parts, task);
 		}
 		if (idx < 0) {
+			task_free(task);
 			goto done;
 		}
 		ts_add(parts[idx], task);
 	}
 
-	for (int i=0; i < m_low; i++) {
-		if (clc.c_nonp) {
-			/* Non preemptive */
-			if (tpj(parts[i], NULL) != 0) {
-				goto done;
-			}
-		}
-		if (clc.c_p) {
-			/* Preemptive */
-			if (max_chunks(parts[i]) != 0) {
-				goto done;
-			}
-		}
+	if (!low_test(m_low, parts, jobs, cancel)) {
+		goto done;
 	}
-	
+
 	rv = 1;
 done:
 	for (int i=0; i < m_low; i++) {
@@ -383,9 +814,13 @@ done:
 	return rv;
 }
 
+/**
+ * @note header() and summary() share a buffer each, they are only
+ * called by sched_flush() under the batch lock
+ */
 static char*
 header() {
-	static char buff[256];	
+	static char buff[256];
 	sprintf(buff, "%-7s %-6s %-5s %-6s %-5s %6s",
 		"# tasks", "infeas", "sched", "m_high", "m_low", "util");
 	return buff;
@@ -401,61 +836,3 @@ summary(int ntasks, int infeas, int sched, int m_high,
 		m_high, m_low, util);
 	return buff;
 }
-
-static struct {
-	int to_ntasks;
-	/* not infeasible if we got this far */
-	/* not schedulable if this fired */
-	int to_mhigh;
-	int to_mlow;
-	float to_util;
-	FILE *to_ofile;
-} to_data;
-
-static void
-expire_timeout(int sig, siginfo_t *si, void *uc) {
-	/* Clearly not safe, but that's not the point */
-	fprintf(to_data.to_ofile, "%s -- TIMEOUT!\n", header());
-	fprintf(to_data.to_ofile, "%s\n",
-		summary(to_data.to_ntasks, 0, 0, to_data.to_mhigh, to_data.to_mlow,
-			to_data.to_util));
-	exit(0);
-}
-
-static void
-set_timeout(int minutes, int ntasks, int mhigh, int mlow, float util, FILE *ofile) {
-	timer_t timerid;
-	struct sigevent sev;
-	struct itimerspec its;
-	sigset_t mask;
-	struct sigaction sa;
-
-	if (minutes <= 0) {
-		/* No timeout */
-		return;
-	}
-
-	to_data.to_ntasks = ntasks;
-	to_data.to_mhigh = mhigh;
-	to_data.to_mlow = mlow;
-	to_data.to_util = util;
-	to_data.to_ofile = ofile;
-	
-	minutes *= 60;
-	
-	sa.sa_flags = SA_SIGINFO;
-	sa.sa_sigaction = expire_timeout;
-	sigemptyset(&sa.sa_mask);
-	sigaction(SIGRTMIN, &sa, NULL);
-
-	sev.sigev_notify = SIGEV_SIGNAL;
-	sev.sigev_signo = SIGRTMIN;
-	sev.sigev_value.sival_ptr = &timerid;
-	timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &timerid);
-
-	memset(&its, 0, sizeof(its));
-	its.it_value.tv_nsec = 0;
-	its.it_value.tv_sec = minutes;
-
-	timer_settime(timerid, 0, &its, NULL);
-}
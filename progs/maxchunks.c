@@ -5,6 +5,7 @@
 #include <stdlib.h>
 
 #include "maxchunks.h"
+#include "qpa.h"
 #include "taskset-config.h"
 #include "tasks_ex.h"
 		   
@@ -16,6 +17,7 @@ static struct {
 	char* c_fname;
 	char* c_log;
 	int c_nonp;
+	int c_qpa;
 } clc;
 
 static const char* short_options = "hl:s:v";
@@ -24,6 +26,7 @@ static struct option long_options[] = {
     {"help", no_argument, 0, 'h'},
     {"log", required_argument, 0, 'l'},
     {"nonp", no_argument, &clc.c_nonp, 1},
+    {"qpa", no_argument, &clc.c_qpa, 1},
     {"verbose", no_argument, &clc.c_verbose, 1},
     {0, 0, 0, 0}
 };
@@ -35,6 +38,8 @@ usage() {
 	printf("\t--help/-h\t\tThis message\n");
 	printf("\t--log/-l <FILE>\t\tAuditible log file\n");
 	printf("\t--nonp\t\t Nonpreemptive feasibility only if chunks >= WCET\n");
+	printf("\t--qpa\t\t\tFeasibility only, by Quick Processor-demand Analysis\n");
+	printf("\t\t\t\t(chunks are not assigned, not with --nonp)\n");
 	printf("\t--task-set/-s <FILE>\tRequired file containing tasks\n");
 	printf("\t--verbose/-v\t\tEnables verbose output\n");
 	printf("RETURNS:\n");
@@ -80,6 +85,12 @@ main(int argc, char** argv) {
 		usage();
 		goto bail;
 	}
+	if (clc.c_qpa && clc.c_nonp) {
+		printf("--qpa assigns no chunks, it cannot check --nonp\n");
+		rv = -1;
+		usage();
+		goto bail;
+	}
 	if (clc.c_verbose) {
 		printf("Verbose enable\n");
 		fclose(log);
@@ -121,15 +132,19 @@ main(int argc, char** argv) {
 		rv = -1;
 		goto bail;
 	}
-	int feas = maxchunks_dbg(ts, log);
-	if (clc.c_nonp) {
-		/* Non-preemptive check */
-		feas = max_chunks_nonp(ts);
-	}
-
+	int feas;
+	if (clc.c_qpa) {
+		feas = qpa(ts, log);
+	} else {
+		feas = maxchunks_dbg(ts, log);
+		if (clc.c_nonp && feas >= 0) {
+			/* Non-preemptive check */
+			feas = max_chunks_nonp(ts);
+		}
 
-	printf("After assigning non-preemptive chunks\n");
-	str = ts_string(ts); printf("%s\n", str); free(str);
+		printf("After assigning non-preemptive chunks\n");
+		str = ts_string(ts); printf("%s\n", str); free(str);
+	}
 	printf("-------------------------------------------------\n");
 	printf("Utilization: %.4f, T*: %lu, Feasible: ", ts_util(ts),
 	    ts_star(ts));
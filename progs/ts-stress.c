@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "taskset-create.h"
+#include "uunifast.h"
+#include "maxchunks.h"
+#include "tpj.h"
+
+/**
+ * global command line configuration
+ */
+static struct {
+	int c_verbose;
+	int c_sets;
+	int c_tasks;
+	int c_jobs;
+	int c_repeat;
+	double c_util;
+	unsigned long c_seed;
+	tint_t c_minp;
+	tint_t c_maxp;
+	tint_t c_horizon;
+	char* c_test;
+} clc;
+
+enum {
+      ARG_MINP = CHAR_MAX + 1,
+      ARG_MAXP,
+      ARG_HORIZON,
+      ARG_TEST
+};
+
+static const char* short_options = "hj:n:r:s:t:u:v";
+static struct option long_options[] = {
+    {"help",		no_argument,		0, 'h'},
+    {"horizon",		required_argument,	0, ARG_HORIZON},
+    {"jobs",		required_argument,	0, 'j'},
+    {"maxp",		required_argument,	0, ARG_MAXP},
+    {"minp",		required_argument,	0, ARG_MINP},
+    {"repeat",		required_argument,	0, 'r'},
+    {"seed",		required_argument,	0, 's'},
+    {"sets",		required_argument,	0, 'n'},
+    {"tasks",		required_argument,	0, 't'},
+    {"test",		required_argument,	0, ARG_TEST},
+    {"util",		required_argument,	0, 'u'},
+    {"verbose",		no_argument,		&clc.c_verbose, 1},
+    {0, 0, 0, 0}
+};
+
+static const char *usagec[] = {
+"ts-stress: measures how the scheduling tests scale across threads",
+"Usage: ts-stress [OPTIONS]",
+"OPTIONS:",
+"	-h/--help		This message",
+"	--horizon <INT>		Largest t the demand test sums to (10000)",
+"	-j/--jobs <INT>		Largest number of threads (32)",
+"	--minp <INT>		Minimum period of any task (100)",
+"	--maxp <INT>		Maximum period of any task (10000)",
+"	-n/--sets <INT>		Number of task sets (256)",
+"	-r/--repeat <INT>	Times every set is tested per thread count (1)",
+"	-s/--seed <INT>		Random seed of the generated sets (1)",
+"	-t/--tasks <INT>	Tasks per set (16)",
+"	--test <NAME>		demand, tpj, maxchunks or all (all)",
+"	-u/--util <FLOAT>	Utilization of every set (0.8)",
+"	-v/--verbose		Verbose output",
+"",
+"OPERATION:",
+"	ts-stress generates the task sets once, then runs the chosen tests",
+"	over all of them with 1, 2, 4, ... up to --jobs threads, each",
+"	thread taking every n-th set. The sets are shared between the",
+"	threads; tpj and maxchunks, which modify a set, work on a private",
+"	ts_dup() of it. Every thread count must reach the same checksum,",
+"	anything else is a reentrancy bug and ts-stress fails.",
+"",
+"EXAMPLES:",
+"	# Scaling of all the tests up to 32 threads",
+"	> ts-stress",
+"	# Only the demand evaluation, 1024 sets of 64 tasks, up to 8 threads",
+"	> ts-stress --test demand -n 1024 -t 64 -j 8",
+};
+
+void
+usage() {
+	for (int i = 0; i < sizeof(usagec) / sizeof(usagec[0]); i++) {
+		printf("%s\n", usagec[i]);
+	}
+}
+
+typedef int64_t (*stress_fn)(task_set_t *ts);
+
+/**
+ * Sums the demand of the set over [1, min(T*, horizon)]
+ */
+static int64_t
+stress_demand(task_set_t *ts) {
+	tint_t end = ts_star(ts);
+	int64_t sum = 0;
+
+	if (end > clc.c_horizon) {
+		end = clc.c_horizon;
+	}
+	for (tint_t t = 1; t <= end; t++) {
+		sum += ts_demand(ts, t);
+	}
+	return sum;
+}
+
+static int64_t
+stress_tpj(task_set_t *ts) {
+	task_set_t *dup = ts_dup(ts);
+	int64_t rv = tpj(dup, NULL);
+
+	ts_destroy(dup);
+	return rv;
+}
+
+static int64_t
+stress_maxchunks(task_set_t *ts) {
+	task_set_t *dup = ts_dup(ts);
+	int64_t rv = max_chunks(dup);
+
+	ts_destroy(dup);
+	return rv;
+}
+
+static const struct {
+	const char *st_name;
+	stress_fn st_fn;
+} stress_tests[] = {
+	{"demand", stress_demand},
+	{"tpj", stress_tpj},
+	{"maxchunks", stress_maxchunks},
+};
+
+/**
+ * What every worker thread is handed
+ */
+typedef struct {
+	task_set_t **sw_sets;
+	int sw_nsets;
+	int sw_first;	/**< First set of the thread */
+	int sw_stride;	/**< Number of threads */
+	stress_fn sw_fn;
+	int64_t sw_sum;	/**< Checksum of the results */
+} stress_work_t;
+
+static void *
+stress_worker(void *arg) {
+	stress_work_t *sw = arg;
+
+	sw->sw_sum = 0;
+	for (int r = 0; r < clc.c_repeat; r++) {
+		for (int i = sw->sw_first; i < sw->sw_nsets; i += sw->sw_stride) {
+			sw->sw_sum += sw->sw_fn(sw->sw_sets[i]);
+		}
+	}
+	return NULL;
+}
+
+static double
+stress_now() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs fn over every set with nthreads threads
+ *
+ * @return the elapsed time in seconds, negative if a thread could not
+ * be started
+ */
+static double
+stress_run(task_set_t **sets, stress_fn fn, int nthreads, int64_t *sum) {
+	pthread_t *threads = calloc(nthreads, sizeof(pthread_t));
+	stress_work_t *work = calloc(nthreads, sizeof(stress_work_t));
+	double start, elapsed = -1;
+	int started = 0;
+
+	if (!threads || !work) {
+		goto bail;
+	}
+	start = stress_now();
+	for (; started < nthreads; started++) {
+		stress_work_t *sw = &work[started];
+		sw->sw_sets = sets;
+		sw->sw_nsets = clc.c_sets;
+		sw->sw_first = started;
+		sw->sw_stride = nthreads;
+		sw->sw_fn = fn;
+		if (pthread_create(&threads[started], NULL, stress_worker, sw)) {
+			break;
+		}
+	}
+	*sum = 0;
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		*sum += work[i].sw_sum;
+	}
+	if (started == nthreads) {
+		elapsed = stress_now() - start;
+	}
+bail:
+	free(threads);
+	free(work);
+	return elapsed;
+}
+
+/**
+ * Generates a set with UUniFast and implicit-to-constrained deadlines
+ */
+static task_set_t *
+stress_set(gsl_rng *r) {
+	task_set_t *ts = ts_alloc();
+
+	if (!ts) {
+		return NULL;
+	}
+	if (!tsc_bare_addn(ts, clc.c_tasks) ||
+	    !tsc_set_periods(ts, r, clc.c_minp, clc.c_maxp) ||
+	    uunifast(ts, clc.c_util, r, NULL) ||
+	    !tsc_set_deadlines_min_halfp(ts, r, 0, clc.c_maxp)) {
+		ts_destroy(ts);
+		return NULL;
+	}
+	return ts;
+}
+
+int
+main(int argc, char** argv) {
+	task_set_t **sets = NULL;
+	gsl_rng *r = NULL;
+	int rv = -1; /* Assume failure */
+
+	clc.c_sets = 256;
+	clc.c_tasks = 16;
+	clc.c_jobs = 32;
+	clc.c_repeat = 1;
+	clc.c_util = 0.8;
+	clc.c_seed = 1;
+	clc.c_minp = 100;
+	clc.c_maxp = 10000;
+	clc.c_horizon = 10000;
+
+	/* Parse those arguments! */
+	while(1) {
+		int opt_idx = 0;
+		int c = getopt_long(argc, argv, short_options,
+		    long_options, &opt_idx);
+		if (c == -1) {
+			break;
+		}
+
+		switch(c) {
+		case 0:
+			break;
+		case 'h':
+			usage();
+			goto bail;
+		case 'j':
+			clc.c_jobs = atoi(optarg);
+			break;
+		case 'n':
+			clc.c_sets = atoi(optarg);
+			break;
+		case 'r':
+			clc.c_repeat = atoi(optarg);
+			break;
+		case 's':
+			clc.c_seed = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			clc.c_tasks = atoi(optarg);
+			break;
+		case 'u':
+			clc.c_util = atof(optarg);
+			break;
+		case 'v':
+			clc.c_verbose = 1;
+			break;
+		case ARG_MINP:
+			clc.c_minp = atoll(optarg);
+			break;
+		case ARG_MAXP:
+			clc.c_maxp = atoll(optarg);
+			break;
+		case ARG_HORIZON:
+			clc.c_horizon = atoll(optarg);
+			break;
+		case ARG_TEST:
+			clc.c_test = strdup(optarg);
+			break;
+		default:
+			printf("Unknown option %c\n", c);
+			usage();
+			goto bail;
+		}
+	}
+
+	if (clc.c_sets <= 0 || clc.c_tasks <= 0 || clc.c_jobs <= 0 ||
+	    clc.c_repeat <= 0 || clc.c_minp <= 0 || clc.c_maxp < clc.c_minp) {
+		fprintf(stderr, "Invalid sets, tasks, jobs, repeat or periods\n");
+		usage();
+		goto bail;
+	}
+	if (clc.c_test && strcmp(clc.c_test, "all")) {
+		int found = 0;
+		for (int i = 0; i < sizeof(stress_tests) / sizeof(stress_tests[0]);
+		    i++) {
+			found |= !strcmp(clc.c_test, stress_tests[i].st_name);
+		}
+		if (!found) {
+			fprintf(stderr, "Unknown test %s\n", clc.c_test);
+			goto bail;
+		}
+	}
+
+	/* The sets are generated once, single threaded, from the seed */
+	ges_stfu();
+	r = gsl_rng_alloc(gsl_rng_default);
+	sets = calloc(clc.c_sets, sizeof(task_set_t *));
+	if (!r || !sets) {
+		fprintf(stderr, "Unable to allocate the task sets\n");
+		goto bail;
+	}
+	gsl_rng_set(r, clc.c_seed);
+	for (int i = 0; i < clc.c_sets; i++) {
+		sets[i] = stress_set(r);
+		if (!sets[i]) {
+			fprintf(stderr, "Unable to generate task set %d\n", i);
+			goto bail;
+		}
+	}
+	if (clc.c_verbose) {
+		fprintf(stderr, "%d sets of %d tasks, U = %g, P in [%lu, %lu]\n",
+		    clc.c_sets, clc.c_tasks, clc.c_util, clc.c_minp, clc.c_maxp);
+	}
+
+	printf("%-10s %7s %10s %8s %10s\n", "test", "threads", "seconds",
+	    "speedup", "efficiency");
+	for (int i = 0; i < sizeof(stress_tests) / sizeof(stress_tests[0]);
+	    i++) {
+		double base = 0;
+		int64_t expect = 0;
+
+		if (clc.c_test && strcmp(clc.c_test, "all") &&
+		    strcmp(clc.c_test, stress_tests[i].st_name)) {
+			continue;
+		}
+		for (int n = 1; ; n = 2 * n > clc.c_jobs ? clc.c_jobs : 2 * n) {
+			int64_t sum;
+			double elapsed = stress_run(sets, stress_tests[i].st_fn,
+			    n, &sum);
+			if (elapsed < 0) {
+				fprintf(stderr, "Unable to start %d threads\n", n);
+				goto bail;
+			}
+			if (n == 1) {
+				base = elapsed;
+				expect = sum;
+			} else if (sum != expect) {
+				fprintf(stderr, "%s: checksum %ld with %d threads, "
+				    "%ld with 1\n", stress_tests[i].st_name, sum,
+				    n, expect);
+				goto bail;
+			}
+			printf("%-10s %7d %10.4f %8.2f %9.1f%%\n",
+			    stress_tests[i].st_name, n, elapsed, base / elapsed,
+			    100 * base / elapsed / n);
+			if (n == clc.c_jobs) {
+				break;
+			}
+		}
+	}
+
+	rv = 0;
+bail:
+	if (sets) {
+		for (int i = 0; i < clc.c_sets; i++) {
+			ts_destroy(sets[i]);
+		}
+		free(sets);
+	}
+	if (r) {
+		gsl_rng_free(r);
+	}
+	if (clc.c_test) {
+		free(clc.c_test);
+	}
+	return rv;
+}
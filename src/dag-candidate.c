@@ -1,6 +1,6 @@
-#include "dag-candidate.h"
+#include <pthread.h>
 
-void agnode_to_dnode(Agnode_t *src, dnode_t *dst);
+#include "dag-candidate.h"
 
 cand_list_t*
 cand_list_alloc() {
@@ -44,8 +44,9 @@ cand_find(cand_list_t* head, char *name) {
 	}
 
 	/* c - cursor in the list */
+	char buff[2 * DT_NAMELEN + 1];
 	cand_t *c = cand_first(head);
-	while (c && strcmp(cand_name(c), name) != 0) {
+	while (c && strcmp(cand_name_r(c, buff, sizeof(buff)), name) != 0) {
 		c = cand_next(c);
 	}
 	return c;
@@ -107,147 +108,80 @@ cand_set_nodes(cand_t *cand, dnode_t *a, dnode_t *b) {
 
 
 char*
-cand_name(cand_t *c) {
-	static char buff[DT_NAMELEN];
-	sprintf(buff, "%s,%s", c->c_a->dn_name, c->c_b->dn_name);
+cand_name_r(cand_t *c, char *buff, size_t len) {
+	snprintf(buff, len, "%s,%s", c->c_a->dn_name, c->c_b->dn_name);
 
 	return buff;
 }
 
+char*
+cand_name(cand_t *c) {
+	static __thread char buff[2 * DT_NAMELEN + 1];
 
-
-static dnode_t *
-find_first_by_obj(dtask_t *task, tint_t object) {
-	Agnode_t *agnode = agfstnode(task->dt_graph);
-	dnode_t *next = dnode_alloc(agnameof(agnode));
-	agnode_to_dnode(agnode, next);
-	next->dn_task = task;
-	while (next->dn_object != object) {
-		dnode_free(next);
-		agnode = agnxtnode(task->dt_graph, agnode);
-		if (!agnode) {
-			return NULL;
-		}
-		next = dnode_alloc(agnameof(agnode));
-		agnode_to_dnode(agnode, next);
-		next->dn_task = task;
-	}
-	return next;
+	return cand_name_r(c, buff, sizeof(buff));
 }
 
 
-static dnode_t *
-find_next_by_obj(dtask_t* task, dnode_t *node) {
-	Agnode_t *agnode = node->dn_node;
 
-	while (agnode = agnxtnode(task->dt_graph, agnode)) {
-		dnode_t *next = dnode_alloc(agnameof(agnode));
-		agnode_to_dnode(agnode, next);
-		next->dn_task = task;
-		if (next->dn_object == node->dn_object) {
-			return next;
-		}
-		dnode_free(next);
-	}
-	return NULL;
-}
+/**
+ * The first two nodes of the first object from object on that has
+ * two nodes
+ *
+ * @return non-zero if there is such an object, zero otherwise
+ */
+static int
+task_cand_obj(dtask_t *task, tint_t object, dnid_t *a, dnid_t *b) {
+	int max = dtask_max_object(task);
 
-static cand_t*
-task_cand_first(dtask_t *task) {
-	cand_t *cand = cand_alloc();
-	tint_t object = 0;
-	dnode_t *a = find_first_by_obj(task, object);
-	dnode_t *b = NULL;
-	if (a) {
-		b = find_next_by_obj(task, a);
-	}
-	if (b) {
-		/* Have a candidate */
-		goto done;
-	}
-	tint_t max = dtask_max_object(task);
-	while (!b) {
-		dnode_free(a);
-		a = NULL;
-		object++;
-
-		if (object > max) {
-			cand_free(cand);
-			return NULL;
-		}
-		a = find_first_by_obj(task, object);
-		if (a) {
-			b = find_next_by_obj(task, a);
+	for (; max >= 0 && object <= (tint_t) max; object++) {
+		if (dtask_obj_count(task, object) < 2) {
+			continue;
 		}
+		*a = dtask_obj_first(task, object);
+		*b = dtask_obj_next(task, *a);
+		return 1;
 	}
-done:
-	cand_set_nodes(cand, a, b);
-	dnode_free(a);
-	dnode_free(b);
-	return cand;
+	return 0;
 }
 
 cand_t*
 task_cand_next(dtask_t *task, cand_t *cur) {
-	dnode_t *a = NULL, *b = NULL, *next = NULL;
-	cand_t *orig = NULL; 
-	
-	if (cur == NULL) {
-		cur = task_cand_first(task);
-		return cur;
-	}
-	//orig = cand_copy(cur);
-	a = dnode_copy(cur->c_a);
-	b = dnode_copy(cur->c_b);
-	next = find_next_by_obj(task, cur->c_b);
-	if (next) {
-		/* There is another node to collapse with with the
-		   same object */ 
-		cand_set_nodes(cur, a, next);
-		goto done;
-	}
-	/* Need to go to the next object */
-	cand_free(cur);
-	cur = NULL;
-	int max = dtask_max_object(task);
-	tint_t object = dnode_get_object(a);
-	do {
-		dnode_free(a); a = NULL;
-		dnode_free(b); b = NULL;
-		if (++object > max) {
-			goto done;
+	dnid_t a, b;
+	tint_t object = 0;
+
+	if (cur) {
+		/* Pair the first node of the object with the next one */
+		b = dtask_name_id(task, cur->c_b->dn_name);
+		b = dtask_obj_next(task, b);
+		if (b != DNID_NONE) {
+			dtask_node_load(task, b, cur->c_b);
+			return cur;
 		}
-		a = find_first_by_obj(task, object);
-		if (a) {
-			b = find_next_by_obj(task, a);
+		/* Need to go to the next object */
+		object = dnode_get_object(cur->c_a) + 1;
+	}
+	if (!task_cand_obj(task, object, &a, &b)) {
+		if (cur) {
+			cand_free(cur);
 		}
-	} while (b == NULL);
-	cur = cand_alloc();
-	cand_set_nodes(cur, a, b);
-		
-done:
-	dnode_free(a);
-	dnode_free(b);
-	dnode_free(next);
-	if (cur->c_a == NULL) {
-		0x0;
+		return NULL;
 	}
-	if (cur->c_b == NULL) {
-		0x0;
+	if (!cur) {
+		cur = cand_alloc();
+		cur->c_a = dnode_alloc("");
+		cur->c_b = dnode_alloc("");
 	}
+	dtask_node_load(task, a, cur->c_a);
+	dtask_node_load(task, b, cur->c_b);
 
-	//cand_free(orig);
 	return cur;
 }
 
-int
-cand_delta_l(cand_t *cand) {
-	if (!cand) {
-		return 0;
-	}
-	if (!cand->c_a || !cand->c_b) {
-		return 0;
-	}
+/**
+ * Change in critical path length by collapsing a copy of the task
+ */
+static int
+cand_delta_l_copy(cand_t *cand) {
 	dtask_t *task = cand->c_a->dn_task;
 	dtask_update(task);
 	dtask_t *copy = dtask_copy(task);
@@ -262,129 +196,587 @@ cand_delta_l(cand_t *cand) {
 	dnode_free(b);
 	dtask_free(copy);
 
+	return delta;
+}
+
+int
+cand_delta_l(cand_t *cand) {
+	dnode_t node;
+	tint_t cpathlen;
+
+	if (!cand) {
+		return 0;
+	}
+	if (!cand->c_a || !cand->c_b) {
+		return 0;
+	}
+	dtask_t *task = cand->c_a->dn_task;
+	dnid_t a = dtask_name_id(task, cand->c_a->dn_name);
+	dnid_t b = dtask_name_id(task, cand->c_b->dn_name);
+	if (a == DNID_NONE || b == DNID_NONE) {
+		return 0;
+	}
+
+	/* The collapsed node, as made by dag_collapse() */
+	dtask_node_load(task, a, &node);
+	dnode_set_threads(&node, task->dt_threads[a] + task->dt_threads[b]);
+
+	int delta;
+	if (dtask_merged_cpathlen(task, a, b, dnode_get_wcet(&node),
+				  &cpathlen)) {
+		delta = dtask_cpathlen(task) - cpathlen;
+	} else {
+		delta = cand_delta_l_copy(cand);
+	}
+
 	cand->c_delta_l = delta;
 	return delta;
 }
+/**
+ * Ids of the nodes of the candidate in their task
+ *
+ * @return non-zero if both nodes are in the task, zero otherwise
+ */
+static int
+cand_ids(cand_t *cand, dnid_t *a, dnid_t *b) {
+	if (!cand->c_a || !cand->c_b || !cand->c_a->dn_task) {
+		return 0;
+	}
+	dtask_t *task = cand->c_a->dn_task;
+	*a = dtask_name_id(task, cand->c_a->dn_name);
+	*b = dtask_name_id(task, cand->c_b->dn_name);
+
+	return *a != DNID_NONE && *b != DNID_NONE;
+}
+
 /**
  * Calculate the change in workload for a candidate
+ *
+ * The collapsed node has the threads of both nodes and the WCET of
+ * one thread and growth factor of the first, see dag_collapse().
  */
 int
 cand_delta_c(cand_t *cand) {
+	dnid_t a, b;
+
 	if (!cand) {
 		return 0;
 	}
-	if (!cand->c_a || !cand->c_b) {
+	if (!cand_ids(cand, &a, &b)) {
 		return 0;
 	}
 	dtask_t *task = cand->c_a->dn_task;
-	dtask_update(task);
 
-	dtask_t *copy = dtask_copy(task);
-
-	dnode_t *a = dtask_name_search(copy, cand->c_a->dn_name);
-	dnode_t *b = dtask_name_search(copy, cand->c_b->dn_name);	
-	dag_collapse(a, b);
-	dtask_update(copy);
-
-	int delta = dtask_workload(task) - dtask_workload(copy);
-	dnode_free(a);
-	dnode_free(b);
-	dtask_free(copy);
+	tint_t wcet = dnode_wcet_of(task->dt_wcet_one[a],
+	    task->dt_threads[a] + task->dt_threads[b], task->dt_factor[a]);
+	int delta = task->dt_wcet[a] + task->dt_wcet[b] - wcet;
 
 	cand->c_delta_c = delta;
 	return delta;
 }
 
-void
-cand_ins_maxb(cand_list_t *head, cand_t *cand) {
-	if (cand_list_empty(head)) {
-		cand_insert_head(head, cand);
-		return;
-	}
-	cand_t *next, *prev = NULL;
-	for (next = cand_first(head); next; next = cand_next(next)) {
-		prev = next;
-		if (next->c_delta_c < cand->c_delta_c) {
-			cand_insert_after(next, cand);
-			return;
+int
+cand_delta_c_list(cand_list_t *head) {
+	cand_t *c;
+	dnid_t a, b;
+	int n = 0;
+	int rv = -1;
+
+	cand_foreach(head, c) {
+		n++;
+	}
+	tint_t *wcet_one = malloc(n * sizeof(tint_t));
+	tint_t *threads = malloc(n * sizeof(tint_t));
+	float_t *factor = malloc(n * sizeof(float_t));
+	tint_t *wcet = malloc(n * sizeof(tint_t));
+	int *delta = malloc(n * sizeof(int));
+	if (n && (!wcet_one || !threads || !factor || !wcet || !delta)) {
+		goto bail;
+	}
+
+	/* Gather the parameters of the nodes */
+	int i = 0;
+	cand_foreach(head, c) {
+		if (!cand_ids(c, &a, &b)) {
+			/* No change */
+			wcet_one[i] = threads[i] = wcet[i] = 0;
+			factor[i] = 0;
+			i++;
+			continue;
+		}
+		dtask_t *task = c->c_a->dn_task;
+		wcet_one[i] = task->dt_wcet_one[a];
+		threads[i] = task->dt_threads[a] + task->dt_threads[b];
+		factor[i] = task->dt_factor[a];
+		wcet[i] = task->dt_wcet[a] + task->dt_wcet[b];
+		i++;
+	}
+
+	for (i = 0; i < n; i++) {
+		delta[i] = wcet[i] - dnode_wcet_of(wcet_one[i], threads[i],
+						   factor[i]);
+	}
+
+	i = 0;
+	cand_foreach(head, c) {
+		c->c_delta_c = delta[i++];
+	}
+	rv = n;
+bail:
+	free(wcet_one);
+	free(threads);
+	free(factor);
+	free(wcet);
+	free(delta);
+	return rv;
+}
+
+/**
+ * A share of the candidates scored by one worker
+ *
+ * Worker j scores the candidates j, j + jobs, ... on its own copy of
+ * the task, and writes only to their entries of the arrays.
+ */
+typedef struct cand_score {
+	dtask_t	*cs_task;	/**< the task, or a copy of it */
+	int	cs_deltas;	/**< CTAB_DELTA_* to score */
+	dnid_t	*cs_a;		/**< first node of each candidate */
+	dnid_t	*cs_b;		/**< second node of each candidate */
+	int	*cs_ok;		/**< non-zero if the candidate can collapse */
+	int	*cs_delta_c;	/**< delta_c of each candidate */
+	int	*cs_delta_l;	/**< delta_l of each candidate */
+	uint32_t cs_n;		/**< number of candidates */
+	uint32_t cs_first;	/**< first candidate of the share */
+	uint32_t cs_stride;	/**< distance between candidates of the share */
+} cand_score_t;
+
+static void*
+cand_score_run(void *arg) {
+	cand_score_t *cs = arg;
+	dnode_t a, b;
+	cand_t cand = { .c_a = &a, .c_b = &b };
+
+	for (uint32_t i = cs->cs_first; i < cs->cs_n; i += cs->cs_stride) {
+		dtask_node_load(cs->cs_task, cs->cs_a[i], &a);
+		dtask_node_load(cs->cs_task, cs->cs_b[i], &b);
+		cs->cs_ok[i] = dag_can_collapse(&a, &b);
+		if (!cs->cs_ok[i]) {
+			continue;
+		}
+		if (cs->cs_deltas & CTAB_DELTA_C) {
+			cs->cs_delta_c[i] = cand_delta_c(&cand);
+		}
+		if (cs->cs_deltas & CTAB_DELTA_L) {
+			cs->cs_delta_l[i] = cand_delta_l(&cand);
 		}
 	}
-	cand_insert_after(prev, cand);
+
+	return NULL;
 }
 
 /**
- * Insert an element into the candidate list in increasing delta_l order
+ * Scores the candidates of the table on jobs workers
  *
- * @param[in] head of the candidate list
- * @param[in] cand the element being added
+ * @return non-zero on success, zero if memory ran out
  */
+static int
+ctab_score(ctab_t *ct, int *ok, int deltas, int jobs) {
+	dtask_t *task = ct->ct_task;
+	cand_score_t *cs = NULL;
+	pthread_t *tids = NULL;
+	int rv = 0;
+
+	if (jobs < 1) {
+		jobs = 1;
+	}
+	if ((uint32_t) jobs > ct->ct_n) {
+		jobs = ct->ct_n ? ct->ct_n : 1;
+	}
+	cs = calloc(jobs, sizeof(cand_score_t));
+	tids = calloc(jobs, sizeof(pthread_t));
+	if (!cs || !tids) {
+		goto bail;
+	}
+
+	/* The copies share nothing, the task is only read from here on */
+	dtask_update(task);
+	for (int j = 0; j < jobs; j++) {
+		cs[j].cs_task = jobs == 1 ? task : dtask_copy(task);
+		if (!cs[j].cs_task) {
+			goto bail;
+		}
+		cs[j].cs_deltas = deltas;
+		cs[j].cs_a = ct->ct_a;
+		cs[j].cs_b = ct->ct_b;
+		cs[j].cs_ok = ok;
+		cs[j].cs_delta_c = ct->ct_delta_c;
+		cs[j].cs_delta_l = ct->ct_delta_l;
+		cs[j].cs_n = ct->ct_n;
+		cs[j].cs_first = j;
+		cs[j].cs_stride = jobs;
+	}
+	if (jobs == 1) {
+		cand_score_run(&cs[0]);
+	} else {
+		int started;
+		for (started = 0; started < jobs; started++) {
+			if (pthread_create(&tids[started], NULL,
+			    cand_score_run, &cs[started])) {
+				break;
+			}
+		}
+		/* Whatever could not be started is scored here */
+		for (int j = started; j < jobs; j++) {
+			cand_score_run(&cs[j]);
+		}
+		for (int j = 0; j < started; j++) {
+			pthread_join(tids[j], NULL);
+		}
+	}
+	rv = 1;
+
+bail:
+	for (int j = 0; cs && j < jobs; j++) {
+		if (cs[j].cs_task && cs[j].cs_task != task) {
+			dtask_free(cs[j].cs_task);
+		}
+	}
+	free(cs);
+	free(tids);
+	return rv;
+}
+
+/**
+ * Makes room for n candidates in the table
+ */
+static int
+ctab_grow(ctab_t *ct, uint32_t n) {
+	dnid_t *a = realloc(ct->ct_a, n * sizeof(dnid_t));
+	if (a) {
+		ct->ct_a = a;
+	}
+	dnid_t *b = realloc(ct->ct_b, n * sizeof(dnid_t));
+	if (b) {
+		ct->ct_b = b;
+	}
+	return a && b;
+}
+
+/**
+ * Adds the candidates of the task in the order of task_cand_next()
+ */
+static int
+ctab_enum(ctab_t *ct) {
+	dtask_t *task = ct->ct_task;
+	uint32_t size = 0;
+
+	for (int o = 0; o <= dtask_max_object(task); o++) {
+		dnid_t first = dtask_obj_first(task, o);
+		if (first == DNID_NONE) {
+			continue;
+		}
+		for (dnid_t id = dtask_obj_next(task, first); id != DNID_NONE;
+		     id = dtask_obj_next(task, id)) {
+			if (ct->ct_n == size) {
+				size = size ? 2 * size : 64;
+				if (!ctab_grow(ct, size)) {
+					return 0;
+				}
+			}
+			ct->ct_a[ct->ct_n] = first;
+			ct->ct_b[ct->ct_n] = id;
+			ct->ct_n++;
+		}
+	}
+
+	return 1;
+}
+
+ctab_t*
+ctab_build(dtask_t *task, int deltas, int jobs) {
+	int *ok = NULL;
+	ctab_t *ct = calloc(1, sizeof(ctab_t));
+	if (!ct) {
+		return NULL;
+	}
+	ct->ct_task = task;
+	if (!ctab_enum(ct)) {
+		goto bail;
+	}
+
+	uint32_t n = ct->ct_n ? ct->ct_n : 1;
+	ok = calloc(n, sizeof(int));
+	ct->ct_delta_c = calloc(n, sizeof(int));
+	ct->ct_delta_l = calloc(n, sizeof(int));
+	ct->ct_order = calloc(n, sizeof(uint32_t));
+	if (!ok || !ct->ct_delta_c || !ct->ct_delta_l || !ct->ct_order) {
+		goto bail;
+	}
+	if (!ctab_score(ct, ok, deltas, jobs)) {
+		goto bail;
+	}
+
+	/* Keep the candidates that can collapse, in the order of the task */
+	n = 0;
+	for (uint32_t i = 0; i < ct->ct_n; i++) {
+		if (!ok[i]) {
+			continue;
+		}
+		ct->ct_a[n] = ct->ct_a[i];
+		ct->ct_b[n] = ct->ct_b[i];
+		ct->ct_delta_c[n] = ct->ct_delta_c[i];
+		ct->ct_delta_l[n] = ct->ct_delta_l[i];
+		ct->ct_order[n] = n;
+		n++;
+	}
+	ct->ct_n = ct->ct_norder = n;
+	free(ok);
+
+	return ct;
+
+bail:
+	free(ok);
+	ctab_free(ct);
+	return NULL;
+}
+
 void
-cand_ins_minp(cand_list_t *head, cand_t *cand) {
-	if (cand_list_empty(head)) {
-		cand_insert_head(head, cand);
+ctab_free(ctab_t *ct) {
+	if (!ct) {
 		return;
 	}
-	cand_t *next, *prev = NULL;
-	for (next = cand_first(head); next; next = cand_next(next)) {
-		prev = next;
-		if (next->c_delta_l > cand->c_delta_l) {
-			cand_insert_after(next, cand);
-			return;
+	free(ct->ct_a);
+	free(ct->ct_b);
+	free(ct->ct_delta_c);
+	free(ct->ct_delta_l);
+	free(ct->ct_order);
+	free(ct);
+}
+
+/**
+ * Sort keys of the candidates, the best candidate has the lowest key
+ */
+static uint32_t*
+ctab_keys(ctab_t *ct, enum corder order) {
+	uint32_t *key = malloc((ct->ct_n ? ct->ct_n : 1) * sizeof(uint32_t));
+	if (!key) {
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < ct->ct_n; i++) {
+		switch (order) {
+		case CORDER_MAXB:
+			/* Decreasing delta_c, flip the sign bit to compare
+			 * the deltas as unsigned */
+			key[i] = ~((uint32_t) ct->ct_delta_c[i] ^ 0x80000000u);
+			break;
+		case CORDER_MINP:
+			key[i] = ~((uint32_t) ct->ct_delta_l[i] ^ 0x80000000u);
+			break;
+		default:
+			/* Last found first */
+			key[i] = ct->ct_n - 1 - i;
+			break;
 		}
 	}
-	cand_insert_after(prev, cand);
+
+	return key;
 }
 
+int
+ctab_sort(ctab_t *ct, enum corder order) {
+	uint32_t *key = ctab_keys(ct, order);
+	uint32_t *tmp = malloc((ct->ct_n ? ct->ct_n : 1) * sizeof(uint32_t));
+	int rv = 0;
 
-cand_list_t*
-corder_arb(dtask_t *task) {
-	cand_list_t *list = cand_list_alloc();
-	cand_t *next = NULL;
+	if (!key || !tmp) {
+		goto bail;
+	}
+	for (uint32_t i = 0; i < ct->ct_n; i++) {
+		ct->ct_order[i] = i;
+	}
 
-	while(next = task_cand_next(task, next)) {
-		cand_t *copy = cand_copy(next);
-		if (!dag_can_collapse(copy->c_a, copy->c_b)) {
-			cand_free(copy);
+	/* LSD radix sort on bytes, stable, so ties stay in task order */
+	uint32_t *from = ct->ct_order, *to = tmp;
+	for (int shift = 0; ct->ct_n && shift < 32; shift += 8) {
+		uint32_t count[257] = { 0 };
+		for (uint32_t i = 0; i < ct->ct_n; i++) {
+			count[((key[from[i]] >> shift) & 0xff) + 1]++;
+		}
+		if (count[((key[from[0]] >> shift) & 0xff) + 1] == ct->ct_n) {
+			/* All the same byte */
 			continue;
 		}
-		cand_insert_head(list, copy);
+		for (int d = 0; d < 256; d++) {
+			count[d + 1] += count[d];
+		}
+		for (uint32_t i = 0; i < ct->ct_n; i++) {
+			to[count[(key[from[i]] >> shift) & 0xff]++] = from[i];
+		}
+		uint32_t *swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != ct->ct_order) {
+		memcpy(ct->ct_order, from, ct->ct_n * sizeof(uint32_t));
 	}
+	ct->ct_norder = ct->ct_n;
+	rv = 1;
 
-	return list;
+bail:
+	free(key);
+	free(tmp);
+	return rv;
 }
 
+/**
+ * Non-zero if candidate i goes after candidate j
+ */
+static inline int
+ctab_after(uint32_t *key, uint32_t i, uint32_t j) {
+	return key[i] > key[j] || (key[i] == key[j] && i > j);
+}
 
+/**
+ * Restores the heap property below position at, the root of the heap
+ * is the candidate that goes last
+ */
+static void
+ctab_sift(uint32_t *heap, uint32_t n, uint32_t *key, uint32_t at) {
+	for (;;) {
+		uint32_t last = at;
+		uint32_t l = 2 * at + 1, r = 2 * at + 2;
+		if (l < n && ctab_after(key, heap[l], heap[last])) {
+			last = l;
+		}
+		if (r < n && ctab_after(key, heap[r], heap[last])) {
+			last = r;
+		}
+		if (last == at) {
+			return;
+		}
+		uint32_t swap = heap[at];
+		heap[at] = heap[last];
+		heap[last] = swap;
+		at = last;
+	}
+}
+
+int
+ctab_top(ctab_t *ct, enum corder order, uint32_t k) {
+	uint32_t *key = ctab_keys(ct, order);
+	uint32_t *heap = ct->ct_order;
+	uint32_t n = 0;
+
+	if (!key) {
+		return 0;
+	}
+	if (k > ct->ct_n) {
+		k = ct->ct_n;
+	}
+
+	/* Keep the k first candidates, the last of them at the root */
+	for (uint32_t i = 0; i < ct->ct_n && k; i++) {
+		if (n < k) {
+			heap[n] = i;
+			for (uint32_t at = n++; at; at = (at - 1) / 2) {
+				uint32_t up = (at - 1) / 2;
+				if (!ctab_after(key, heap[at], heap[up])) {
+					break;
+				}
+				uint32_t swap = heap[at];
+				heap[at] = heap[up];
+				heap[up] = swap;
+			}
+		} else if (ctab_after(key, heap[0], i)) {
+			heap[0] = i;
+			ctab_sift(heap, n, key, 0);
+		}
+	}
+
+	/* Heap sort, the last one goes to the end */
+	for (uint32_t m = n; m > 1; m--) {
+		uint32_t swap = heap[0];
+		heap[0] = heap[m - 1];
+		heap[m - 1] = swap;
+		ctab_sift(heap, m - 1, key, 0);
+	}
+	ct->ct_norder = n;
+	free(key);
+
+	return 1;
+}
 
 cand_list_t*
-corder_maxb(dtask_t *task) {
+ctab_list(ctab_t *ct) {
 	cand_list_t *list = cand_list_alloc();
-	cand_t *next = NULL;
+	cand_t *last = NULL;
 
-	while(next = task_cand_next(task, next)) {
-		cand_t *copy = cand_copy(next);
-		if (!dag_can_collapse(copy->c_a, copy->c_b)) {
-			cand_free(copy);
-			continue;
+	if (!list) {
+		return NULL;
+	}
+	for (uint32_t i = 0; i < ct->ct_norder; i++) {
+		uint32_t c = ct->ct_order[i];
+		cand_t *cand = cand_alloc();
+		cand->c_a = dnode_alloc("");
+		cand->c_b = dnode_alloc("");
+		dtask_node_load(ct->ct_task, ct->ct_a[c], cand->c_a);
+		dtask_node_load(ct->ct_task, ct->ct_b[c], cand->c_b);
+		cand->c_delta_c = ct->ct_delta_c[c];
+		cand->c_delta_l = ct->ct_delta_l[c];
+		if (last) {
+			cand_insert_after(last, cand);
+		} else {
+			cand_insert_head(list, cand);
 		}
-		copy->c_delta_c = cand_delta_c(copy);
-		cand_ins_maxb(list, copy);
+		last = cand;
 	}
 
-	
 	return list;
 }
-cand_list_t* corder_minp(dtask_t *task) {
-	cand_list_t *list = cand_list_alloc();
-	cand_t *next = NULL;
 
-	while(next = task_cand_next(task, next)) {
-		cand_t *copy = cand_copy(next);
-		if (!dag_can_collapse(copy->c_a, copy->c_b)) {
-			cand_free(copy);
-			continue;
+int
+ctab_write(ctab_t *ct, FILE *file) {
+	char **name = ct->ct_task->dt_nname;
+
+	for (uint32_t i = 0; i < ct->ct_norder; i++) {
+		uint32_t c = ct->ct_order[i];
+		if (fprintf(file, "%s %s\n", name[ct->ct_a[c]],
+		    name[ct->ct_b[c]]) < 0) {
+			return 0;
 		}
-		copy->c_delta_l = cand_delta_l(copy);		
-		cand_ins_minp(list, copy);
 	}
+
+	return 1;
+}
+
+/**
+ * Candidate list of the task in the order of the heuristic
+ */
+static cand_list_t*
+corder(dtask_t *task, enum corder order, int deltas, int jobs) {
+	ctab_t *ct = ctab_build(task, deltas, jobs);
+	cand_list_t *list = NULL;
+
+	if (ct && ctab_sort(ct, order)) {
+		list = ctab_list(ct);
+	}
+	ctab_free(ct);
+
 	return list;
 }
+
+cand_list_t*
+corder_arb(dtask_t *task, int jobs) {
+	return corder(task, CORDER_ARB, 0, jobs);
+}
+
+cand_list_t*
+corder_maxb(dtask_t *task, int jobs) {
+	return corder(task, CORDER_MAXB, CTAB_DELTA_C, jobs);
+}
+
+cand_list_t*
+corder_minp(dtask_t *task, int jobs) {
+	return corder(task, CORDER_MINP, CTAB_DELTA_L, jobs);
+}
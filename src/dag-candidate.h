@@ -24,15 +24,31 @@ cand_list_t *cand_list_free(cand_list_t *head);
 /**
  * Generates the name of the candidate
  *
- * Must not be free()'d or reused by the caller
+ * The name lives in a buffer of the calling thread, it must not be
+ * free()'d and is overwritten by the next call in the same thread.
  */
 char* cand_name(cand_t *c);
 
+/**
+ * Generates the name of the candidate into a caller buffer
+ *
+ * @param[in] c the candidate
+ * @param[out] buff the buffer, truncated names are still terminated
+ * @param[in] len the size of buff
+ *
+ * @return buff
+ */
+char* cand_name_r(cand_t *c, char *buff, size_t len);
+
 /**
  * Gets the next candidate from the task
  *
+ * Candidates pair the first node of each object with the other nodes
+ * of the object, in id order. The current candidate is reused for the
+ * next one, and released when there is none.
+ *
  * @param[in] task the dag task
- * @param[in] c the current candidate
+ * @param[in] c the current candidate, NULL for the first one
  *
  * @return the next candidate if one exists, NULL otherwise
  */
@@ -109,22 +125,6 @@ cand_t* task_cand_next(dtask_t* task, cand_t *c);
  */
 #define cand_next(elem) LIST_NEXT(elem, cand_glue)
 
-/**
- * Insert an element into the candidate list in decreasing delta_c order
- *
- * @param[in] head of the candidate list
- * @param[in] cand the element being added
- */
-void cand_ins_maxb(cand_list_t *head, cand_t *cand);
-
-/**
- * Insert an element into the candidate list in increasing delta_l order
- *
- * @param[in] head of the candidate list
- * @param[in] cand the element being added
- */
-void cand_ins_minp(cand_list_t *head, cand_t *cand);
-
 /**
  * Removes all candidates from the list, each of the candidates is
  * cand_free()'d 
@@ -183,8 +183,114 @@ int cand_delta_l(cand_t *cand);
  */
 int cand_delta_c(cand_t *cand);
 
-cand_list_t* corder_arb(dtask_t *task);
-cand_list_t* corder_maxb(dtask_t *task);
-cand_list_t* corder_minp(dtask_t *task);
+/**
+ * Calculate the change in workload for all the candidates of a list,
+ * sets c_delta_c of each of them
+ *
+ * Requires dag_can_collapse has been called for each candidate
+ *
+ * @param[in|out] head the candidate list
+ *
+ * @return the number of candidates, -1 if memory ran out
+ */
+int cand_delta_c_list(cand_list_t *head);
+
+/** Heuristics ordering the candidates */
+enum corder {
+	CORDER_ARB,	/**< arbitrary, the last found first */
+	CORDER_MAXB,	/**< max benefit, decreasing delta_c */
+	CORDER_MINP,	/**< min penalty, decreasing delta_l */
+};
+
+/** Deltas scored by ctab_build() */
+#define CTAB_DELTA_C	0x1
+#define CTAB_DELTA_L	0x2
+
+/**
+ * Table of the candidates of a task that can collapse
+ *
+ * The candidates are parallel arrays of node ids and deltas in the
+ * order of the task, ct_order holds the first ct_norder of them in
+ * the order of a heuristic, see ctab_sort() and ctab_top().
+ *
+ * Usage:
+ *    ctab_t *ct = ctab_build(task, CTAB_DELTA_C, 1);
+ *    ctab_sort(ct, CORDER_MAXB);
+ *    for (uint32_t i = 0; i < ct->ct_norder; i++) {
+ *        uint32_t c = ct->ct_order[i];
+ *        ... ct->ct_a[c], ct->ct_b[c], ct->ct_delta_c[c] ...
+ *    }
+ *    ctab_free(ct);
+ */
+typedef struct ctab {
+	dtask_t	*ct_task;	/**< the task of the nodes */
+	dnid_t	*ct_a;		/**< first node of each candidate */
+	dnid_t	*ct_b;		/**< second node of each candidate */
+	int	*ct_delta_c;	/**< workload change, see cand_delta_c() */
+	int	*ct_delta_l;	/**< critical path length change */
+	uint32_t *ct_order;	/**< candidates in heuristic order */
+	uint32_t ct_n;		/**< number of candidates */
+	uint32_t ct_norder;	/**< number of candidates in ct_order */
+} ctab_t;
+
+/**
+ * Builds the table of the candidates of the task that can collapse
+ *
+ * The candidates are scored by jobs worker threads, each on its own
+ * copy of the task, the table is the same for any number of jobs.
+ * ct_order is the order of the task.
+ *
+ * @param[in] task the dag task, must outlive the table
+ * @param[in] deltas CTAB_DELTA_C and/or CTAB_DELTA_L to score
+ * @param[in] jobs number of worker threads, 1 or less scores the
+ *	candidates in the calling thread
+ *
+ * @return the table, NULL if memory ran out
+ */
+ctab_t *ctab_build(dtask_t *task, int deltas, int jobs);
+void ctab_free(ctab_t *ct);
+
+/**
+ * Orders all the candidates of the table by a heuristic, ties are
+ * kept in the order of the task
+ *
+ * @return non-zero on success, zero if memory ran out
+ */
+int ctab_sort(ctab_t *ct, enum corder order);
+
+/**
+ * Orders the k best candidates of the table by a heuristic, the same
+ * as the first k of ctab_sort() in O(n log k)
+ *
+ * @return non-zero on success, zero if memory ran out
+ */
+int ctab_top(ctab_t *ct, enum corder order, uint32_t k);
+
+/**
+ * Candidate list of the ordered candidates of the table
+ *
+ * @return the list, NULL if memory ran out
+ */
+cand_list_t *ctab_list(ctab_t *ct);
+
+/**
+ * Writes the ordered candidates of the table, one "a b" line per
+ * candidate, as read by dts-collapse-list
+ *
+ * @return non-zero on success, zero otherwise
+ */
+int ctab_write(ctab_t *ct, FILE *file);
+
+/**
+ * Candidate lists of the task ordered by a heuristic, see enum corder
+ *
+ * @param[in] task the dag task
+ * @param[in] jobs number of worker threads, see ctab_build()
+ *
+ * @return the candidate list, NULL if memory ran out
+ */
+cand_list_t* corder_arb(dtask_t *task, int jobs);
+cand_list_t* corder_maxb(dtask_t *task, int jobs);
+cand_list_t* corder_minp(dtask_t *task, int jobs);
 
 #endif /* DAG_CANDIDATE_H */
@@ -1,49 +1,20 @@
-#include "dag-collapse.h"
-
-extern void agnode_to_dnode(Agnode_t *src, dnode_t *dst);
+#include <math.h>
 
-static tint_t
-fact(tint_t n) {
-	tint_t rv = 1;
-	for (tint_t i = n ; i > 1 ; --i) {
-		rv *= i;
-	}
-	return rv;
-}
+#include "dag-collapse.h"
+#include "dag-candidate.h"
 
-int
+uint64_t
 dtask_count_cand(dtask_t *task) {
-	Agnode_t *agnext;
-
-	int max = dtask_max_object(task) + 1;
-	int *obj = calloc(max, sizeof(max));
-
-	for (agnext = agfstnode(task->dt_graph); agnext;
-	     agnext = agnxtnode(task->dt_graph, agnext)) {
-		dnode_t* node = dnode_alloc(agnameof(agnext));
-		agnode_to_dnode(agnext, node);
-		int idx = node->dn_object;
-		obj[idx] += 1;
-		dnode_free(node);
-	}
-	int total = 0;
-	for (int i=0; i < max; i++) {
-		/*
-		 * Combinations per object:
-		 * / n \      k!
-		 * |   | = -------
-		 * \ k /   2! * (k - 2)!
-		 *
-		 */
-		if (obj[i] <= 1) {
-			continue;
+	uint64_t total = 0;
+	int max = dtask_max_object(task);
+
+	for (int i = 0; i <= max; i++) {
+		/* Pairs of the k nodes of the object, k choose 2 */
+		uint64_t k = dtask_obj_count(task, i);
+		if (k > 1) {
+			total += k * (k - 1) / 2;
 		}
-		int count = obj[i];
-		tint_t numer = fact(count);
-		tint_t denom = 2 * fact(count - 2);
-		total += numer / denom;
 	}
-	free(obj);
 	return total;
 }
 
@@ -53,23 +24,12 @@ dag_can_collapse(dnode_t *a, dnode_t *b) {
 	if (dnode_get_object(a) != dnode_get_object(b)) {
 		return 0;
 	}
-	int rv = 0;
-
-	dnode_t *cp_a = dnode_copy(a);
-	dnode_t *cp_b = dnode_copy(b);
-
-	if (dag_pathlen(a, b) > 2) {
-		goto bail;
-	}
-	if (dag_pathlen(b, a) > 2) {
-		goto bail;
+	/* A longer path between the nodes would become a cycle */
+	if (dag_far_path(a, b) || dag_far_path(b, a)) {
+		return 0;
 	}
 
-	rv = 1;
-bail:
-	dnode_free(cp_a);
-	dnode_free(cp_b);	
-	return rv;
+	return 1;
 }
 
 
@@ -116,9 +76,461 @@ dag_collapse(dnode_t* a, dnode_t* b) {
 	dnl_clear(preds_b); free(preds_b);	
 	dnl_clear(succs); free(succs);
 	dnl_clear(succs_b); free(succs_b);
+	dnode_free(n);
 
 	/* Update the task */
 	dtask_update(task);
 
 	return 1;
 }
+
+/** A scored candidate */
+typedef struct dcgain {
+	float_t	dg_gain;	/**< decrease of the cores */
+	dnid_t	dg_a;		/**< first node */
+	dnid_t	dg_b;		/**< second node */
+	tint_t	dg_dc;		/**< decrease of the workload, C */
+	tint_t	dg_post_l;	/**< L after the collapse */
+	tint_t	dg_l;		/**< L when dg_post_l was found */
+	uint32_t dg_scored;	/**< number of collapses when scored */
+	uint32_t dg_epoch;	/**< number of collapses when dg_gain was found */
+} dcgain_t;
+
+/** Binary max heap of the gains */
+typedef struct dcheap {
+	dcgain_t *dh_elem;
+	uint32_t dh_n;
+	uint32_t dh_cap;
+} dcheap_t;
+
+/**
+ * State of dag_collapse_all()
+ *
+ * The L after a collapse depends on the longest paths to the
+ * predecessors and from the successors of the two nodes and, when one
+ * of them is critical, on every critical path of the task. After each
+ * collapse the nodes for which any of these may have changed are
+ * stamped, and only the candidates of stamped nodes are scored again.
+ */
+typedef struct dcstate {
+	dtask_t	*ds_task;
+	dcheap_t ds_heap;
+	uint32_t ds_epoch;	/**< number of collapses */
+	int	ds_scored;	/**< number of candidates scored */
+	dnid_t	ds_nids;	/**< ids seen, the arrays below are this long */
+	dnid_t	ds_cap;
+	uint32_t *ds_stamp;	/**< collapses when the node last changed */
+	tint_t	*ds_dist;	/**< dt_distance of the node at the stamp */
+	tint_t	*ds_tail;	/**< dt_tail of the node at the stamp */
+	uint8_t	*ds_crit;	/**< the node was on a critical path */
+} dcstate_t;
+
+/**
+ * Non-zero if x comes out of the heap before y, ties are broken by
+ * the ids so the collapses do not depend on the heap layout
+ */
+static inline int
+dcgain_before(dcgain_t *x, dcgain_t *y) {
+	if (x->dg_gain != y->dg_gain) {
+		return x->dg_gain > y->dg_gain;
+	}
+	if (x->dg_a != y->dg_a) {
+		return x->dg_a < y->dg_a;
+	}
+	return x->dg_b < y->dg_b;
+}
+
+static int
+dcheap_push(dcheap_t *heap, dcgain_t *g) {
+	if (heap->dh_n == heap->dh_cap) {
+		uint32_t cap = heap->dh_cap ? 2 * heap->dh_cap : 256;
+		dcgain_t *elem = realloc(heap->dh_elem, cap * sizeof(dcgain_t));
+		if (!elem) {
+			return 0;
+		}
+		heap->dh_elem = elem;
+		heap->dh_cap = cap;
+	}
+
+	dcgain_t *e = heap->dh_elem;
+	uint32_t at = heap->dh_n++;
+	while (at && dcgain_before(g, &e[(at - 1) / 2])) {
+		e[at] = e[(at - 1) / 2];
+		at = (at - 1) / 2;
+	}
+	e[at] = *g;
+
+	return 1;
+}
+
+/**
+ * Places g at or below at, the subtrees under at must be heaps
+ */
+static void
+dcheap_down(dcheap_t *heap, uint32_t at, dcgain_t *g) {
+	dcgain_t *e = heap->dh_elem;
+	uint32_t n = heap->dh_n;
+
+	for (;;) {
+		uint32_t c = 2 * at + 1;
+		if (c >= n) {
+			break;
+		}
+		if (c + 1 < n && dcgain_before(&e[c + 1], &e[c])) {
+			c++;
+		}
+		if (!dcgain_before(&e[c], g)) {
+			break;
+		}
+		e[at] = e[c];
+		at = c;
+	}
+	e[at] = *g;
+}
+
+static void
+dcheap_pop(dcheap_t *heap, dcgain_t *g) {
+	dcgain_t last;
+
+	*g = heap->dh_elem[0];
+	last = heap->dh_elem[--heap->dh_n];
+	dcheap_down(heap, 0, &last);
+}
+
+/**
+ * The cores of a task with workload C, critical path length L and
+ * deadline D, as dtask_coresf()
+ */
+static float_t
+dag_cores_of(tint_t C, tint_t L, tint_t D) {
+	float_t rv = ((float_t) C - L) / ((float_t) D - L);
+
+	return rv < 0 ? 0 : rv;
+}
+
+static inline int
+dag_collapse_crit(dtask_t *task, dnid_t id) {
+	return task->dt_distance[id] + task->dt_tail[id] -
+	    task->dt_wcet[id] == task->dt_cpathlen;
+}
+
+/**
+ * Makes room for the ids handed out since the last call, the new
+ * nodes are stamped with the current number of collapses
+ */
+static int
+dag_collapse_grow(dcstate_t *ds) {
+	dtask_t *task = ds->ds_task;
+	dnid_t nids = task->dt_nids;
+
+	if (nids > ds->ds_cap) {
+		dnid_t cap = ds->ds_cap ? 2 * ds->ds_cap : 64;
+		while (cap < nids) {
+			cap *= 2;
+		}
+		uint32_t *stamp = realloc(ds->ds_stamp, cap * sizeof(uint32_t));
+		if (!stamp) {
+			return 0;
+		}
+		ds->ds_stamp = stamp;
+		tint_t *dist = realloc(ds->ds_dist, cap * sizeof(tint_t));
+		if (!dist) {
+			return 0;
+		}
+		ds->ds_dist = dist;
+		tint_t *tail = realloc(ds->ds_tail, cap * sizeof(tint_t));
+		if (!tail) {
+			return 0;
+		}
+		ds->ds_tail = tail;
+		uint8_t *crit = realloc(ds->ds_crit, cap * sizeof(uint8_t));
+		if (!crit) {
+			return 0;
+		}
+		ds->ds_crit = crit;
+		ds->ds_cap = cap;
+	}
+	for (dnid_t id = ds->ds_nids; id < nids; id++) {
+		ds->ds_stamp[id] = ds->ds_epoch;
+		ds->ds_dist[id] = ds->ds_tail[id] = 0;
+		ds->ds_crit[id] = 0;
+		if (dtask_node_live(task, id)) {
+			ds->ds_dist[id] = task->dt_distance[id];
+			ds->ds_tail[id] = task->dt_tail[id];
+			ds->ds_crit[id] = dag_collapse_crit(task, id);
+		}
+	}
+	ds->ds_nids = nids;
+
+	return 1;
+}
+
+/**
+ * Stamps the predecessors and successors of a node, whose edges are
+ * about to change
+ */
+static void
+dag_collapse_touch(dcstate_t *ds, dnid_t id, uint32_t stamp) {
+	dtask_t *task = ds->ds_task;
+	dnid_t *preds = dtask_preds(task, id);
+	dnid_t *succs = dtask_succs(task, id);
+
+	for (uint32_t i = 0; i < dtask_indeg(task, id); i++) {
+		ds->ds_stamp[preds[i]] = stamp;
+	}
+	for (uint32_t i = 0; i < dtask_outdeg(task, id); i++) {
+		ds->ds_stamp[succs[i]] = stamp;
+	}
+}
+
+/**
+ * Stamps the nodes whose candidates may score differently after a
+ * collapse: those whose longest paths changed and their neighbours,
+ * and those on a critical path before or after it
+ */
+static int
+dag_collapse_stamp(dcstate_t *ds) {
+	dtask_t *task = ds->ds_task;
+	dnid_t id;
+
+	if (!dtask_paths(task) || !dag_collapse_grow(ds)) {
+		return 0;
+	}
+	dtask_foreach_id(task, id) {
+		int crit = dag_collapse_crit(task, id);
+		if (crit || ds->ds_crit[id]) {
+			ds->ds_stamp[id] = ds->ds_epoch;
+		}
+		if (task->dt_distance[id] != ds->ds_dist[id] ||
+		    task->dt_tail[id] != ds->ds_tail[id]) {
+			ds->ds_stamp[id] = ds->ds_epoch;
+			dag_collapse_touch(ds, id, ds->ds_epoch);
+		}
+		ds->ds_dist[id] = task->dt_distance[id];
+		ds->ds_tail[id] = task->dt_tail[id];
+		ds->ds_crit[id] = crit;
+	}
+
+	return 1;
+}
+
+/**
+ * Finds the gain of a candidate against the current C and L
+ */
+static void
+dag_collapse_gain(dcstate_t *ds, dcgain_t *g) {
+	dtask_t *task = ds->ds_task;
+	tint_t C = dtask_workload(task);
+	tint_t L = dtask_cpathlen(task);
+	tint_t D = task->dt_deadline;
+
+	g->dg_gain = dag_cores_of(C, L, D) -
+	    dag_cores_of(C - g->dg_dc, g->dg_post_l, D);
+	if (g->dg_post_l > D || isnan(g->dg_gain)) {
+		g->dg_gain = -INFINITY;
+	}
+	g->dg_epoch = ds->ds_epoch;
+}
+
+/**
+ * Scores the collapse of a and b against the current task
+ *
+ * @return non-zero if a and b can be collapsed, zero otherwise
+ */
+static int
+dag_collapse_score(dcstate_t *ds, dcgain_t *g) {
+	dtask_t *task = ds->ds_task;
+	dnode_t a, b;
+	cand_t cand = { .c_a = &a, .c_b = &b };
+
+	dtask_node_load(task, g->dg_a, &a);
+	dtask_node_load(task, g->dg_b, &b);
+	/* cand_delta_l() assumes there is no longer path between them */
+	if (!dag_can_collapse(&a, &b)) {
+		return 0;
+	}
+	g->dg_l = dtask_cpathlen(task);
+	g->dg_dc = cand_delta_c(&cand);
+	g->dg_post_l = g->dg_l - cand_delta_l(&cand);
+	g->dg_scored = ds->ds_epoch;
+	ds->ds_scored++;
+	dag_collapse_gain(ds, g);
+
+	return 1;
+}
+
+/**
+ * Brings a candidate scored before the last collapse up to date
+ *
+ * @return non-zero if it is still a candidate, zero otherwise
+ */
+static int
+dag_collapse_refresh(dcstate_t *ds, dcgain_t *g) {
+	dtask_t *task = ds->ds_task;
+
+	if (!dtask_node_live(task, g->dg_a) ||
+	    !dtask_node_live(task, g->dg_b)) {
+		/* One of them has been collapsed */
+		return 0;
+	}
+	if (ds->ds_stamp[g->dg_a] > g->dg_scored ||
+	    ds->ds_stamp[g->dg_b] > g->dg_scored) {
+		return dag_collapse_score(ds, g);
+	}
+
+	/*
+	 * Neither node is critical and the paths around them are the
+	 * same, L after the collapse is the longer of L and the path
+	 * through the collapsed node
+	 */
+	tint_t L = dtask_cpathlen(task);
+	if (L != g->dg_l) {
+		if (g->dg_post_l > g->dg_l) {
+			/* The path through the collapsed node */
+			g->dg_post_l = g->dg_post_l > L ? g->dg_post_l : L;
+		} else if (g->dg_post_l == g->dg_l && L > g->dg_l) {
+			g->dg_post_l = L;
+		} else {
+			/* The path through the collapsed node is unknown */
+			return dag_collapse_score(ds, g);
+		}
+		g->dg_l = L;
+	}
+	dag_collapse_gain(ds, g);
+
+	return 1;
+}
+
+/**
+ * Brings every queued candidate up to date and restores the heap,
+ * the candidates of stamped nodes are scored again and the others only
+ * have their gain recomputed, see dag_collapse_refresh()
+ */
+static void
+dag_collapse_sweep(dcstate_t *ds) {
+	dcheap_t *heap = &ds->ds_heap;
+	uint32_t n = 0;
+
+	for (uint32_t i = 0; i < heap->dh_n; i++) {
+		dcgain_t g = heap->dh_elem[i];
+		if (g.dg_epoch == ds->ds_epoch || dag_collapse_refresh(ds, &g)) {
+			heap->dh_elem[n++] = g;
+		}
+	}
+	heap->dh_n = n;
+	for (uint32_t i = n / 2; i-- > 0;) {
+		dcgain_t g = heap->dh_elem[i];
+		dcheap_down(heap, i, &g);
+	}
+}
+
+static int
+dag_collapse_push(dcstate_t *ds, dnid_t a, dnid_t b) {
+	dcgain_t g = { .dg_a = a, .dg_b = b };
+
+	if (!dag_collapse_score(ds, &g)) {
+		/* Never a candidate, paths between nodes are not removed */
+		return 1;
+	}
+
+	return dcheap_push(&ds->ds_heap, &g);
+}
+
+/**
+ * Scores and queues the candidates of the task, the nodes of each
+ * object in pairs as the first of them would be collapsed
+ */
+static int
+dag_collapse_queue(dcstate_t *ds) {
+	dtask_t *task = ds->ds_task;
+
+	for (int o = 0; o <= dtask_max_object(task); o++) {
+		dnid_t a, b;
+		for (a = dtask_obj_first(task, o); a != DNID_NONE;
+		     a = dtask_obj_next(task, a)) {
+			for (b = dtask_obj_next(task, a); b != DNID_NONE;
+			     b = dtask_obj_next(task, b)) {
+				if (!dag_collapse_push(ds, a, b)) {
+					return 0;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+int
+dag_collapse_all(dtask_t *task, dcollapse_stat_t *stat) {
+	dcstate_t ds = { .ds_task = task };
+	dcgain_t g;
+	int rv = -1;
+
+	if (!dtask_paths(task) || !dag_collapse_grow(&ds) ||
+	    !dag_collapse_queue(&ds)) {
+		goto bail;
+	}
+
+	while (ds.ds_heap.dh_n) {
+		/* Every queued gain is up to date, the top is the best */
+		dcheap_pop(&ds.ds_heap, &g);
+		if (!(g.dg_gain > 0)) {
+			/* The best candidate is not beneficial */
+			break;
+		}
+
+		dnode_t *a = dtask_node_at(task, g.dg_a);
+		dnode_t *b = dtask_node_at(task, g.dg_b);
+		int collapsed = 0;
+		dnid_t nids = task->dt_nids;
+		if (dag_can_collapse(a, b)) {
+			dag_collapse_touch(&ds, g.dg_a, ds.ds_epoch + 1);
+			dag_collapse_touch(&ds, g.dg_b, ds.ds_epoch + 1);
+			collapsed = dag_collapse(a, b);
+		}
+		dnode_free(a);
+		dnode_free(b);
+		if (!collapsed) {
+			/* Paths between nodes are never removed, drop it */
+			continue;
+		}
+		task->dt_collapsed++;
+		ds.ds_epoch++;
+		if (!dag_collapse_stamp(&ds)) {
+			goto bail;
+		}
+		/* C and L changed, and with them the gain of every pair */
+		dag_collapse_sweep(&ds);
+		if (task->dt_nids == nids) {
+			/* The name of the collapsed node was taken */
+			continue;
+		}
+
+		/* The collapsed node is the last one inserted, and the last
+		 * of its object */
+		dnid_t n = task->dt_nids - 1;
+		dnid_t o;
+		for (o = dtask_obj_first(task, task->dt_object[n]); o != n;
+		     o = dtask_obj_next(task, o)) {
+			if (!dag_collapse_push(&ds, o, n)) {
+				goto bail;
+			}
+		}
+	}
+	rv = ds.ds_epoch;
+
+	if (stat) {
+		stat->dcs_collapses = ds.ds_epoch;
+		stat->dcs_scored = ds.ds_scored;
+		stat->dcs_cpathlen = dtask_cpathlen(task);
+		stat->dcs_workload = dtask_workload(task);
+		stat->dcs_cores = dtask_coresf(task);
+	}
+bail:
+	free(ds.ds_heap.dh_elem);
+	free(ds.ds_stamp);
+	free(ds.ds_dist);
+	free(ds.ds_tail);
+	free(ds.ds_crit);
+	return rv;
+}
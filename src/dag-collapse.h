@@ -14,7 +14,7 @@
  *
  * @return the number of candidates in the task
  */
-int dtask_count_cand(dtask_t *task);
+uint64_t dtask_count_cand(dtask_t *task);
 
 /**
  * Returns true if the two nodes can be collapsed
@@ -39,14 +39,35 @@ int dag_can_collapse(dnode_t *a, dnode_t *b);
  */
 int dag_collapse(dnode_t *a, dnode_t *b);
 
+/** Outcome of dag_collapse_all() */
+typedef struct dcollapse_stat {
+	int	dcs_collapses;	/**< number of collapses */
+	int	dcs_scored;	/**< number of candidates scored */
+	tint_t	dcs_cpathlen;	/**< final critical path length, L */
+	tint_t	dcs_workload;	/**< final workload, C */
+	float_t	dcs_cores;	/**< final cores, m, see dtask_coresf() */
+} dcollapse_stat_t;
+
 /**
- * Collapses all candidates in a task
+ * Collapses the candidates of a task greedily
+ *
+ * Repeatedly collapses the candidate with the largest decrease of
+ * dtask_coresf() that keeps L <= D, until no candidate decreases it.
+ * Pairs with a path of more than one edge between them are never
+ * candidates. The gains are kept in a priority queue. After every
+ * collapse C and L change, so every queued gain is brought up to date
+ * before the next candidate is taken: a candidate is only scored again
+ * if the longest paths around its nodes changed or one of them is
+ * critical, the others have their gain recomputed for the new C and L
+ * in O(1). The candidates of a collapsed node are dropped and those of
+ * the new node are added. Ties are broken by the lower ids.
  *
  * @param[in] task the dag task
+ * @param[out] stat the outcome, may be NULL
  *
- * @return the number of collapses
+ * @return the number of collapses, -1 if memory ran out
  */
-int dag_collapse_all(dtask_t *task);
+int dag_collapse_all(dtask_t *task, dcollapse_stat_t *stat);
 
 
 
@@ -1,14 +1,16 @@
 #include "dag-dfs.h"
 
-ddo_t
-ddfs(dnode_t *cursor, ddfs_pre pre, ddfs_visit visit, ddfs_post post,
-     void *ud) {
+/**
+ * Pre-visit and visit of a node about to be pushed on the stack
+ */
+static ddo_t
+ddfs_enter(dtask_t *task, dnid_t id, ddfs_id_pre pre, ddfs_id_visit visit,
+	   void *ud) {
 	ddo_t op = DFS_GOOD;
-	int rv=1;
 
 	/* Pre-visit callback */
 	if (pre) {
-		op = pre(cursor, ud);
+		op = pre(task, id, ud);
 	}
 	switch (op) {
 	case DFS_ERR:
@@ -22,7 +24,7 @@ ddfs(dnode_t *cursor, ddfs_pre pre, ddfs_visit visit, ddfs_post post,
 
 	/* Visit this node */
 	if (visit) {
-		op = visit(cursor, ud);
+		op = visit(task, id, ud);
 	}
 	switch (op) {
 	case DFS_ERR:
@@ -33,34 +35,138 @@ ddfs(dnode_t *cursor, ddfs_pre pre, ddfs_visit visit, ddfs_post post,
 		break;
 	}
 
-	dedge_t *e;
-	for (e = dedge_out_first(cursor); e; e = dedge_out_next(e)) {
-		char *dname = e->de_dname;
-		dnode_t *child = dtask_name_search(cursor->dn_task, dname);
-		op = ddfs(child, pre, visit, post, ud);
-		dnode_free(child);
-		switch (op) {
-		case DFS_ERR:
-			return DFS_ERR;
-		case DFS_SKIP:
-		case DFS_GOOD:
-			break;
-			/* Continue */
+	return DFS_GOOD;
+}
+
+ddo_t
+ddfs_id(dtask_t *task, dnid_t id, ddfs_id_pre pre, ddfs_id_visit visit,
+	ddfs_id_post post, void *ud) {
+	dnid_t *stack = task->dt_dfs;
+	uint32_t *next = task->dt_dfs_next;
+	int nested = task->dt_flags.indfs;
+	ddo_t rv = DFS_GOOD;
+
+	if (!dtask_node_live(task, id)) {
+		return DFS_ERR;
+	}
+	if (nested) {
+		/* The stack of the task is taken by an outer search */
+		stack = malloc(task->dt_nids * sizeof(dnid_t));
+		next = malloc(task->dt_nids * sizeof(uint32_t));
+		if (!stack || !next) {
+			rv = DFS_ERR;
+			goto bail;
 		}
 	}
+	task->dt_flags.indfs = 1;
 
-	/* Post-visit callback */
-	if (post) {
-		op = post(cursor, ud);
+	rv = ddfs_enter(task, id, pre, visit, ud);
+	if (rv != DFS_GOOD) {
+		goto bail;
 	}
-	switch (op) {
-	case DFS_ERR:
+	dnid_t top = 0;
+	stack[top] = id;
+	next[top] = 0;
+	top++;
+
+	while (top) {
+		dnid_t cur = stack[top - 1];
+		if (next[top - 1] < dtask_outdeg(task, cur)) {
+			dnid_t child = dtask_succs(task, cur)[next[top - 1]++];
+			ddo_t op = ddfs_enter(task, child, pre, visit, ud);
+			if (op == DFS_ERR) {
+				rv = DFS_ERR;
+				goto bail;
+			}
+			if (op == DFS_SKIP) {
+				continue;
+			}
+			if (top == task->dt_nnodes) {
+				/* Deeper than the number of nodes: a cycle */
+				rv = DFS_ERR;
+				goto bail;
+			}
+			stack[top] = child;
+			next[top] = 0;
+			top++;
+			continue;
+		}
+
+		/* Post-visit callback, all children are done */
+		if (post && post(task, cur, ud) == DFS_ERR) {
+			rv = DFS_ERR;
+			goto bail;
+		}
+		top--;
+	}
+	rv = DFS_GOOD;
+bail:
+	if (nested) {
+		free(stack);
+		free(next);
+	} else {
+		task->dt_flags.indfs = 0;
+	}
+	return rv;
+}
+
+typedef struct {
+	dnode_t		*dd_root;
+	dnid_t		dd_root_id;
+	dnode_t		dd_node;
+	ddfs_pre	dd_pre;
+	ddfs_visit	dd_visit;
+	ddfs_post	dd_post;
+	void		*dd_ud;
+} ddfs_ud_t;
+
+/**
+ * The node handed to the dnode_t callbacks for id
+ */
+static dnode_t *
+ddfs_node(dtask_t *task, dnid_t id, ddfs_ud_t *dd) {
+	if (id == dd->dd_root_id) {
+		return dd->dd_root;
+	}
+	return dtask_node_load(task, id, &dd->dd_node);
+}
+
+static ddo_t
+ddfs_node_pre(dtask_t *task, dnid_t id, void *ud) {
+	ddfs_ud_t *dd = ud;
+	return dd->dd_pre(ddfs_node(task, id, dd), dd->dd_ud);
+}
+
+static ddo_t
+ddfs_node_visit(dtask_t *task, dnid_t id, void *ud) {
+	ddfs_ud_t *dd = ud;
+	return dd->dd_visit(ddfs_node(task, id, dd), dd->dd_ud);
+}
+
+static ddo_t
+ddfs_node_post(dtask_t *task, dnid_t id, void *ud) {
+	ddfs_ud_t *dd = ud;
+	return dd->dd_post(ddfs_node(task, id, dd), dd->dd_ud);
+}
+
+ddo_t
+ddfs(dnode_t *cursor, ddfs_pre pre, ddfs_visit visit, ddfs_post post,
+     void *ud) {
+	ddfs_ud_t dd;
+
+	if (!cursor->dn_task) {
 		return DFS_ERR;
-	case DFS_SKIP:
-	case DFS_GOOD:
-		break;
-		/* Continue */
 	}
+	memset(&dd, 0, sizeof(ddfs_ud_t));
+	dd.dd_root = cursor;
+	dd.dd_root_id = dtask_name_id(cursor->dn_task, cursor->dn_name);
+	dd.dd_pre = pre;
+	dd.dd_visit = visit;
+	dd.dd_post = post;
+	dd.dd_ud = ud;
 
-	return DFS_GOOD;
-};
+	return ddfs_id(cursor->dn_task, dd.dd_root_id,
+		       pre ? ddfs_node_pre : NULL,
+		       visit ? ddfs_node_visit : NULL,
+		       post ? ddfs_node_post : NULL, &dd);
+}
@@ -44,7 +44,47 @@ typedef ddo_t (*ddfs_pre)(dnode_t *node, void *userd);
 typedef ddo_t (*ddfs_visit)(dnode_t *node, void *userd);
 typedef ddo_t (*ddfs_post)(dnode_t *node, void *userd);
 
+/**
+ * Depth first search from node, the callbacks are given a node that
+ * is only valid for the duration of the call (except for node itself)
+ *
+ * @see ddfs_id()
+ */
 ddo_t ddfs(dnode_t *node, ddfs_pre pre, ddfs_visit visit, ddfs_post post, void *userd);
 
+/**
+ * Callback functions over node ids, same return values as ddfs_pre,
+ * ddfs_visit and ddfs_post
+ *
+ * @param[in] task the task under inspection of the DFS
+ * @param[in] id the id of the node under inspection of the DFS
+ * @param[in] userdata the user data provided by the caller
+ */
+typedef ddo_t (*ddfs_id_pre)(dtask_t *task, dnid_t id, void *userd);
+typedef ddo_t (*ddfs_id_visit)(dtask_t *task, dnid_t id, void *userd);
+typedef ddo_t (*ddfs_id_post)(dtask_t *task, dnid_t id, void *userd);
+
+/**
+ * Depth first search from the node id of the task
+ *
+ * The search is iterative: its stack is kept in the task and no memory
+ * is allocated, unless the search is started from within the callbacks
+ * of another search of the same task.
+ *
+ * The callbacks must not change the edges of the task. As in a DAG no
+ * node can be twice on the stack, a node found twice on it means a
+ * cycle and the search fails.
+ *
+ * @param[in] task the dag task
+ * @param[in] id the node to start from
+ * @param[in] pre, visit, post the callbacks, can be NULL
+ * @param[in] userd the user data for the callbacks
+ *
+ * @return DFS_ERR if a callback failed (or the search could not be
+ * done), DFS_SKIP if the starting node was skipped, DFS_GOOD otherwise
+ */
+ddo_t ddfs_id(dtask_t *task, dnid_t id, ddfs_id_pre pre, ddfs_id_visit visit,
+	      ddfs_id_post post, void *userd);
+
 #endif /* DAG_DFS_H */
 
@@ -1,7 +1,5 @@
 #include "dag-node-list.h"
 
-void agnode_to_dnode(Agnode_t *src, dnode_t *dst);
-
 dnl_t*
 dnl_alloc() {
 	dnl_t *h = calloc(1, sizeof(dnl_t));
@@ -82,17 +80,11 @@ dnl_preds(dnode_t *node) {
 	dnl_t *h = calloc(1, sizeof(dnl_t));
 	dnl_init(h);
 
-	Agraph_t *g = node->dn_task->dt_graph;
-	Agnode_t *n = node->dn_node;
-	Agedge_t *e;
-
-	for (e = agfstin(g,n); e; e = agnxtin(g,e)) {
-		Agnode_t *a = agtail(e); /* a is the predecessor */
-		Agnode_t *b = aghead(e); /* b is *this* node */
+	dtask_t *task = node->dn_task;
+	dnid_t id = node->dn_id;
 
-		dnode_t *pred = dnode_alloc(agnameof(a));
-		agnode_to_dnode(a, pred);
-		pred->dn_task = node->dn_task;
+	for (uint32_t i = 0; i < dtask_indeg(task, id); i++) {
+		dnode_t *pred = dtask_node_at(task, dtask_preds(task, id)[i]);
 		dnl_elem_t *elem = dnle_alloc(pred);
 		dnode_free(pred);
 		dnl_insert_head(h, elem);
@@ -106,17 +98,11 @@ dnl_succs(dnode_t *node) {
 	dnl_t *h = calloc(1, sizeof(dnl_t));
 	dnl_init(h);
 
-	Agraph_t *g = node->dn_task->dt_graph;
-	Agnode_t *n = node->dn_node;
-	Agedge_t *e;
+	dtask_t *task = node->dn_task;
+	dnid_t id = node->dn_id;
 
-	for (e = agfstout(g,n); e; e = agnxtout(g,e)) {
-		Agnode_t *a = agtail(e); /* a is *this* node */
-		Agnode_t *b = aghead(e); /* b is the successor */
-
-		dnode_t *succ = dnode_alloc(agnameof(b));
-		agnode_to_dnode(b, succ);
-		succ->dn_task = node->dn_task;		
+	for (uint32_t i = 0; i < dtask_outdeg(task, id); i++) {
+		dnode_t *succ = dtask_node_at(task, dtask_succs(task, id)[i]);
 		dnl_elem_t *elem = dnle_alloc(succ);
 		dnode_free(succ);
 		dnl_insert_head(h, elem);
@@ -130,19 +116,16 @@ dnl_by_obj(dtask_t *task, tint_t object) {
 	dnl_t *h = calloc(1, sizeof(dnl_t));
 	dnl_init(h);
 
-	dnode_t *n = NULL, *prev = NULL;
-	while (n = dtask_next_node(task, prev)) {
-		if (prev) {
-			dnode_free(prev);
-		}
-		prev = n;
-		if (dnode_get_object(n) != object) {
-			continue;
-		}
-		dnl_elem_t *elem = dnle_alloc(n);
+	dnode_t n;
+	dnid_t id;
+	for (id = dtask_obj_first(task, object); id != DNID_NONE;
+	     id = dtask_obj_next(task, id)) {
+		memset(&n, 0, sizeof(dnode_t));
+		dtask_node_load(task, id, &n);
+		dnl_elem_t *elem = dnle_alloc(&n);
 		dnl_insert_head(h, elem);
 	}
-	
+
 	return h;
 }
 
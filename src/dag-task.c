@@ -1,390 +1,2753 @@
+#include <ctype.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <gvc.h>
 #include "dag-task.h"
-#include "dag-walk.h"
-static GVC_t *gvc = NULL;
 
-void agnode_to_dnode(Agnode_t *src, dnode_t *dst);
+/**
+ * Neither the dot parser of cgraph nor the layout of gvc is reentrant,
+ * every use of them in the library holds gv_lock. The binary format
+ * and dtask_write() do not need it.
+ */
+static pthread_mutex_t gv_lock = PTHREAD_MUTEX_INITIALIZER;
+static GVC_t *gvc = NULL;	/**< Created on first use, under gv_lock */
 
+static void agnode_to_dnode(Agnode_t *src, dnode_t *dst);
 static void dnode_to_agnode(dnode_t *src, Agnode_t *dst);
 static void dnode_calc_wcet(dnode_t *node);
 static void dnode_make_label(dnode_t *node);
 static void dedge_make_label(dedge_t *edge);
-static void agedge_to_dedge(Agedge_t *src, dedge_t *dst);
+static void dedge_fill(dedge_t *edge, dtask_t *task, dnid_t src,
+    uint32_t idx);
 
 /**
- * DAG TASK
+ * ARENA
+ */
+#define DARENA_ALIGN	16
+#define DARENA_CHUNK	(64 * 1024)
+
+typedef struct darena_chunk_s {
+	struct darena_chunk_s *ac_next;
+	size_t	ac_size;	/** Usable bytes of ac_data */
+	size_t	ac_used;	/** Bytes handed out */
+	size_t	ac_last;	/** Offset of the last allocation */
+	char	ac_data[];
+} darena_chunk_t;
+
+struct darena_s {
+	darena_chunk_t *ar_chunk;	/** Current chunk, then older ones */
+	size_t	ar_total;		/** Usable bytes of all chunks */
+};
+
+static darena_chunk_t *
+darena_chunk_alloc(size_t size) {
+	darena_chunk_t *chunk = malloc(sizeof(darena_chunk_t) + size);
+	if (!chunk) {
+		return NULL;
+	}
+	chunk->ac_next = NULL;
+	chunk->ac_size = size;
+	chunk->ac_used = 0;
+	chunk->ac_last = 0;
+	return chunk;
+}
+
+/**
+ * Hands out size bytes of the arena
+ */
+static void *
+darena_get(darena_t *arena, size_t size) {
+	darena_chunk_t *chunk = arena->ar_chunk;
+	size = (size + DARENA_ALIGN - 1) & ~((size_t) DARENA_ALIGN - 1);
+
+	if (!chunk || chunk->ac_size - chunk->ac_used < size) {
+		size_t csize = chunk ? chunk->ac_size * 2 : DARENA_CHUNK;
+		if (csize < size) {
+			csize = size;
+		}
+		darena_chunk_t *nchunk = darena_chunk_alloc(csize);
+		if (!nchunk) {
+			return NULL;
+		}
+		nchunk->ac_next = chunk;
+		arena->ar_chunk = chunk = nchunk;
+		arena->ar_total += csize;
+	}
+	chunk->ac_last = chunk->ac_used;
+	chunk->ac_used += size;
+	return chunk->ac_data + chunk->ac_last;
+}
+
+darena_t *
+darena_alloc(size_t size) {
+	darena_t *arena = calloc(1, sizeof(darena_t));
+	if (!arena) {
+		return NULL;
+	}
+	if (size) {
+		arena->ar_chunk = darena_chunk_alloc(size);
+		if (!arena->ar_chunk) {
+			free(arena);
+			return NULL;
+		}
+		arena->ar_total = size;
+	}
+	return arena;
+}
+
+void
+darena_reset(darena_t *arena) {
+	if (!arena || !arena->ar_chunk) {
+		return;
+	}
+	darena_chunk_t *chunk = arena->ar_chunk;
+	if (chunk->ac_next) {
+		/* Trade the chunks for one that holds them all */
+		while (chunk) {
+			darena_chunk_t *next = chunk->ac_next;
+			free(chunk);
+			chunk = next;
+		}
+		arena->ar_chunk = darena_chunk_alloc(arena->ar_total);
+		if (!arena->ar_chunk) {
+			arena->ar_total = 0;
+		}
+		return;
+	}
+	chunk->ac_used = 0;
+	chunk->ac_last = 0;
+}
+
+void
+darena_free(darena_t *arena) {
+	if (!arena) {
+		return;
+	}
+	darena_chunk_t *chunk = arena->ar_chunk;
+	while (chunk) {
+		darena_chunk_t *next = chunk->ac_next;
+		free(chunk);
+		chunk = next;
+	}
+	free(arena);
+}
+
+/*
+ * The memory of a task and of its adjacency comes from its arena, or
+ * from the heap when the arena is NULL. Arena memory is not released
+ * on its own, only by darena_reset().
  */
+static void *
+dt_malloc(darena_t *arena, size_t size) {
+	return arena ? darena_get(arena, size) : malloc(size);
+}
+
+static void *
+dt_realloc(darena_t *arena, void *ptr, size_t old, size_t size) {
+	if (!arena) {
+		return realloc(ptr, size);
+	}
+	darena_chunk_t *chunk = arena->ar_chunk;
+	size_t asize = (size + DARENA_ALIGN - 1) & ~((size_t) DARENA_ALIGN - 1);
+	if (ptr && ptr == chunk->ac_data + chunk->ac_last &&
+	    asize <= chunk->ac_size - chunk->ac_last) {
+		/* Last allocation of the chunk, grow it in place */
+		chunk->ac_used = chunk->ac_last + asize;
+		return ptr;
+	}
+	void *a = darena_get(arena, size);
+	if (a && ptr) {
+		memcpy(a, ptr, old < size ? old : size);
+	}
+	return a;
+}
+
 static void
-dtask_source_workload(dtask_t *task) {
-	Agnode_t *n;
-	dnode_t *source, *node;
-	tint_t workload = 0;
+dt_free(darena_t *arena, void *ptr) {
+	if (!arena) {
+		free(ptr);
+	}
+}
 
-	dnode_free(task->dt_source);
-	task->dt_source = NULL;
+static char *
+dt_strndup(darena_t *arena, const char *str, size_t n) {
+	if (!arena) {
+		return strndup(str, n);
+	}
+	size_t len = strnlen(str, n);
+	char *s = darena_get(arena, len + 1);
+	if (s) {
+		memcpy(s, str, len);
+		s[len] = '\0';
+	}
+	return s;
+}
+
+/**
+ * Grows an array of nelem elements of size elem to nnew elements,
+ * the new elements are zeroed.
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+static int
+grow_array(darena_t *arena, void **array, size_t elem, size_t nelem,
+    size_t nnew) {
+	void *a = dt_realloc(arena, *array, nelem * elem, nnew * elem);
+	if (!a) {
+		return 0;
+	}
+	memset((char *) a + nelem * elem, 0, (nnew - nelem) * elem);
+	*array = a;
+	return 1;
+}
+
+/**
+ * ADJACENCY
+ */
+static void
+dadj_free(dadj_t *adj) {
+	darena_t *arena = adj->da_arena;
+	dt_free(arena, adj->da_off);
+	dt_free(arena, adj->da_deg);
+	dt_free(arena, adj->da_cap);
+	dt_free(arena, adj->da_adj);
+	memset(adj, 0, sizeof(dadj_t));
+	adj->da_arena = arena;
+}
 
-	int count = 0;
-	for (n = agfstnode(task->dt_graph); n;
-	     n = agnxtnode(task->dt_graph, n)) {
-		int indegree = agdegree(task->dt_graph, n, TRUE, FALSE);
-		if (indegree == 0 && !task->dt_source) {
-			source = dnode_alloc(agnameof(n));
-			agnode_to_dnode(n, source);
-			source->dn_task = task;
-			task->dt_source = source;
+/**
+ * Grows the per row arrays from nrows to nnew rows
+ */
+static int
+dadj_grow_rows(dadj_t *adj, dnid_t nrows, dnid_t nnew) {
+	size_t sz = sizeof(uint32_t);
+	if (!grow_array(adj->da_arena, (void **) &adj->da_off, sz,
+	    nrows, nnew)) {
+		return 0;
+	}
+	if (!grow_array(adj->da_arena, (void **) &adj->da_deg, sz,
+	    nrows, nnew)) {
+		return 0;
+	}
+	if (!grow_array(adj->da_arena, (void **) &adj->da_cap, sz,
+	    nrows, nnew)) {
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Ensures the pool can hold size slots
+ */
+static int
+dadj_reserve(dadj_t *adj, uint32_t size) {
+	if (size <= adj->da_size) {
+		return 1;
+	}
+	uint32_t nsize = adj->da_size * 2;
+	if (nsize < size) {
+		nsize = size;
+	}
+	if (nsize < 16) {
+		nsize = 16;
+	}
+	dnid_t *a = dt_realloc(adj->da_arena, adj->da_adj,
+	    adj->da_size * sizeof(dnid_t), nsize * sizeof(dnid_t));
+	if (!a) {
+		return 0;
+	}
+	adj->da_adj = a;
+	adj->da_size = nsize;
+	return 1;
+}
+
+/**
+ * Places an empty row with room for cap neighbors at the end of the
+ * pool
+ */
+static int
+dadj_place_row(dadj_t *adj, dnid_t id, uint32_t cap) {
+	if (!dadj_reserve(adj, adj->da_len + cap)) {
+		return 0;
+	}
+	adj->da_off[id] = adj->da_len;
+	adj->da_deg[id] = 0;
+	adj->da_cap[id] = cap;
+	adj->da_len += cap;
+	return 1;
+}
+
+/**
+ * Repacks the rows, releasing the slots left behind by moved rows
+ */
+static int
+dadj_compact(dadj_t *adj, dnid_t nrows) {
+	dnid_t *a = dt_malloc(adj->da_arena,
+	    (adj->da_edges + 1) * sizeof(dnid_t));
+	if (!a) {
+		return 0;
+	}
+	uint32_t len = 0;
+	for (dnid_t i = 0; i < nrows; i++) {
+		memcpy(a + len, adj->da_adj + adj->da_off[i],
+		    adj->da_deg[i] * sizeof(dnid_t));
+		adj->da_off[i] = len;
+		adj->da_cap[i] = adj->da_deg[i];
+		len += adj->da_deg[i];
+	}
+	dt_free(adj->da_arena, adj->da_adj);
+	adj->da_adj = a;
+	adj->da_len = len;
+	adj->da_size = adj->da_edges + 1;
+	return 1;
+}
+
+/**
+ * Appends nbr to the row of id
+ */
+static int
+dadj_push(dadj_t *adj, dnid_t nrows, dnid_t id, dnid_t nbr) {
+	uint32_t deg = adj->da_deg[id];
+	uint32_t cap = adj->da_cap[id];
+
+	if (deg == cap) {
+		uint32_t ncap = cap ? cap * 2 : 2;
+		if (adj->da_off[id] + cap == adj->da_len) {
+			/* Last row of the pool, grow it in place */
+			if (!dadj_reserve(adj, adj->da_len + ncap - cap)) {
+				return 0;
+			}
+			adj->da_len += ncap - cap;
+			adj->da_cap[id] = ncap;
+		} else {
+			if (adj->da_len > 2 * adj->da_edges + 1024) {
+				if (!dadj_compact(adj, nrows)) {
+					return 0;
+				}
+			}
+			/* Move the row to the end of the pool */
+			uint32_t off = adj->da_off[id];
+			if (!dadj_place_row(adj, id, ncap)) {
+				return 0;
+			}
+			memmove(adj->da_adj + adj->da_off[id],
+			    adj->da_adj + off, deg * sizeof(dnid_t));
+			adj->da_deg[id] = deg;
+		}
+	}
+	adj->da_adj[adj->da_off[id] + deg] = nbr;
+	adj->da_deg[id]++;
+	adj->da_edges++;
+	return 1;
+}
+
+/**
+ * Position of nbr in the row of id
+ *
+ * @return the index of nbr in the row, -1 if not present
+ */
+static int
+dadj_find(dadj_t *adj, dnid_t id, dnid_t nbr) {
+	dnid_t *row = adj->da_adj + adj->da_off[id];
+	for (uint32_t i = 0; i < adj->da_deg[id]; i++) {
+		if (row[i] == nbr) {
+			return i;
 		}
-		tint_t wcet = atoi(agget(n, DT_WCET));
-		workload += wcet;
-		count++;
 	}
-	task->dt_workload = workload;
+	return -1;
+}
 
-	if (count > 1 && !task->dt_source) {
-		/* no source?!? */
-		raise(SIGSEGV);
+/**
+ * Removes the idx'th neighbor from the row of id, preserving the
+ * order of the remaining neighbors
+ */
+static void
+dadj_del(dadj_t *adj, dnid_t id, uint32_t idx) {
+	dnid_t *row = adj->da_adj + adj->da_off[id];
+	memmove(row + idx, row + idx + 1,
+	    (adj->da_deg[id] - idx - 1) * sizeof(dnid_t));
+	adj->da_deg[id]--;
+	adj->da_edges--;
+}
+
+/**
+ * Inserts nbr at the idx'th position of the row of id, the inverse of
+ * dadj_del()
+ */
+static int
+dadj_ins(dadj_t *adj, dnid_t nrows, dnid_t id, uint32_t idx, dnid_t nbr) {
+	if (!dadj_push(adj, nrows, id, nbr)) {
+		return 0;
+	}
+	dnid_t *row = adj->da_adj + adj->da_off[id];
+	memmove(row + idx + 1, row + idx,
+	    (adj->da_deg[id] - idx - 1) * sizeof(dnid_t));
+	row[idx] = nbr;
+	return 1;
+}
+
+/**
+ * JOURNAL
+ */
+enum {
+	DJ_NEW,		/** Node je_id was inserted */
+	DJ_DROP,	/** Node je_id was removed */
+	DJ_EDGE,	/** Edge je_id -> je_nbr was appended */
+	DJ_DEL_OUT,	/** je_nbr was removed from the out row of je_id */
+	DJ_DEL_IN,	/** je_nbr was removed from the in row of je_id */
+	DJ_STORE,	/** The values of node je_id were replaced */
+	DJ_DIST,	/** The distance of node je_id was recalculated */
+};
+
+typedef struct {
+	uint8_t	je_op;		/** DJ_* */
+	uint8_t	je_mark;	/** DJ_DROP, DJ_STORE: DN_* bits */
+	dnid_t	je_id;
+	dnid_t	je_nbr;		/** DJ_EDGE, DJ_DEL_* */
+	uint32_t je_idx;	/** DJ_DEL_*: index in the row */
+	char	*je_name;	/** DJ_DROP: name of the node */
+	uint32_t je_ids;	/** DJ_DROP: rows of the node in dj_ids */
+	uint32_t je_nout;	/** DJ_DROP: out degree */
+	uint32_t je_nin;	/** DJ_DROP: in degree */
+	tint_t	je_object;	/** DJ_STORE: values of the node */
+	tint_t	je_threads;
+	tint_t	je_wcet_one;
+	tint_t	je_wcet;	/** DJ_STORE, DJ_DIST: the distance */
+	float_t	je_factor;
+} djent_t;
+
+struct djournal_s {
+	djent_t	*dj_ent;	/** Changes in the order they were made */
+	uint32_t dj_nent;
+	uint32_t dj_entcap;
+	dnid_t	*dj_ids;	/** Rows of the removed nodes */
+	uint32_t dj_nids;
+	uint32_t dj_idscap;
+	int	dj_active;	/** In a transaction */
+	int	dj_lost;	/** A change could not be journaled */
+	/* The task at dtask_begin() */
+	tint_t	dj_cpathlen;
+	tint_t	dj_workload;
+	tint_t	dj_collapsed;
+	dnid_t	dj_nnodes;
+	dnid_t	dj_source;
+	uint64_t dj_ncrit;
+	int	dj_reach;	/** dt_desc and dt_far still hold then */
+	int	dj_paths;	/** dt_tail, dt_cf, dt_cb still hold then */
+};
+
+/**
+ * Journal of the task, NULL if it is not in a transaction
+ */
+static inline djournal_t *
+dtask_jnl(dtask_t *task) {
+	djournal_t *dj = task->dt_journal;
+	return dj && dj->dj_active && !dj->dj_lost ? dj : NULL;
+}
+
+/**
+ * Appends a change of node id to the journal
+ *
+ * @return the entry, NULL if the journal ran out of memory
+ */
+static djent_t *
+dj_push(dtask_t *task, djournal_t *dj, int op, dnid_t id) {
+	if (dj->dj_nent == dj->dj_entcap) {
+		uint32_t cap = dj->dj_entcap ? 2 * dj->dj_entcap : 64;
+		djent_t *ent = dt_realloc(task->dt_arena, dj->dj_ent,
+		    dj->dj_entcap * sizeof(djent_t), cap * sizeof(djent_t));
+		if (!ent) {
+			dj->dj_lost = 1;
+			return NULL;
+		}
+		dj->dj_ent = ent;
+		dj->dj_entcap = cap;
+	}
+	djent_t *e = &dj->dj_ent[dj->dj_nent++];
+	memset(e, 0, sizeof(djent_t));
+	e->je_op = op;
+	e->je_id = id;
+	return e;
+}
+
+/**
+ * Saves n node ids to the journal
+ *
+ * @return the offset of the ids in dj_ids, UINT32_MAX if the journal
+ * ran out of memory
+ */
+static uint32_t
+dj_save_ids(dtask_t *task, djournal_t *dj, const dnid_t *ids, uint32_t n) {
+	if (dj->dj_nids + n > dj->dj_idscap) {
+		uint32_t cap = dj->dj_idscap ? 2 * dj->dj_idscap : 64;
+		while (cap < dj->dj_nids + n) {
+			cap *= 2;
+		}
+		dnid_t *a = dt_realloc(task->dt_arena, dj->dj_ids,
+		    dj->dj_idscap * sizeof(dnid_t), cap * sizeof(dnid_t));
+		if (!a) {
+			dj->dj_lost = 1;
+			return UINT32_MAX;
+		}
+		dj->dj_ids = a;
+		dj->dj_idscap = cap;
+	}
+	uint32_t off = dj->dj_nids;
+	memcpy(dj->dj_ids + off, ids, n * sizeof(dnid_t));
+	dj->dj_nids += n;
+	return off;
+}
+
+/**
+ * Releases the names of the nodes removed in the transaction
+ */
+static void
+dj_release(dtask_t *task, djournal_t *dj) {
+	for (uint32_t i = 0; i < dj->dj_nent; i++) {
+		if (dj->dj_ent[i].je_op == DJ_DROP) {
+			dt_free(task->dt_arena, dj->dj_ent[i].je_name);
+		}
+	}
+	dj->dj_nent = 0;
+	dj->dj_nids = 0;
+	dj->dj_active = 0;
+}
+
+/**
+ * NODE ARRAYS
+ */
+static uint32_t
+name_hash(const char *name) {
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	for (; *name; name++) {
+		h ^= (unsigned char) *name;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void
+dtask_hash_link(dtask_t *task, dnid_t id) {
+	uint32_t b = name_hash(task->dt_nname[id]) & (task->dt_hsize - 1);
+	task->dt_hnext[id] = task->dt_hbucket[b];
+	task->dt_hbucket[b] = id;
+}
+
+static void
+dtask_hash_unlink(dtask_t *task, dnid_t id) {
+	uint32_t b = name_hash(task->dt_nname[id]) & (task->dt_hsize - 1);
+	dnid_t *link = &task->dt_hbucket[b];
+	while (*link != DNID_NONE) {
+		if (*link == id) {
+			*link = task->dt_hnext[id];
+			return;
+		}
+		link = &task->dt_hnext[*link];
+	}
+}
+
+/**
+ * Rebuilds the hash table with at least twice as many buckets as
+ * there are node slots
+ */
+static int
+dtask_hash_rebuild(dtask_t *task) {
+	uint32_t size = 16;
+	while (size < 2 * task->dt_ncap) {
+		size *= 2;
+	}
+	dnid_t *bucket = dt_malloc(task->dt_arena, size * sizeof(dnid_t));
+	if (!bucket) {
+		return 0;
+	}
+	for (uint32_t i = 0; i < size; i++) {
+		bucket[i] = DNID_NONE;
+	}
+	dt_free(task->dt_arena, task->dt_hbucket);
+	task->dt_hbucket = bucket;
+	task->dt_hsize = size;
+
+	dnid_t id;
+	dtask_foreach_id(task, id) {
+		dtask_hash_link(task, id);
+	}
+	return 1;
+}
+
+/**
+ * Grows the node arrays to hold at least want nodes
+ */
+static int
+dtask_grow(dtask_t *task, dnid_t want) {
+	dnid_t ncap = task->dt_ncap;
+	if (want <= ncap) {
+		return 1;
+	}
+	dnid_t nnew = ncap ? ncap * 2 : 16;
+	while (nnew < want) {
+		nnew *= 2;
+	}
+
+	darena_t *ar = task->dt_arena;
+	int ok = 1;
+	ok = ok && grow_array(ar, (void **) &task->dt_nname,
+	    sizeof(char *), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_object,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_threads,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_wcet_one,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_wcet,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_factor,
+	    sizeof(float_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_distance,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_mark,
+	    sizeof(uint8_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_hnext,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_seed,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_cone,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_queue,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_cnt,
+	    sizeof(uint32_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_dfs,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_dfs_next,
+	    sizeof(uint32_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_order,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_tail,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_cf,
+	    sizeof(uint64_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_cb,
+	    sizeof(uint64_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_sdist,
+	    sizeof(tint_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_onext,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_oprev,
+	    sizeof(dnid_t), ncap, nnew);
+	ok = ok && dadj_grow_rows(&task->dt_out, ncap, nnew);
+	ok = ok && dadj_grow_rows(&task->dt_in, ncap, nnew);
+	if (!ok) {
+		return 0;
+	}
+	task->dt_ncap = nnew;
+
+	return dtask_hash_rebuild(task);
+}
+
+/**
+ * Makes room in the object index for object
+ */
+static int
+dtask_obj_reserve(dtask_t *task, tint_t object) {
+	tint_t nobj = task->dt_nobj;
+	if (object < nobj) {
+		return 1;
+	}
+	tint_t nnew = nobj ? nobj * 2 : 16;
+	while (nnew <= object) {
+		nnew *= 2;
+	}
+	darena_t *ar = task->dt_arena;
+	int ok = 1;
+	ok = ok && grow_array(ar, (void **) &task->dt_ohead,
+	    sizeof(dnid_t), nobj, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_otail,
+	    sizeof(dnid_t), nobj, nnew);
+	ok = ok && grow_array(ar, (void **) &task->dt_ocount,
+	    sizeof(dnid_t), nobj, nnew);
+	if (!ok) {
+		return 0;
+	}
+	for (tint_t o = nobj; o < nnew; o++) {
+		task->dt_ohead[o] = DNID_NONE;
+		task->dt_otail[o] = DNID_NONE;
+	}
+	task->dt_nobj = nnew;
+	return 1;
+}
+
+/**
+ * Links node id into the list of its object, keeping the id order
+ */
+static int
+dtask_obj_link(dtask_t *task, dnid_t id) {
+	tint_t object = task->dt_object[id];
+	if (!dtask_obj_reserve(task, object)) {
+		return 0;
+	}
+	/* New nodes have the largest id, start from the tail */
+	dnid_t prev = task->dt_otail[object];
+	while (prev != DNID_NONE && prev > id) {
+		prev = task->dt_oprev[prev];
+	}
+	dnid_t next = prev == DNID_NONE ? task->dt_ohead[object] :
+	    task->dt_onext[prev];
+
+	task->dt_oprev[id] = prev;
+	task->dt_onext[id] = next;
+	if (prev == DNID_NONE) {
+		task->dt_ohead[object] = id;
+	} else {
+		task->dt_onext[prev] = id;
+	}
+	if (next == DNID_NONE) {
+		task->dt_otail[object] = id;
+	} else {
+		task->dt_oprev[next] = id;
+	}
+	task->dt_ocount[object]++;
+	if ((int) object > task->dt_maxobj) {
+		task->dt_maxobj = object;
+	}
+	return 1;
+}
+
+static void
+dtask_obj_unlink(dtask_t *task, dnid_t id) {
+	tint_t object = task->dt_object[id];
+	dnid_t prev = task->dt_oprev[id];
+	dnid_t next = task->dt_onext[id];
+
+	if (prev == DNID_NONE) {
+		task->dt_ohead[object] = next;
+	} else {
+		task->dt_onext[prev] = next;
+	}
+	if (next == DNID_NONE) {
+		task->dt_otail[object] = prev;
+	} else {
+		task->dt_oprev[next] = prev;
+	}
+	task->dt_ocount[object]--;
+	while (task->dt_maxobj >= 0 &&
+	    task->dt_ocount[task->dt_maxobj] == 0) {
+		task->dt_maxobj--;
+	}
+}
+
+/**
+ * Builds the object index, if it is not up to date
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+static int
+dtask_obj_build(dtask_t *task) {
+	dnid_t id;
+
+	if (task->dt_flags.objs) {
+		return 1;
+	}
+	for (tint_t o = 0; o < task->dt_nobj; o++) {
+		task->dt_ohead[o] = DNID_NONE;
+		task->dt_otail[o] = DNID_NONE;
+		task->dt_ocount[o] = 0;
+	}
+	task->dt_maxobj = -1;
+	dtask_foreach_id(task, id) {
+		if (!dtask_obj_link(task, id)) {
+			return 0;
+		}
+	}
+	task->dt_flags.objs = 1;
+	return 1;
+}
+
+/**
+ * Hands out the next node id to a node named name
+ *
+ * @return the id of the node, DNID_NONE if it could not be allocated
+ */
+static dnid_t
+dtask_new_id(dtask_t *task, char *name) {
+	if (!dtask_grow(task, task->dt_nids + 1)) {
+		return DNID_NONE;
+	}
+	dnid_t id = task->dt_nids;
+	task->dt_nname[id] = dt_strndup(task->dt_arena, name, DT_NAMELEN - 1);
+	if (!task->dt_nname[id]) {
+		return DNID_NONE;
+	}
+	task->dt_nids++;
+	task->dt_nnodes++;
+	dtask_hash_link(task, id);
+	task->dt_object[id] = 0;
+	if (task->dt_flags.objs && !dtask_obj_link(task, id)) {
+		task->dt_flags.objs = 0;
+	}
+	djournal_t *dj = dtask_jnl(task);
+	if (dj) {
+		dj_push(task, dj, DJ_NEW, id);
+	}
+
+	return id;
+}
+
+/**
+ * Marks the distance of node id, and so those of its descendants, as
+ * stale
+ */
+static void
+dtask_seed(dtask_t *task, dnid_t id) {
+	if (task->dt_mark[id] & DN_SEED) {
+		return;
+	}
+	task->dt_mark[id] |= DN_SEED;
+	task->dt_seed[task->dt_nseed++] = id;
+}
+
+/**
+ * Removes the node id and all of its edges
+ */
+static void
+dtask_drop_id(dtask_t *task, dnid_t id) {
+	djournal_t *dj = dtask_jnl(task);
+	dnid_t *row;
+	uint32_t ids = 0;
+
+	task->dt_workload -= task->dt_wcet[id];
+	task->dt_flags.ldec = 1;
+
+	if (dj) {
+		/* The rows of the node, to put them back as they were */
+		ids = dj_save_ids(task, dj, dtask_succs(task, id),
+		    dtask_outdeg(task, id));
+		dj_save_ids(task, dj, dtask_preds(task, id),
+		    dtask_indeg(task, id));
+	}
+
+	row = dtask_succs(task, id);
+	for (uint32_t i = 0; i < dtask_outdeg(task, id); i++) {
+		dtask_seed(task, row[i]);
+		int idx = dadj_find(&task->dt_in, row[i], id);
+		if (idx >= 0) {
+			dadj_del(&task->dt_in, row[i], idx);
+			djent_t *e = dj ? dj_push(task, dj, DJ_DEL_IN, row[i]) :
+			    NULL;
+			if (e) {
+				e->je_nbr = id;
+				e->je_idx = idx;
+			}
+		}
+	}
+
+	row = dtask_preds(task, id);
+	for (uint32_t i = 0; i < dtask_indeg(task, id); i++) {
+		int idx = dadj_find(&task->dt_out, row[i], id);
+		if (idx >= 0) {
+			dadj_del(&task->dt_out, row[i], idx);
+			djent_t *e = dj ? dj_push(task, dj, DJ_DEL_OUT, row[i]) :
+			    NULL;
+			if (e) {
+				e->je_nbr = id;
+				e->je_idx = idx;
+			}
+		}
+	}
+
+	djent_t *e = dj ? dj_push(task, dj, DJ_DROP, id) : NULL;
+	if (e) {
+		/* The name is released by dtask_commit() */
+		e->je_name = task->dt_nname[id];
+		e->je_mark = task->dt_mark[id];
+		e->je_ids = ids;
+		e->je_nout = dtask_outdeg(task, id);
+		e->je_nin = dtask_indeg(task, id);
+	}
+	task->dt_out.da_edges -= dtask_outdeg(task, id);
+	task->dt_out.da_deg[id] = 0;
+	task->dt_in.da_edges -= dtask_indeg(task, id);
+	task->dt_in.da_deg[id] = 0;
+
+	dtask_hash_unlink(task, id);
+	if (task->dt_flags.objs) {
+		dtask_obj_unlink(task, id);
+	}
+	if (!e) {
+		dt_free(task->dt_arena, task->dt_nname[id]);
+	}
+	task->dt_nname[id] = NULL;
+	task->dt_mark[id] = 0;
+	task->dt_nnodes--;
+}
+
+/**
+ * Stores the values of the node in the node arrays
+ */
+static void
+dtask_store_node(dtask_t *task, dnid_t id, dnode_t *node) {
+	if (task->dt_flags.objs && task->dt_object[id] != node->dn_object) {
+		dtask_obj_unlink(task, id);
+		task->dt_object[id] = node->dn_object;
+		if (!dtask_obj_link(task, id)) {
+			task->dt_flags.objs = 0;
+		}
+	}
+	task->dt_object[id] = node->dn_object;
+	task->dt_threads[id] = node->dn_threads;
+	task->dt_wcet_one[id] = node->dn_wcet_one;
+	task->dt_wcet[id] = node->dn_wcet;
+	task->dt_factor[id] = node->dn_factor;
+	task->dt_mark[id] &= ~(DN_VISITED | DN_MARKED);
+	task->dt_mark[id] |= (node->dn_flags.visited ? DN_VISITED : 0) |
+	    (node->dn_flags.marked ? DN_MARKED : 0);
+}
+
+/**
+ * Fills in the node with the values of the node arrays
+ */
+static void
+dtask_load_node(dtask_t *task, dnid_t id, dnode_t *node) {
+	node->dn_object = task->dt_object[id];
+	node->dn_threads = task->dt_threads[id];
+	node->dn_wcet_one = task->dt_wcet_one[id];
+	node->dn_wcet = task->dt_wcet[id];
+	node->dn_factor = task->dt_factor[id];
+	node->dn_distance = task->dt_distance[id];
+	node->dn_flags.dirty = 0;
+	node->dn_flags.visited = (task->dt_mark[id] & DN_VISITED) != 0;
+	node->dn_flags.marked = (task->dt_mark[id] & DN_MARKED) != 0;
+	node->dn_task = task;
+	node->dn_id = id;
+}
+
+/**
+ * Id of the node in its task, DNID_NONE if it is not in the task
+ */
+static dnid_t
+dnode_id(dnode_t *node) {
+	dtask_t *task = node->dn_task;
+	if (!task) {
+		return DNID_NONE;
+	}
+	dnid_t id = node->dn_id;
+	if (dtask_node_live(task, id) &&
+	    strcmp(task->dt_nname[id], node->dn_name) == 0) {
+		return id;
+	}
+	/* The node has been removed and re-inserted */
+	return dtask_name_id(task, node->dn_name);
+}
+
+/**
+ * DAG TASK
+ */
+static void
+dtask_find_source(dtask_t *task) {
+	dnid_t id;
+
+	dnode_free(task->dt_source);
+	task->dt_source = NULL;
+
+	dtask_foreach_id(task, id) {
+		if (dtask_indeg(task, id) == 0) {
+			task->dt_source = dtask_node_at(task, id);
+			break;
+		}
+	}
+
+	if (task->dt_nnodes > 1 && !task->dt_source) {
+		/* no source?!? */
+		raise(SIGSEGV);
+	}
+	task->dt_flags.dirty = 0;
+}
+
+/**
+ * Sorts the n nodes in topological order, edges from nodes not in
+ * nodes are ignored
+ *
+ * @return the number of nodes sorted, less than n if there is a cycle
+ */
+static dnid_t
+dtask_kahn(dtask_t *task, const dnid_t *nodes, dnid_t n, dnid_t *order) {
+	uint32_t *cnt = task->dt_cnt;
+	dnid_t id;
+
+	/* Predecessors among nodes of each of the nodes */
+	for (dnid_t i = 0; i < n; i++) {
+		cnt[nodes[i]] = 0;
+	}
+	for (dnid_t i = 0; i < n; i++) {
+		id = nodes[i];
+		dnid_t *succs = dtask_succs(task, id);
+		for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+			cnt[succs[j]]++;
+		}
+	}
+
+	dnid_t head = 0;
+	dnid_t tail = 0;
+	for (dnid_t i = 0; i < n; i++) {
+		if (cnt[nodes[i]] == 0) {
+			order[tail++] = nodes[i];
+		}
+	}
+	while (head < tail) {
+		id = order[head++];
+		dnid_t *succs = dtask_succs(task, id);
+		for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+			if (--cnt[succs[j]] == 0) {
+				order[tail++] = succs[j];
+			}
+		}
+	}
+
+	return tail;
+}
+
+dnid_t
+dtask_topo_order(dtask_t *task, dnid_t *order) {
+	dnid_t n = 0;
+	dnid_t id;
+
+	dtask_foreach_id(task, id) {
+		task->dt_cone[n++] = id;
+	}
+	return dtask_kahn(task, task->dt_cone, n, order);
+}
+
+tint_t
+dtask_longest_path(dtask_t *task, const dnid_t *order, dnid_t n,
+		   tint_t *dist) {
+	tint_t max = 0;
+
+	for (dnid_t i = 0; i < n; i++) {
+		dnid_t id = order[i];
+		dnid_t *preds = dtask_preds(task, id);
+		tint_t maxd = 0;
+		for (uint32_t j = 0; j < dtask_indeg(task, id); j++) {
+			if (dist[preds[j]] > maxd) {
+				maxd = dist[preds[j]];
+			}
+		}
+		/* The distance of each node is the maximum completion time */
+		dist[id] = task->dt_wcet[id] + maxd;
+		if (dist[id] > max) {
+			max = dist[id];
+		}
+	}
+
+	return max;
+}
+
+/**
+ * Builds the reachability index of the task
+ *
+ * @return non-zero upon success, zero if the task cannot be indexed
+ */
+static int
+dtask_reach_build(dtask_t *task) {
+	if (task->dt_journal) {
+		/* The index of the task at dtask_begin() is overwritten */
+		task->dt_journal->dj_reach = 0;
+	}
+	if (task->dt_nids > DT_REACH_MAX) {
+		return 0;
+	}
+	dnid_t n = dtask_topo_order(task, task->dt_queue);
+	if (n < task->dt_nnodes) {
+		/* Cycle */
+		return 0;
+	}
+
+	uint32_t words = (task->dt_nids + 63) / 64;
+	size_t size = (size_t) task->dt_nids * words;
+	if (size > task->dt_rsize) {
+		size_t old = task->dt_rsize * sizeof(uint64_t);
+		uint64_t *desc = dt_realloc(task->dt_arena, task->dt_desc, old,
+		    size * sizeof(uint64_t));
+		if (desc) {
+			task->dt_desc = desc;
+		}
+		uint64_t *far = dt_realloc(task->dt_arena, task->dt_far, old,
+		    size * sizeof(uint64_t));
+		if (far) {
+			task->dt_far = far;
+		}
+		if (!desc || !far) {
+			return 0;
+		}
+		task->dt_rsize = size;
+	}
+	task->dt_rwords = words;
+
+	/* Successors are done before their predecessors */
+	for (dnid_t i = n; i > 0; i--) {
+		dnid_t id = task->dt_queue[i - 1];
+		uint64_t *desc = task->dt_desc + (size_t) id * words;
+		uint64_t *far = task->dt_far + (size_t) id * words;
+		memset(desc, 0, words * sizeof(uint64_t));
+		memset(far, 0, words * sizeof(uint64_t));
+
+		dnid_t *succs = dtask_succs(task, id);
+		for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+			dnid_t s = succs[j];
+			uint64_t *sdesc = task->dt_desc + (size_t) s * words;
+			for (uint32_t w = 0; w < words; w++) {
+				far[w] |= sdesc[w];
+			}
+			desc[s / 64] |= (uint64_t) 1 << (s % 64);
+		}
+		for (uint32_t w = 0; w < words; w++) {
+			desc[w] |= far[w];
+		}
+	}
+	task->dt_flags.reach = 1;
+
+	return 1;
+}
+
+int
+dtask_reach_far(dtask_t *task, dnid_t a, dnid_t b) {
+	if (!dtask_node_live(task, a) || !dtask_node_live(task, b)) {
+		return 0;
+	}
+	if (!task->dt_flags.reach && !dtask_reach_build(task)) {
+		return -1;
+	}
+	uint64_t *far = task->dt_far + (size_t) a * task->dt_rwords;
+
+	return (far[b / 64] >> (b % 64)) & 1;
+}
+
+/**
+ * Recalculates the distances of the seeds and of their descendants, in
+ * topological order, and from them the critical path length
+ *
+ * Distances of the nodes outside of the cone of the seeds are still
+ * valid, so only the cone is visited unless all the distances are
+ * stale (lfull). If a distance may have decreased (ldec) the maximum is
+ * taken over all the nodes again.
+ */
+static void
+dtask_relax(dtask_t *task) {
+	uint8_t *mark = task->dt_mark;
+	dnid_t *cone = task->dt_cone;
+	dnid_t *queue = task->dt_queue;
+	dnid_t ncone = 0;
+	dnid_t n;
+	dnid_t id;
+
+	if (task->dt_flags.lfull) {
+		n = dtask_topo_order(task, queue);
+	} else {
+		/* Forward cone of the seeds, queue used as a stack */
+		dnid_t top = 0;
+		for (dnid_t i = 0; i < task->dt_nseed; i++) {
+			id = task->dt_seed[i];
+			if (dtask_node_live(task, id) && !(mark[id] & DN_CONE)) {
+				mark[id] |= DN_CONE;
+				queue[top++] = id;
+			}
+		}
+		while (top) {
+			id = queue[--top];
+			cone[ncone++] = id;
+			dnid_t *succs = dtask_succs(task, id);
+			for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+				if (!(mark[succs[j]] & DN_CONE)) {
+					mark[succs[j]] |= DN_CONE;
+					queue[top++] = succs[j];
+				}
+			}
+		}
+		for (dnid_t i = 0; i < ncone; i++) {
+			mark[cone[i]] &= ~DN_CONE;
+		}
+		n = dtask_kahn(task, cone, ncone, queue);
+	}
+	for (dnid_t i = 0; i < task->dt_nseed; i++) {
+		mark[task->dt_seed[i]] &= ~DN_SEED;
+	}
+	task->dt_nseed = 0;
+
+	djournal_t *dj = dtask_jnl(task);
+	for (dnid_t i = 0; dj && i < n; i++) {
+		djent_t *e = dj_push(task, dj, DJ_DIST, queue[i]);
+		if (e) {
+			e->je_wcet = task->dt_distance[queue[i]];
+		}
+	}
+	tint_t max = dtask_longest_path(task, queue, n, task->dt_distance);
+
+	if (task->dt_flags.lfull || task->dt_flags.ldec) {
+		max = 0;
+		dtask_foreach_id(task, id) {
+			if (task->dt_distance[id] > max) {
+				max = task->dt_distance[id];
+			}
+		}
+		task->dt_cpathlen = max;
+	} else if (max > task->dt_cpathlen) {
+		task->dt_cpathlen = max;
+	}
+	task->dt_flags.lfull = 0;
+	task->dt_flags.ldec = 0;
+	task->dt_flags.paths = 0;
+}
+
+static uint64_t
+sat_add(uint64_t a, uint64_t b) {
+	return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+}
+
+static uint64_t
+sat_mul(uint64_t a, uint64_t b) {
+	if (a && b > UINT64_MAX / a) {
+		return UINT64_MAX;
+	}
+	return a * b;
+}
+
+/**
+ * Finds the tails and the counts of critical paths of the task, the
+ * distances must be current
+ *
+ * @return non-zero upon success, zero if the task has a cycle
+ */
+static int
+dtask_paths_build(dtask_t *task) {
+	if (task->dt_journal) {
+		task->dt_journal->dj_paths = 0;
+	}
+	tint_t *dist = task->dt_distance;
+	tint_t *wcet = task->dt_wcet;
+	dnid_t *order = task->dt_order;
+	dnid_t n = dtask_topo_order(task, order);
+	if (n < task->dt_nnodes) {
+		return 0;
+	}
+
+	for (dnid_t i = 0; i < n; i++) {
+		dnid_t id = order[i];
+		dnid_t *preds = dtask_preds(task, id);
+		if (dtask_indeg(task, id) == 0) {
+			task->dt_cf[id] = 1;
+			continue;
+		}
+		uint64_t cf = 0;
+		for (uint32_t j = 0; j < dtask_indeg(task, id); j++) {
+			if (dist[preds[j]] + wcet[id] == dist[id]) {
+				cf = sat_add(cf, task->dt_cf[preds[j]]);
+			}
+		}
+		task->dt_cf[id] = cf;
+	}
+
+	task->dt_ncrit = 0;
+	for (dnid_t i = n; i > 0; i--) {
+		dnid_t id = order[i - 1];
+		dnid_t *succs = dtask_succs(task, id);
+		tint_t maxt = 0;
+		for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+			if (task->dt_tail[succs[j]] > maxt) {
+				maxt = task->dt_tail[succs[j]];
+			}
+		}
+		task->dt_tail[id] = wcet[id] + maxt;
+
+		uint64_t cb = dtask_outdeg(task, id) == 0 ? 1 : 0;
+		for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+			if (task->dt_tail[succs[j]] == maxt) {
+				cb = sat_add(cb, task->dt_cb[succs[j]]);
+			}
+		}
+		task->dt_cb[id] = cb;
+
+		if (dtask_indeg(task, id) == 0 &&
+		    task->dt_tail[id] == task->dt_cpathlen) {
+			task->dt_ncrit = sat_add(task->dt_ncrit, cb);
+		}
+	}
+	task->dt_flags.paths = 1;
+
+	return 1;
+}
+
+/**
+ * Number of critical paths through the node id
+ */
+static uint64_t
+dtask_ncrit_through(dtask_t *task, dnid_t id) {
+	tint_t len = task->dt_distance[id] + task->dt_tail[id] -
+	    task->dt_wcet[id];
+	if (len != task->dt_cpathlen) {
+		return 0;
+	}
+	return sat_mul(task->dt_cf[id], task->dt_cb[id]);
+}
+
+/**
+ * Number of critical paths through the edge a -> b, if there is one
+ */
+static uint64_t
+dtask_ncrit_edge(dtask_t *task, dnid_t a, dnid_t b) {
+	if (dadj_find(&task->dt_out, a, b) < 0) {
+		return 0;
+	}
+	if (task->dt_distance[a] + task->dt_tail[b] != task->dt_cpathlen) {
+		return 0;
+	}
+	return sat_mul(task->dt_cf[a], task->dt_cb[b]);
+}
+
+int
+dtask_paths(dtask_t *task) {
+	dtask_update(task);
+
+	return task->dt_flags.paths || dtask_paths_build(task);
+}
+
+int
+dtask_merged_cpathlen(dtask_t *task, dnid_t a, dnid_t b, tint_t wcet,
+		      tint_t *cpathlen) {
+	dtask_update(task);
+	if (!dtask_node_live(task, a) || !dtask_node_live(task, b)) {
+		return 0;
+	}
+	if (!task->dt_flags.paths && !dtask_paths_build(task)) {
+		return 0;
+	}
+	tint_t L = task->dt_cpathlen;
+
+	/* Longest path through the collapsed node */
+	dnid_t ends[2] = { a, b };
+	tint_t before = 0;
+	tint_t after = 0;
+	for (int k = 0; k < 2; k++) {
+		dnid_t id = ends[k];
+		dnid_t *preds = dtask_preds(task, id);
+		for (uint32_t j = 0; j < dtask_indeg(task, id); j++) {
+			if (preds[j] != a && preds[j] != b &&
+			    task->dt_distance[preds[j]] > before) {
+				before = task->dt_distance[preds[j]];
+			}
+		}
+		dnid_t *succs = dtask_succs(task, id);
+		for (uint32_t j = 0; j < dtask_outdeg(task, id); j++) {
+			if (succs[j] != a && succs[j] != b &&
+			    task->dt_tail[succs[j]] > after) {
+				after = task->dt_tail[succs[j]];
+			}
+		}
+	}
+	tint_t merged = before + wcet + after;
+	if (merged >= L) {
+		/* No path gets longer than the critical path otherwise */
+		*cpathlen = merged;
+		return 1;
+	}
+
+	/* A critical path through neither a nor b stays */
+	uint64_t ta = dtask_ncrit_through(task, a);
+	uint64_t tb = dtask_ncrit_through(task, b);
+	uint64_t tab = dtask_ncrit_edge(task, a, b) +
+	    dtask_ncrit_edge(task, b, a);
+	uint64_t hit = sat_add(ta, tb);
+	if (hit != UINT64_MAX && task->dt_ncrit != UINT64_MAX &&
+	    task->dt_ncrit > hit - tab) {
+		*cpathlen = L;
+		return 1;
+	}
+
+	/* Longest path through neither a nor b */
+	tint_t *sdist = task->dt_sdist;
+	sdist[a] = 0;
+	sdist[b] = 0;
+	tint_t rest = 0;
+	for (dnid_t i = 0; i < task->dt_nnodes; i++) {
+		dnid_t id = task->dt_order[i];
+		if (id == a || id == b) {
+			continue;
+		}
+		dnid_t *preds = dtask_preds(task, id);
+		tint_t maxd = 0;
+		for (uint32_t j = 0; j < dtask_indeg(task, id); j++) {
+			if (sdist[preds[j]] > maxd) {
+				maxd = sdist[preds[j]];
+			}
+		}
+		sdist[id] = task->dt_wcet[id] + maxd;
+		if (sdist[id] > rest) {
+			rest = sdist[id];
+		}
+	}
+	*cpathlen = rest > merged ? rest : merged;
+
+	return 1;
+}
+
+dtask_t *
+dtask_alloc(char* name) {
+	dtask_t *task = calloc(1, sizeof(dtask_t));
+	if (!task) {
+		return NULL;
+	}
+	strncpy(task->dt_name, name, DT_NAMELEN - 1);
+	if (!dtask_grow(task, 1)) {
+		dtask_free(task);
+		return NULL;
+	}
+	return task;
+}
+
+void
+dtask_free(dtask_t *task) {
+	if (!task) {
+		return;
+	}
+	darena_t *ar = task->dt_arena;
+	if (task->dt_source) {
+		dnode_free(task->dt_source);
+	}
+	if (ar) {
+		/* The rest goes with the arena */
+		if (task->dt_map) {
+			munmap(task->dt_map, task->dt_mapsize);
+			darena_free(ar);
+			free(task);
+		}
+		return;
+	}
+	for (dnid_t id = 0; id < task->dt_nids; id++) {
+		free(task->dt_nname[id]);
+	}
+	free(task->dt_nname);
+	free(task->dt_object);
+	free(task->dt_threads);
+	free(task->dt_wcet_one);
+	free(task->dt_wcet);
+	free(task->dt_factor);
+	free(task->dt_distance);
+	free(task->dt_mark);
+	free(task->dt_hbucket);
+	free(task->dt_hnext);
+	free(task->dt_seed);
+	free(task->dt_cone);
+	free(task->dt_queue);
+	free(task->dt_cnt);
+	free(task->dt_dfs);
+	free(task->dt_dfs_next);
+	free(task->dt_desc);
+	free(task->dt_far);
+	free(task->dt_order);
+	free(task->dt_tail);
+	free(task->dt_cf);
+	free(task->dt_cb);
+	free(task->dt_sdist);
+	free(task->dt_ohead);
+	free(task->dt_otail);
+	free(task->dt_ocount);
+	free(task->dt_onext);
+	free(task->dt_oprev);
+	if (task->dt_journal) {
+		dj_release(task, task->dt_journal);
+		free(task->dt_journal->dj_ent);
+		free(task->dt_journal->dj_ids);
+		free(task->dt_journal);
+	}
+	dadj_free(&task->dt_out);
+	dadj_free(&task->dt_in);
+	free(task);
+}
+
+/**
+ * Copies the row of id from src into dst, with no slack
+ */
+static int
+dadj_copy_row(dadj_t *dst, dadj_t *src, dnid_t id) {
+	uint32_t deg = src->da_deg[id];
+	if (!dadj_place_row(dst, id, deg)) {
+		return 0;
+	}
+	memcpy(dst->da_adj + dst->da_off[id], src->da_adj + src->da_off[id],
+	    deg * sizeof(dnid_t));
+	dst->da_deg[id] = deg;
+	dst->da_edges += deg;
+	return 1;
+}
+
+/**
+ * Clones the task, the ids of the nodes are kept. Walk state and
+ * indexes are not copied, they are rebuilt on demand.
+ */
+static dtask_t *
+dtask_clone(dtask_t *task, darena_t *arena) {
+	dtask_t *ntask = dt_malloc(arena, sizeof(dtask_t));
+	if (!ntask) {
+		return NULL;
+	}
+	memset(ntask, 0, sizeof(dtask_t));
+	ntask->dt_arena = arena;
+	ntask->dt_out.da_arena = arena;
+	ntask->dt_in.da_arena = arena;
+
+	memcpy(ntask->dt_name, task->dt_name, DT_NAMELEN);
+	ntask->dt_period = task->dt_period;
+	ntask->dt_deadline = task->dt_deadline;
+	ntask->dt_cpathlen = task->dt_cpathlen;
+	ntask->dt_workload = task->dt_workload;
+	ntask->dt_collapsed = task->dt_collapsed;
+	ntask->dt_flags.dirty = task->dt_flags.dirty;
+	ntask->dt_flags.lfull = task->dt_flags.lfull;
+	ntask->dt_flags.ldec = task->dt_flags.ldec;
+
+	dnid_t n = task->dt_nids;
+	if (!dtask_grow(ntask, n ? n : 1)) {
+		goto bail;
+	}
+	if (!dadj_reserve(&ntask->dt_out, task->dt_out.da_edges) ||
+	    !dadj_reserve(&ntask->dt_in, task->dt_in.da_edges)) {
+		goto bail;
+	}
+	memcpy(ntask->dt_object, task->dt_object, n * sizeof(tint_t));
+	memcpy(ntask->dt_threads, task->dt_threads, n * sizeof(tint_t));
+	memcpy(ntask->dt_wcet_one, task->dt_wcet_one, n * sizeof(tint_t));
+	memcpy(ntask->dt_wcet, task->dt_wcet, n * sizeof(tint_t));
+	memcpy(ntask->dt_factor, task->dt_factor, n * sizeof(float_t));
+	memcpy(ntask->dt_distance, task->dt_distance, n * sizeof(tint_t));
+	memcpy(ntask->dt_mark, task->dt_mark, n * sizeof(uint8_t));
+	memcpy(ntask->dt_seed, task->dt_seed, task->dt_nseed * sizeof(dnid_t));
+	ntask->dt_nseed = task->dt_nseed;
+	ntask->dt_nids = n;
+
+	dnid_t id;
+	dtask_foreach_id(task, id) {
+		ntask->dt_nname[id] = dt_strndup(arena, task->dt_nname[id],
+		    DT_NAMELEN - 1);
+		if (!ntask->dt_nname[id]) {
+			goto bail;
+		}
+		ntask->dt_nnodes++;
+		dtask_hash_link(ntask, id);
+		if (!dadj_copy_row(&ntask->dt_out, &task->dt_out, id) ||
+		    !dadj_copy_row(&ntask->dt_in, &task->dt_in, id)) {
+			goto bail;
+		}
+	}
+
+	if (task->dt_source && !task->dt_flags.dirty) {
+		id = dnode_id(task->dt_source);
+		if (id != DNID_NONE) {
+			ntask->dt_source = dtask_node_at(ntask, id);
+		}
+		if (!ntask->dt_source) {
+			ntask->dt_flags.dirty = 1;
+		}
+	} else {
+		ntask->dt_flags.dirty = 1;
+	}
+
+	return ntask;
+bail:
+	dtask_free(ntask);
+	return NULL;
+}
+
+dtask_t *
+dtask_copy(dtask_t *task) {
+	if (!task) {
+		return NULL;
+	}
+	return dtask_clone(task, NULL);
+}
+
+dtask_t *
+dtask_copy_arena(dtask_t *task, darena_t *arena) {
+	if (!task || !arena) {
+		return NULL;
+	}
+	return dtask_clone(task, arena);
+}
+
+dnid_t
+dtask_name_id(dtask_t *task, char *name) {
+	if (!task->dt_hsize) {
+		return DNID_NONE;
+	}
+	uint32_t b = name_hash(name) & (task->dt_hsize - 1);
+	dnid_t id;
+	for (id = task->dt_hbucket[b]; id != DNID_NONE;
+	     id = task->dt_hnext[id]) {
+		if (strcmp(task->dt_nname[id], name) == 0) {
+			return id;
+		}
+	}
+	return DNID_NONE;
+}
+
+dnode_t *
+dtask_node_at(dtask_t *task, dnid_t id) {
+	if (!dtask_node_live(task, id)) {
+		return NULL;
+	}
+	dnode_t *node = dnode_alloc(task->dt_nname[id]);
+	if (!node) {
+		return NULL;
+	}
+	dtask_load_node(task, id, node);
+
+	return node;
+}
+
+dnode_t *
+dtask_node_load(dtask_t *task, dnid_t id, dnode_t *node) {
+	if (!dtask_node_live(task, id)) {
+		return NULL;
+	}
+	strncpy(node->dn_name, task->dt_nname[id], DT_NAMELEN);
+	dtask_load_node(task, id, node);
+
+	return node;
+}
+
+dnid_t
+dtask_nnodes(dtask_t *task) {
+	return task->dt_nnodes;
+}
+
+dnode_t *
+dtask_name_search(dtask_t *task, char *name) {
+	dnid_t id = dtask_name_id(task, name);
+	if (id == DNID_NONE) {
+		return NULL;
+	}
+	return dtask_node_at(task, id);
+}
+
+dnode_t *
+dtask_name_match(dtask_t *task, char *name) {
+	dnode_t *exact = dtask_name_search(task, name);
+	if (exact) {
+		return exact;
+	}
+	dnode_t* best = NULL;
+	dnid_t id;
+	dtask_foreach_id(task, id) {
+		if (strstr(task->dt_nname[id], name) == NULL) {
+			continue;
+		}
+		/* found */
+		best = dtask_node_at(task, id);
+		if (best == NULL) {
+			/* Best we can do if OOM */
+			raise(SIGSEGV);
+		}
+		break;
+	}
+
+	return best;
+}
+
+int
+dtask_insert(dtask_t *task, dnode_t *node) {
+	/* Search for the node first */
+	if (dtask_name_id(task, node->dn_name) != DNID_NONE) {
+		/* Exists */
+		return 0;
+	}
+	dnid_t id = dtask_new_id(task, node->dn_name);
+	if (id == DNID_NONE) {
+		/* Could not allocate */
+		return 0;
+	}
+	task->dt_flags.dirty = 1;
+	task->dt_flags.reach = 0;
+	/* Fill node values into the node arrays */
+	dnode_calc_wcet(node);
+	dtask_store_node(task, id, node);
+	/* Marks of walks over another task do not carry over */
+	task->dt_mark[id] &= ~(DN_VISITED | DN_MARKED);
+	task->dt_workload += task->dt_wcet[id];
+	dtask_seed(task, id);
+
+	/* Track last insertion */
+	node->dn_id = id;
+	node->dn_task = task;
+	node->dn_flags.dirty = 0;
+
+	return 1;
+}
+
+int
+dtask_name_remove(dtask_t *task, char *name) {
+	dnid_t id = dtask_name_id(task, name);
+	if (id == DNID_NONE) {
+		return 0;
+	}
+	dtask_drop_id(task, id);
+	task->dt_flags.dirty = 1;
+	task->dt_flags.reach = 0;
+
+	return 1;
+}
+
+int
+dtask_remove(dtask_t *task, dnode_t *node) {
+	if (!dtask_name_remove(task, node->dn_name)) {
+		return 0;
+	}
+	
+	node->dn_task = NULL;
+	node->dn_id = DNID_NONE;
+	node->dn_flags.dirty = 0;
+
+	return 1;
+}
+
+int
+dtask_insert_edge(dtask_t *task, dnode_t *src, dnode_t *dst) {
+	if (src->dn_flags.dirty || dst->dn_flags.dirty) {
+		/* Nodes must be updated before an edge can be added */
+		return 0;
+	}
+	if (src->dn_task != task || dst->dn_task != task) {
+		/* Nodes must be in the task */
+		return 0;
+	}
+	dnid_t a = dnode_id(src);
+	dnid_t b = dnode_id(dst);
+	if (a == DNID_NONE || b == DNID_NONE || a == b) {
+		return 0;
+	}
+	if (dadj_find(&task->dt_out, a, b) >= 0) {
+		/* Edge is already present */
+		return 0;
+	}
+	if (!dadj_push(&task->dt_out, task->dt_nids, a, b)) {
+		/* Could not add the edge */
+		return 0;
+	}
+	if (!dadj_push(&task->dt_in, task->dt_nids, b, a)) {
+		dadj_del(&task->dt_out, a, dtask_outdeg(task, a) - 1);
+		return 0;
+	}
+	djournal_t *dj = dtask_jnl(task);
+	djent_t *e = dj ? dj_push(task, dj, DJ_EDGE, a) : NULL;
+	if (e) {
+		e->je_nbr = b;
+	}
+	task->dt_flags.dirty = 1;
+	task->dt_flags.reach = 0;
+	dtask_seed(task, b);
+	return 1;
+}
+
+int
+dtask_remove_edge(dtask_t *task, dnode_t *src, dnode_t *dst) {
+	dnid_t a = dtask_name_id(task, src->dn_name);
+	dnid_t b = dtask_name_id(task, dst->dn_name);
+
+	if (a == DNID_NONE || b == DNID_NONE) {
+		return 0;
+	}
+
+	int out = dadj_find(&task->dt_out, a, b);
+	if (out < 0) {
+		return 0;
+	}
+	int in = dadj_find(&task->dt_in, b, a);
+	dadj_del(&task->dt_out, a, out);
+	dadj_del(&task->dt_in, b, in);
+	djournal_t *dj = dtask_jnl(task);
+	djent_t *e = dj ? dj_push(task, dj, DJ_DEL_OUT, a) : NULL;
+	if (e) {
+		e->je_nbr = b;
+		e->je_idx = out;
+	}
+	e = dj ? dj_push(task, dj, DJ_DEL_IN, b) : NULL;
+	if (e) {
+		e->je_nbr = a;
+		e->je_idx = in;
+	}
+	task->dt_flags.dirty = 1;
+	task->dt_flags.reach = 0;
+	task->dt_flags.ldec = 1;
+	dtask_seed(task, b);
+	return 1;
+}
+
+dedge_t *
+dtask_search_edge(dtask_t *task, char *sname, char *dname) {
+	dnid_t a = dtask_name_id(task, sname);
+	dnid_t b = dtask_name_id(task, dname);
+
+	if (a == DNID_NONE || b == DNID_NONE) {
+		return NULL;
+	}
+
+	int idx = dadj_find(&task->dt_out, a, b);
+	if (idx < 0) {
+		return NULL;
+	}
+
+	dedge_t *e = dedge_alloc("");
+	dedge_fill(e, task, a, idx);
+
+	return e;
+}
+
+/**
+ * Reads a tint_t attribute, zero if it is not present
+ */
+static tint_t
+agget_tint(void *obj, char *attr) {
+	char *v = agget(obj, attr);
+	if (!v) {
+		return 0;
+	}
+	return strtoull(v, NULL, 10);
+}
+
+/**
+ * Whether str is a DOT numeral, [-]?(.[0-9]+ | [0-9]+(.[0-9]*)?)
+ */
+static int
+dot_numeral(const char *str) {
+	int digits = 0;
+	int dot = 0;
+
+	if (*str == '-') {
+		str++;
+	}
+	for (; *str; str++) {
+		if (isdigit((unsigned char) *str)) {
+			digits++;
+		} else if (*str == '.' && !dot) {
+			dot = 1;
+		} else {
+			return 0;
+		}
+	}
+	return digits > 0;
+}
+
+/**
+ * Writes str as a DOT identifier, quoted unless it is a plain one
+ */
+static void
+dot_write_id(FILE *file, const char *str) {
+	static const char *keywords[] = { "node", "edge", "graph", "digraph",
+	    "subgraph", "strict", NULL };
+	const char *c;
+	int plain = *str && !isdigit((unsigned char) *str);
+
+	for (c = str; plain && *c; c++) {
+		plain = isalnum((unsigned char) *c) || *c == '_' ||
+		    (unsigned char) *c >= 0x80;
+	}
+	for (int i = 0; plain && keywords[i]; i++) {
+		plain = strcasecmp(str, keywords[i]) != 0;
+	}
+	if (plain || dot_numeral(str)) {
+		fputs(str, file);
+		return;
+	}
+	fputc('"', file);
+	for (c = str; *c; c++) {
+		if (*c == '"') {
+			fputc('\\', file);
+		}
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+/**
+ * Writes the attribute attr=val, unless val is the default def
+ */
+static void
+dot_write_attr(FILE *file, int *first, const char *attr, const char *val,
+    const char *def) {
+	if (def && strcmp(val, def) == 0) {
+		return;
+	}
+	fputs(*first ? "\t [" : ",\n\t\t", file);
+	*first = 0;
+	fprintf(file, "%s=", attr);
+	dot_write_id(file, val);
+}
+
+int
+dtask_write(dtask_t *task, FILE *file) {
+	char buff[DT_NAMELEN];
+	dnode_t node;
+	dnid_t id;
+
+	dtask_update(task);
+
+	fputs("strict digraph ", file);
+	dot_write_id(file, task->dt_name);
+	fprintf(file, " {\n"
+	    "\tgraph [" DT_DEADLINE "=%ld,\n"
+	    "\t\t" DT_PERIOD "=%ld,\n"
+	    "\t\t" DT_WORKLOAD "=%ld,\n"
+	    "\t\t" DT_CPATHLEN "=%ld,\n"
+	    "\t\t" DT_COLLAPSED "=%ld];\n",
+	    task->dt_deadline, task->dt_period, task->dt_workload,
+	    task->dt_cpathlen, task->dt_collapsed);
+	fputs("\tnode [shape=rectangle,\n"
+	    "\t\t" DT_THREADS "=0,\n"
+	    "\t\t" DT_OBJECT "=0,\n"
+	    "\t\t" DT_WCET_ONE "=0,\n"
+	    "\t\t" DT_WCET "=0,\n"
+	    "\t\t" DT_FACTOR "=0,\n"
+	    "\t\t" DT_MARKED "=0,\n"
+	    "\t\t" DT_VISITED "=0,\n"
+	    "\t\t" DT_DISTANCE "=0,\n"
+	    "\t\ttexlbl=\"\"];\n", file);
+
+	/* All nodes first, so that reading the file keeps their order */
+	dtask_foreach_id(task, id) {
+		int first = 1;
+		memset(&node, 0, sizeof(dnode_t));
+		strncpy(node.dn_name, task->dt_nname[id], DT_NAMELEN - 1);
+		dtask_load_node(task, id, &node);
+
+		fputc('\t', file);
+		dot_write_id(file, node.dn_name);
+		sprintf(buff, "%ld", node.dn_threads);
+		dot_write_attr(file, &first, DT_THREADS, buff, "0");
+		sprintf(buff, "%ld", node.dn_object);
+		dot_write_attr(file, &first, DT_OBJECT, buff, "0");
+		sprintf(buff, "%ld", node.dn_wcet_one);
+		dot_write_attr(file, &first, DT_WCET_ONE, buff, "0");
+		sprintf(buff, "%ld", node.dn_wcet);
+		dot_write_attr(file, &first, DT_WCET, buff, "0");
+		sprintf(buff, "%f", node.dn_factor);
+		dot_write_attr(file, &first, DT_FACTOR, buff, "0");
+		dot_write_attr(file, &first, DT_MARKED,
+		    node.dn_flags.marked ? "1" : "0", "0");
+		dot_write_attr(file, &first, DT_VISITED,
+		    node.dn_flags.visited ? "1" : "0", "0");
+		sprintf(buff, "%ld", node.dn_distance);
+		dot_write_attr(file, &first, DT_DISTANCE, buff, "0");
+		dnode_make_label(&node);
+		dot_write_attr(file, &first, "texlbl", node.dn_label, "");
+		fputs(first ? ";\n" : "];\n", file);
+	}
+	dtask_foreach_id(task, id) {
+		dnid_t *succs = dtask_succs(task, id);
+		for (uint32_t i = 0; i < dtask_outdeg(task, id); i++) {
+			fputc('\t', file);
+			dot_write_id(file, task->dt_nname[id]);
+			fputs(" -> ", file);
+			dot_write_id(file, task->dt_nname[succs[i]]);
+			fputs(";\n", file);
+		}
+	}
+	fputs("}\n", file);
+
+	return !ferror(file);
+}
+
+int
+dtask_write_layout(dtask_t *task, FILE *file) {
+	char buff[DT_NAMELEN * 2 + 5];
+	dnode_t node;
+	dnid_t id;
+
+	dtask_update(task);
+	pthread_mutex_lock(&gv_lock);
+	if (!gvc) {
+		gvc = gvContext();
+	}
+	Agraph_t *g = agopen(task->dt_name, Agstrictdirected, NULL);
+	Agnode_t **agn = calloc(task->dt_nids + 1, sizeof(Agnode_t *));
+	if (!g || !agn) {
+		goto bail;
+	}
+
+	/* Set defaults for the graph */
+	agattr(g, AGNODE, "shape", "rectangle");
+	agattr(g, AGNODE, DT_THREADS, "0");
+	agattr(g, AGNODE, DT_OBJECT, "0");
+	agattr(g, AGNODE, DT_WCET_ONE, "0");
+	agattr(g, AGNODE, DT_WCET, "0");
+	agattr(g, AGNODE, DT_FACTOR, "0");
+	agattr(g, AGNODE, DT_MARKED, "0");
+	agattr(g, AGNODE, DT_VISITED, "0");
+	agattr(g, AGNODE, DT_DISTANCE, "0");	
+	agattr(g, AGNODE, "texlbl", "");
+	agattr(g, AGRAPH, DT_DEADLINE, "0");
+	agattr(g, AGRAPH, DT_PERIOD, "0");	
+	agattr(g, AGRAPH, DT_WORKLOAD, "0");
+	agattr(g, AGRAPH, DT_CPATHLEN, "0");
+	agattr(g, AGRAPH, DT_COLLAPSED, "0");
+
+	sprintf(buff, "%ld", task->dt_period);
+	agset(g, DT_PERIOD, buff);
+	sprintf(buff, "%ld", task->dt_deadline);
+	agset(g, DT_DEADLINE, buff);
+	sprintf(buff, "%ld", task->dt_workload);
+	agset(g, DT_WORKLOAD, buff);
+	sprintf(buff, "%ld", task->dt_cpathlen);
+	agset(g, DT_CPATHLEN, buff);
+	sprintf(buff, "%ld", task->dt_collapsed);
+	agset(g, DT_COLLAPSED, buff);
+
+	dtask_foreach_id(task, id) {
+		agn[id] = agnode(g, task->dt_nname[id], TRUE);
+		if (!agn[id]) {
+			goto bail;
+		}
+		memset(&node, 0, sizeof(dnode_t));
+		strncpy(node.dn_name, task->dt_nname[id], DT_NAMELEN - 1);
+		dtask_load_node(task, id, &node);
+		dnode_to_agnode(&node, agn[id]);
+	}
+	dtask_foreach_id(task, id) {
+		dnid_t *succs = dtask_succs(task, id);
+		for (uint32_t i = 0; i < dtask_outdeg(task, id); i++) {
+			sprintf(buff, "%s -> %s", task->dt_nname[id],
+			    task->dt_nname[succs[i]]);
+			agedge(g, agn[id], agn[succs[i]], buff, TRUE);
+		}
+	}
+	
+	gvLayout(gvc, g, "dot");
+	gvRender(gvc, g, "dot", file);
+	gvFreeLayout(gvc, g);
+
+	free(agn);
+	agclose(g);
+	pthread_mutex_unlock(&gv_lock);
+	return 1;
+bail:
+	free(agn);
+	if (g) {
+		agclose(g);
+	}
+	pthread_mutex_unlock(&gv_lock);
+	return 0;
+}
+
+/**
+ * Maps a binary task from a stream that cannot be mapped in place, a
+ * pipe or a file read past its start, through a temporary copy
+ */
+static dtask_t *
+dtask_map_stream(FILE *file) {
+	char buff[BUFSIZ];
+	dtask_t *task = NULL;
+	size_t len;
+	FILE *tmp = tmpfile();
+
+	if (!tmp) {
+		return NULL;
+	}
+	while ((len = fread(buff, 1, sizeof(buff), file)) > 0) {
+		if (fwrite(buff, 1, len, tmp) != len) {
+			goto bail;
+		}
+	}
+	if (ferror(file) || fflush(tmp)) {
+		goto bail;
+	}
+	task = dtask_map(fileno(tmp));
+bail:
+	fclose(tmp);
+	return task;
+}
+
+dtask_t *
+dtask_read(FILE *file) {
+	dtask_t *task = NULL;
+	dnode_t node;
+	Agnode_t *n;
+	Agedge_t *e;
+
+	int c = getc(file);
+	ungetc(c, file);
+	if (c == (unsigned char) DT_BIN_MAGIC[0]) {
+		struct stat st;
+		/* In place if the stream is a file read from its start */
+		if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) &&
+		    ftello(file) == 0) {
+			return dtask_map(fileno(file));
+		}
+		return dtask_map_stream(file);
+	}
+
+	pthread_mutex_lock(&gv_lock);
+	Agraph_t *g = agread(file, NULL);
+	if (!g) {
+		goto bail;
+	}
+	task = dtask_alloc(agnameof(g));
+	if (!task || !dtask_grow(task, agnnodes(g))) {
+		goto bail;
+	}
+
+	/* Nodes, in the order of the file */
+	for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
+		dnid_t id = dtask_new_id(task, agnameof(n));
+		if (id == DNID_NONE) {
+			goto bail;
+		}
+		memset(&node, 0, sizeof(dnode_t));
+		agnode_to_dnode(n, &node);
+		dnode_calc_wcet(&node);
+		dtask_store_node(task, id, &node);
+		task->dt_workload += task->dt_wcet[id];
+
+		int out = agdegree(g, n, FALSE, TRUE);
+		int in = agdegree(g, n, TRUE, FALSE);
+		if (!dadj_place_row(&task->dt_out, id, out) ||
+		    !dadj_place_row(&task->dt_in, id, in)) {
+			goto bail;
+		}
+	}
+
+	/* Edges, in the order of cgraph */
+	for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
+		dnid_t id = dtask_name_id(task, agnameof(n));
+		for (e = agfstout(g, n); e; e = agnxtout(g, e)) {
+			dnid_t b = dtask_name_id(task, agnameof(aghead(e)));
+			dadj_push(&task->dt_out, task->dt_nids, id, b);
+		}
+		for (e = agfstin(g, n); e; e = agnxtin(g, e)) {
+			dnid_t a = dtask_name_id(task, agnameof(agtail(e)));
+			dadj_push(&task->dt_in, task->dt_nids, id, a);
+		}
+	}
+	
+	task->dt_period = agget_tint(g, DT_PERIOD);
+	task->dt_deadline = agget_tint(g, DT_DEADLINE);
+	task->dt_collapsed = agget_tint(g, DT_COLLAPSED);
+	agclose(g);
+	pthread_mutex_unlock(&gv_lock);
+	/* Distances in the file are not trusted */
+	task->dt_flags.lfull = 1;
+	dtask_update(task);
+	
+	return task;
+bail:
+	if (g) {
+		agclose(g);
+	}
+	pthread_mutex_unlock(&gv_lock);
+	if (task) {
+		dtask_free(task);
+	}
+	return NULL;
+}
+
+dtask_t *
+dtask_read_path(char* path) {
+	dtask_t *task = NULL;
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		goto bail;
+	}
+	task = dtask_read(file);
+	fclose(file);
+bail:
+	return task;
+}
+
+/**
+ * BINARY FORMAT
+ *
+ * The header is followed by these sections, each padded to 8 bytes:
+ *
+ *	dt_object, dt_threads, dt_wcet_one, dt_wcet, dt_distance,
+ *	dt_factor, dt_mark	[db_nids]
+ *	dt_hbucket		[db_hsize]
+ *	dt_hnext		[db_nids]
+ *	out da_off, da_deg, da_cap [db_nids], da_adj [db_out_edges]
+ *	in da_off, da_deg, da_cap [db_nids], da_adj [db_in_edges]
+ *	name offsets		[db_nids], UINT32_MAX if removed
+ *	names			[db_strings], NUL terminated
+ *
+ * Rows are packed, so the capacity of a row is its degree. Values are
+ * in the byte order of the writer.
+ */
+#define DT_BIN_VERSION	1
+
+typedef struct {
+	char	db_magic[8];
+	uint32_t db_version;
+	uint32_t db_hsize;	/** Buckets of the name hash */
+	char	db_name[DT_NAMELEN];
+	tint_t	db_period;
+	tint_t	db_deadline;
+	tint_t	db_cpathlen;
+	tint_t	db_workload;
+	tint_t	db_collapsed;
+	dnid_t	db_nids;
+	dnid_t	db_nnodes;
+	dnid_t	db_source;	/** DNID_NONE if there is none */
+	uint32_t db_out_edges;
+	uint32_t db_in_edges;
+	uint32_t db_pad;
+	uint64_t db_strings;	/** Bytes of the names */
+	uint64_t db_size;	/** Bytes of the file */
+} dtask_bin_t;
+
+#define DT_BIN_PAD(n)	(((n) + 7) & ~(uint64_t) 7)
+
+/**
+ * Size of the file described by the header, zero if it overflows
+ */
+static uint64_t
+dtask_bin_size(dtask_bin_t *hdr) {
+	uint64_t n = hdr->db_nids;
+	uint64_t size = DT_BIN_PAD(sizeof(dtask_bin_t));
+
+	if (hdr->db_strings > UINT32_MAX) {
+		return 0;
+	}
+	size += 5 * DT_BIN_PAD(n * sizeof(tint_t));
+	size += DT_BIN_PAD(n * sizeof(float_t));
+	size += DT_BIN_PAD(n * sizeof(uint8_t));
+	size += DT_BIN_PAD((uint64_t) hdr->db_hsize * sizeof(dnid_t));
+	size += DT_BIN_PAD(n * sizeof(dnid_t));
+	size += 2 * 3 * DT_BIN_PAD(n * sizeof(uint32_t));
+	size += DT_BIN_PAD((uint64_t) hdr->db_out_edges * sizeof(dnid_t));
+	size += DT_BIN_PAD((uint64_t) hdr->db_in_edges * sizeof(dnid_t));
+	size += DT_BIN_PAD(n * sizeof(uint32_t));
+	size += DT_BIN_PAD(hdr->db_strings);
+	return size;
+}
+
+/**
+ * Pads a section of size bytes
+ */
+static int
+bin_pad(FILE *file, uint64_t size) {
+	static const char zero[8];
+	uint64_t pad = DT_BIN_PAD(size) - size;
+	return !pad || fwrite(zero, 1, pad, file) == pad;
+}
+
+/**
+ * Writes size bytes of data as a section
+ */
+static int
+bin_write(FILE *file, const void *data, uint64_t size) {
+	if (size && fwrite(data, 1, size, file) != size) {
+		return 0;
+	}
+	return bin_pad(file, size);
+}
+
+/**
+ * Writes the packed rows of adj
+ */
+static int
+bin_write_adj(FILE *file, dtask_t *task, dadj_t *adj) {
+	dnid_t n = task->dt_nids;
+	uint32_t *off = malloc((n + 1) * sizeof(uint32_t));
+	if (!off) {
+		return 0;
+	}
+	off[0] = 0;
+	for (dnid_t id = 0; id < n; id++) {
+		off[id + 1] = off[id] + adj->da_deg[id];
+	}
+	int ok = bin_write(file, off, n * sizeof(uint32_t));
+	ok = ok && bin_write(file, adj->da_deg, n * sizeof(uint32_t));
+	ok = ok && bin_write(file, adj->da_deg, n * sizeof(uint32_t));
+	for (dnid_t id = 0; ok && id < n; id++) {
+		uint64_t size = adj->da_deg[id] * sizeof(dnid_t);
+		ok = !size || fwrite(adj->da_adj + adj->da_off[id], 1, size,
+		    file) == size;
+	}
+	ok = ok && bin_pad(file, adj->da_edges * sizeof(dnid_t));
+	free(off);
+	return ok;
+}
+
+int
+dtask_write_bin(dtask_t *task, FILE *file) {
+	dtask_bin_t hdr;
+	dnid_t n;
+	dnid_t id;
+	uint32_t *names = NULL;
+	uint8_t *mark = NULL;
+	int ok = 0;
+
+	dtask_update(task);
+	n = task->dt_nids;
+	names = malloc((n + 1) * sizeof(uint32_t));
+	mark = malloc(n + 1);
+	if (!names || !mark) {
+		goto bail;
+	}
+
+	memset(&hdr, 0, sizeof(dtask_bin_t));
+	memcpy(hdr.db_magic, DT_BIN_MAGIC, sizeof(hdr.db_magic));
+	hdr.db_version = DT_BIN_VERSION;
+	hdr.db_hsize = task->dt_hsize;
+	strncpy(hdr.db_name, task->dt_name, DT_NAMELEN - 1);
+	hdr.db_period = task->dt_period;
+	hdr.db_deadline = task->dt_deadline;
+	hdr.db_cpathlen = task->dt_cpathlen;
+	hdr.db_workload = task->dt_workload;
+	hdr.db_collapsed = task->dt_collapsed;
+	hdr.db_nids = n;
+	hdr.db_nnodes = task->dt_nnodes;
+	hdr.db_source = task->dt_source ? dnode_id(task->dt_source) :
+	    DNID_NONE;
+	hdr.db_out_edges = task->dt_out.da_edges;
+	hdr.db_in_edges = task->dt_in.da_edges;
+	for (id = 0; id < n; id++) {
+		names[id] = UINT32_MAX;
+		mark[id] = task->dt_mark[id] & (DN_VISITED | DN_MARKED);
+		if (task->dt_nname[id]) {
+			names[id] = hdr.db_strings;
+			hdr.db_strings += strlen(task->dt_nname[id]) + 1;
+		}
+	}
+	hdr.db_size = dtask_bin_size(&hdr);
+	if (!hdr.db_size) {
+		goto bail;
 	}
-}
 
-dtask_t *
-dtask_alloc(char* name) {
-	if (!gvc) {
-		gvc = gvContext();
+	ok = bin_write(file, &hdr, sizeof(dtask_bin_t));
+	ok = ok && bin_write(file, task->dt_object, n * sizeof(tint_t));
+	ok = ok && bin_write(file, task->dt_threads, n * sizeof(tint_t));
+	ok = ok && bin_write(file, task->dt_wcet_one, n * sizeof(tint_t));
+	ok = ok && bin_write(file, task->dt_wcet, n * sizeof(tint_t));
+	ok = ok && bin_write(file, task->dt_distance, n * sizeof(tint_t));
+	ok = ok && bin_write(file, task->dt_factor, n * sizeof(float_t));
+	ok = ok && bin_write(file, mark, n * sizeof(uint8_t));
+	ok = ok && bin_write(file, task->dt_hbucket,
+	    task->dt_hsize * sizeof(dnid_t));
+	ok = ok && bin_write(file, task->dt_hnext, n * sizeof(dnid_t));
+	ok = ok && bin_write_adj(file, task, &task->dt_out);
+	ok = ok && bin_write_adj(file, task, &task->dt_in);
+	ok = ok && bin_write(file, names, n * sizeof(uint32_t));
+	for (id = 0; ok && id < n; id++) {
+		if (task->dt_nname[id]) {
+			ok = fputs(task->dt_nname[id], file) >= 0 &&
+			    fputc('\0', file) != EOF;
+		}
 	}
-	dtask_t *task = calloc(1, sizeof(dtask_t));
-	strncpy(task->dt_name, name, DT_NAMELEN);
-	task->dt_graph = agopen(name, Agstrictdirected, NULL);
-	
-	/* Set defaults for the graph */
-	agattr(task->dt_graph, AGNODE, "shape", "rectangle");
-	agattr(task->dt_graph, AGNODE, DT_THREADS, "0");
-	agattr(task->dt_graph, AGNODE, DT_OBJECT, "0");
-	agattr(task->dt_graph, AGNODE, DT_WCET_ONE, "0");
-	agattr(task->dt_graph, AGNODE, DT_WCET, "0");
-	agattr(task->dt_graph, AGNODE, DT_FACTOR, "0");
-	agattr(task->dt_graph, AGNODE, DT_MARKED, "0");
-	agattr(task->dt_graph, AGNODE, DT_VISITED, "0");
-	agattr(task->dt_graph, AGNODE, DT_DISTANCE, "0");	
-	agattr(task->dt_graph, AGNODE, "texlbl", "");
-	agattr(task->dt_graph, AGRAPH, DT_DEADLINE, "0");
-	agattr(task->dt_graph, AGRAPH, DT_PERIOD, "0");	
-	agattr(task->dt_graph, AGRAPH, DT_WORKLOAD, "0");
-	agattr(task->dt_graph, AGRAPH, DT_CPATHLEN, "0");
-	agattr(task->dt_graph, AGRAPH, DT_COLLAPSED, "0");
-	return task;
+	ok = ok && bin_pad(file, hdr.db_strings);
+bail:
+	free(names);
+	free(mark);
+	return ok;
 }
 
-void
-dtask_free(dtask_t *task) {
-	if (!task) {
-		return;
+/**
+ * Points an adjacency at its sections of the mapping
+ *
+ * @return non-zero if the rows are within the pool and the neighbors
+ * are node ids, zero otherwise
+ */
+static int
+bin_map_adj(dadj_t *adj, char **cur, dnid_t n, uint32_t edges) {
+	adj->da_off = (uint32_t *) *cur;
+	*cur += DT_BIN_PAD(n * sizeof(uint32_t));
+	adj->da_deg = (uint32_t *) *cur;
+	*cur += DT_BIN_PAD(n * sizeof(uint32_t));
+	adj->da_cap = (uint32_t *) *cur;
+	*cur += DT_BIN_PAD(n * sizeof(uint32_t));
+	adj->da_adj = (dnid_t *) *cur;
+	*cur += DT_BIN_PAD((uint64_t) edges * sizeof(dnid_t));
+	adj->da_len = edges;
+	adj->da_size = edges;
+	adj->da_edges = edges;
+
+	for (dnid_t id = 0; id < n; id++) {
+		if (adj->da_cap[id] < adj->da_deg[id] ||
+		    adj->da_off[id] > edges ||
+		    adj->da_cap[id] > edges - adj->da_off[id]) {
+			return 0;
+		}
 	}
-	if (task->dt_source) {
-		dnode_free(task->dt_source);
+	for (uint32_t i = 0; i < edges; i++) {
+		if (adj->da_adj[i] >= n) {
+			return 0;
+		}
 	}
-	if (task->dt_graph) {
-		agclose(task->dt_graph);
-		task->dt_graph = NULL;
+	return 1;
+}
+
+/**
+ * Checks the mapped hash table, every chain must only go through live
+ * ids hashed to its bucket and all the live ids must be in one
+ *
+ * @return non-zero if every name lookup ends, zero otherwise
+ */
+static int
+bin_check_hash(dtask_t *task) {
+	dnid_t seen = 0;
+
+	for (uint32_t b = 0; b < task->dt_hsize; b++) {
+		dnid_t id;
+		for (id = task->dt_hbucket[b]; id != DNID_NONE;
+		     id = task->dt_hnext[id]) {
+			/* A chain longer than the live ids loops */
+			if (!dtask_node_live(task, id) ||
+			    seen++ == task->dt_nnodes ||
+			    (name_hash(task->dt_nname[id]) &
+			    (task->dt_hsize - 1)) != b) {
+				return 0;
+			}
+		}
 	}
-	free(task);
+	return seen == task->dt_nnodes;
 }
 
 dtask_t *
-dtask_copy(dtask_t *task) {
-	dtask_t *ntask = NULL;
-	if (!task) {
+dtask_map(int fd) {
+	struct stat st;
+	dtask_t *task = NULL;
+	darena_t *arena = NULL;
+	char *map = MAP_FAILED;
+	dtask_bin_t *hdr;
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+	    (uint64_t) st.st_size < sizeof(dtask_bin_t)) {
 		return NULL;
 	}
-	FILE *tmp = tmpfile();
-	if (!tmp) {
+	/* Private, the task may be modified without touching the file */
+	map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+	    fd, 0);
+	if (map == MAP_FAILED) {
 		return NULL;
 	}
-	if (!dtask_write(task, tmp)) {
+	hdr = (dtask_bin_t *) map;
+	if (memcmp(hdr->db_magic, DT_BIN_MAGIC, sizeof(hdr->db_magic)) ||
+	    hdr->db_version != DT_BIN_VERSION ||
+	    hdr->db_hsize < 16 || (hdr->db_hsize & (hdr->db_hsize - 1)) ||
+	    hdr->db_nnodes > hdr->db_nids ||
+	    hdr->db_size != dtask_bin_size(hdr) ||
+	    hdr->db_size > (uint64_t) st.st_size) {
 		goto bail;
 	}
-	rewind(tmp);
 
-	ntask = calloc(1, sizeof(dtask_t));
-	strncpy(ntask->dt_name, task->dt_name, DT_NAMELEN);
-	ntask->dt_graph = agread(tmp, NULL);
-	if (!ntask->dt_graph) {
+	dnid_t n = hdr->db_nids;
+	task = calloc(1, sizeof(dtask_t));
+	/* Growth and scratch arrays, the rest is in the mapping */
+	arena = darena_alloc(16 * (n + 1) * sizeof(uint64_t));
+	if (!task || !arena) {
 		goto bail;
 	}
-	
-	ntask->dt_period = task->dt_period;
-	ntask->dt_deadline = task->dt_deadline;
-	ntask->dt_cpathlen = task->dt_cpathlen;
-	ntask->dt_workload = task->dt_workload;
-
-	fclose(tmp);
-	return ntask;
-bail:
-	if (tmp) {
-		fclose(tmp);
-	}
-	if (ntask) {
-		dtask_free(ntask);
+	task->dt_arena = arena;
+	task->dt_out.da_arena = arena;
+	task->dt_in.da_arena = arena;
+	task->dt_map = map;
+	task->dt_mapsize = st.st_size;
+
+	strncpy(task->dt_name, hdr->db_name, DT_NAMELEN - 1);
+	task->dt_period = hdr->db_period;
+	task->dt_deadline = hdr->db_deadline;
+	task->dt_cpathlen = hdr->db_cpathlen;
+	task->dt_workload = hdr->db_workload;
+	task->dt_collapsed = hdr->db_collapsed;
+	task->dt_nids = n;
+	task->dt_nnodes = hdr->db_nnodes;
+	task->dt_ncap = n;
+	task->dt_hsize = hdr->db_hsize;
+
+	char *cur = map + DT_BIN_PAD(sizeof(dtask_bin_t));
+	task->dt_object = (tint_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(tint_t));
+	task->dt_threads = (tint_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(tint_t));
+	task->dt_wcet_one = (tint_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(tint_t));
+	task->dt_wcet = (tint_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(tint_t));
+	task->dt_distance = (tint_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(tint_t));
+	task->dt_factor = (float_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(float_t));
+	task->dt_mark = (uint8_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(uint8_t));
+	task->dt_hbucket = (dnid_t *) cur;
+	cur += DT_BIN_PAD((uint64_t) hdr->db_hsize * sizeof(dnid_t));
+	task->dt_hnext = (dnid_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(dnid_t));
+	if (!bin_map_adj(&task->dt_out, &cur, n, hdr->db_out_edges) ||
+	    !bin_map_adj(&task->dt_in, &cur, n, hdr->db_in_edges)) {
+		goto bail;
 	}
-	return NULL;
-}
-
-dnode_t *
-dtask_name_search(dtask_t *task, char *name) {
-	Agnode_t *ag_node = agnode(task->dt_graph, name, FALSE);
-	if (!ag_node) {
-		return NULL;
+	uint32_t *names = (uint32_t *) cur;
+	cur += DT_BIN_PAD(n * sizeof(uint32_t));
+	char *strings = cur;
+	if (hdr->db_strings && strings[hdr->db_strings - 1] != '\0') {
+		goto bail;
 	}
-	dnode_t *node = dnode_alloc(name);
-	agnode_to_dnode(ag_node, node);
-	node->dn_task = task;
-	node->dn_node = ag_node;
-	node->dn_flags.dirty = 0;
-
-	return node;
-}
 
-dnode_t *
-dtask_name_match(dtask_t *task, char *name) {
-	dnode_t *exact = dtask_name_search(task, name);
-	if (exact) {
-		return exact;
+	task->dt_nname = darena_get(arena, n * sizeof(char *));
+	if (n && !task->dt_nname) {
+		goto bail;
 	}
-	dnode_t* best = NULL;
-	Agnode_t *agnode = agfstnode(task->dt_graph);
-	for(; agnode; agnode = agnxtnode(task->dt_graph, agnode)) {
-		char *agname = agnameof(agnode);
-		if (strstr(agname, name) == NULL) {
+	dnid_t live = 0;
+	for (dnid_t id = 0; id < n; id++) {
+		task->dt_nname[id] = NULL;
+		if (names[id] == UINT32_MAX) {
 			continue;
 		}
-		/* found */
-		best = dnode_alloc(agname);
-		agnode_to_dnode(agnode, best);
-		best->dn_task = task;
-		if (best == NULL) {
-			/* Best we can do if OOM */
-			raise(SIGSEGV);
+		if (names[id] >= hdr->db_strings) {
+			goto bail;
 		}
-		break;
+		task->dt_nname[id] = strings + names[id];
+		live++;
+	}
+	if (live != task->dt_nnodes || !bin_check_hash(task)) {
+		goto bail;
 	}
 
-	return best;
-}
+	/* Scratch */
+	int ok = 1;
+	ok = ok && grow_array(arena, (void **) &task->dt_seed,
+	    sizeof(dnid_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_cone,
+	    sizeof(dnid_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_queue,
+	    sizeof(dnid_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_cnt,
+	    sizeof(uint32_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_dfs,
+	    sizeof(dnid_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_dfs_next,
+	    sizeof(uint32_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_order,
+	    sizeof(dnid_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_tail,
+	    sizeof(tint_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_cf,
+	    sizeof(uint64_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_cb,
+	    sizeof(uint64_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_sdist,
+	    sizeof(tint_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_onext,
+	    sizeof(dnid_t), 0, n);
+	ok = ok && grow_array(arena, (void **) &task->dt_oprev,
+	    sizeof(dnid_t), 0, n);
+	if (!ok) {
+		goto bail;
+	}
 
-int
-dtask_insert(dtask_t *task, dnode_t *node) {
-	/* Search for the node first */
-	Agnode_t *ag_node = agnode(task->dt_graph, node->dn_name, FALSE);
-	if (ag_node) {
-		/* Exists */
-		return 0;
+	if (hdr->db_source != DNID_NONE &&
+	    dtask_node_live(task, hdr->db_source)) {
+		task->dt_source = dtask_node_at(task, hdr->db_source);
 	}
-	ag_node = agnode(task->dt_graph, node->dn_name, TRUE);
-	if (!ag_node) {
-		/* Could not allocate */
-		return 0;
+	if (!task->dt_source) {
+		task->dt_flags.dirty = 1;
 	}
-	task->dt_flags.dirty = 1;
-	/* Fill node values into ag_node */
-	dnode_to_agnode(node, ag_node);
-
-	/* Track last insertion */
-	node->dn_node = ag_node;
-	node->dn_task = task;
-	node->dn_flags.dirty = 0;
-
-	return 1;
-}
 
-int
-dtask_name_remove(dtask_t *task, char *name) {
-	Agnode_t *ag_node = agnode(task->dt_graph, name, FALSE);
-	if (!ag_node) {
-		return 0;
+	return task;
+bail:
+	if (task && task->dt_map) {
+		/* Mapping and arena go with the task */
+		dtask_free(task);
+		return NULL;
 	}
-	agdelete(task->dt_graph, ag_node);
-	task->dt_flags.dirty = 1;
-
-	return 1;
+	free(task);
+	darena_free(arena);
+	munmap(map, st.st_size);
+	return NULL;
 }
 
 int
-dtask_remove(dtask_t *task, dnode_t *node) {
-	if (!dtask_name_remove(task, node->dn_name)) {
-		return 0;
+dtask_update(dtask_t *task) {
+	if (task->dt_flags.dirty) {
+		dtask_find_source(task);
+	}
+	if (task->dt_nseed || task->dt_flags.lfull || task->dt_flags.ldec) {
+		dtask_relax(task);
 	}
-	
-	node->dn_task = NULL;
-	node->dn_node = NULL;
-	node->dn_flags.dirty = 0;
 
 	return 1;
 }
 
 int
-dtask_insert_edge(dtask_t *task, dnode_t *src, dnode_t *dst) {
-	char buff[DT_NAMELEN * 2 + 5];
-	if (src->dn_flags.dirty || dst->dn_flags.dirty) {
-		/* Nodes must be updated before an edge can be added */
-		return 0;
-	}
-	if (src->dn_task != task || dst->dn_task != task) {
-		/* Nodes must be in the task */
-		return 0;
-	}
-	Agedge_t *edge = agedge(task->dt_graph, src->dn_node, dst->dn_node,
-	    NULL, FALSE);
-	if (edge) {
-		/* Edge is already present */
+dtask_begin(dtask_t *task) {
+	djournal_t *dj = task->dt_journal;
+
+	if (dj && dj->dj_active) {
 		return 0;
 	}
-	sprintf(buff, "%s -> %s", src->dn_name, dst->dn_name);
-	edge = agedge(task->dt_graph, src->dn_node, dst->dn_node, buff, TRUE);
-	if (!edge) {
-		/* Could not add the edge */
-		return 0;
+	if (!dj) {
+		dj = dt_malloc(task->dt_arena, sizeof(djournal_t));
+		if (!dj) {
+			return 0;
+		}
+		memset(dj, 0, sizeof(djournal_t));
+		task->dt_journal = dj;
 	}
-	task->dt_flags.dirty = 1;	
+	/* Rollbacks go back to an up to date task, with no seeds */
+	dtask_update(task);
+
+	dj->dj_nent = 0;
+	dj->dj_nids = 0;
+	dj->dj_lost = 0;
+	dj->dj_cpathlen = task->dt_cpathlen;
+	dj->dj_workload = task->dt_workload;
+	dj->dj_collapsed = task->dt_collapsed;
+	dj->dj_nnodes = task->dt_nnodes;
+	dj->dj_source = task->dt_source ? dnode_id(task->dt_source) :
+	    DNID_NONE;
+	dj->dj_ncrit = task->dt_ncrit;
+	dj->dj_reach = task->dt_flags.reach;
+	dj->dj_paths = task->dt_flags.paths;
+	dj->dj_active = 1;
+
 	return 1;
 }
 
 int
-dtask_remove_edge(dtask_t *task, dnode_t *src, dnode_t *dst) {
-	dnode_t *a = dtask_name_search(task, src->dn_name);
- 	dnode_t *b = dtask_name_search(task, dst->dn_name);
-
-	if (!a || !b) {
-		return 0;
-	}
+dtask_commit(dtask_t *task) {
+	djournal_t *dj = task->dt_journal;
 
-	Agedge_t *edge = agedge(task->dt_graph, a->dn_node, b->dn_node, NULL,
-	    FALSE);
-	free(a);
-	free(b);
-	if (!edge) {
+	if (!dj || !dj->dj_active) {
 		return 0;
 	}
+	dj_release(task, dj);
 
-	agdelete(task->dt_graph, edge);
-	task->dt_flags.dirty = 1;	
 	return 1;
 }
 
-dedge_t *
-dtask_search_edge(dtask_t *task, char *sname, char *dname) {
-	dnode_t *a = dtask_name_search(task, sname);
-	dnode_t *b = dtask_name_search(task, dname);
-
-	if (!a || !b) {
-		return 0;
-	}
-
-	Agedge_t *edge = agedge(task->dt_graph, a->dn_node, b->dn_node, NULL, FALSE);
-	free(a);
-	free(b);
-	if (!edge) {
-		return NULL;
+/**
+ * Undoes a journaled change
+ *
+ * @return non-zero upon success, zero if memory ran out
+ */
+static int
+dj_undo(dtask_t *task, djournal_t *dj, djent_t *e) {
+	dnid_t id = e->je_id;
+	dnid_t nrows = task->dt_nids;
+
+	switch (e->je_op) {
+	case DJ_NEW:
+		/* The last id handed out, its edges are already undone */
+		dtask_hash_unlink(task, id);
+		if (task->dt_flags.objs) {
+			dtask_obj_unlink(task, id);
+		}
+		dt_free(task->dt_arena, task->dt_nname[id]);
+		task->dt_nname[id] = NULL;
+		task->dt_mark[id] = 0;
+		task->dt_out.da_cap[id] = task->dt_out.da_deg[id] = 0;
+		task->dt_in.da_cap[id] = task->dt_in.da_deg[id] = 0;
+		task->dt_nids--;
+		break;
+	case DJ_DROP:
+		task->dt_nname[id] = e->je_name;
+		e->je_name = NULL;
+		task->dt_mark[id] = e->je_mark & ~DN_SEED;
+		dtask_hash_link(task, id);
+		if (task->dt_flags.objs && !dtask_obj_link(task, id)) {
+			task->dt_flags.objs = 0;
+		}
+		for (uint32_t i = 0; i < e->je_nout; i++) {
+			if (!dadj_push(&task->dt_out, nrows, id,
+			    dj->dj_ids[e->je_ids + i])) {
+				return 0;
+			}
+		}
+		for (uint32_t i = 0; i < e->je_nin; i++) {
+			if (!dadj_push(&task->dt_in, nrows, id,
+			    dj->dj_ids[e->je_ids + e->je_nout + i])) {
+				return 0;
+			}
+		}
+		break;
+	case DJ_EDGE:
+		/* The last edge of both rows */
+		dadj_del(&task->dt_out, id, dtask_outdeg(task, id) - 1);
+		dadj_del(&task->dt_in, e->je_nbr,
+		    dtask_indeg(task, e->je_nbr) - 1);
+		break;
+	case DJ_DEL_OUT:
+		return dadj_ins(&task->dt_out, nrows, id, e->je_idx, e->je_nbr);
+	case DJ_DEL_IN:
+		return dadj_ins(&task->dt_in, nrows, id, e->je_idx, e->je_nbr);
+	case DJ_STORE:
+		if (task->dt_flags.objs && task->dt_object[id] != e->je_object) {
+			dtask_obj_unlink(task, id);
+			task->dt_object[id] = e->je_object;
+			if (!dtask_obj_link(task, id)) {
+				task->dt_flags.objs = 0;
+			}
+		}
+		task->dt_object[id] = e->je_object;
+		task->dt_threads[id] = e->je_threads;
+		task->dt_wcet_one[id] = e->je_wcet_one;
+		task->dt_wcet[id] = e->je_wcet;
+		task->dt_factor[id] = e->je_factor;
+		task->dt_mark[id] &= ~(DN_VISITED | DN_MARKED);
+		task->dt_mark[id] |= e->je_mark & (DN_VISITED | DN_MARKED);
+		break;
+	case DJ_DIST:
+		task->dt_distance[id] = e->je_wcet;
+		break;
 	}
 
-	dedge_t *e = dedge_alloc(agnameof(edge));
-	agedge_to_dedge(edge, e);
-
-	return e;
+	return 1;
 }
 
 int
-dtask_write(dtask_t *task, FILE *file) {
-	#if 0 /* Don't do this, it'll be written to the file as a node */
-	char buff[DT_NAMELEN * 2];
-	sprintf(buff, "${L = %ld, C = %ld, D = %ld, P = %ld}$",
-		dtask_cpathlen(task), dtask_workload(task), task->dt_deadline,
-		task->dt_period);
-	Agnode_t *n = agnode(task->dt_graph, "key", TRUE);
-	agset(n, "label", buff);
-	#endif
-	
-	gvLayout(gvc, task->dt_graph, "dot");
-	gvRender(gvc, task->dt_graph, "dot", file);
-	gvFreeLayout(gvc, task->dt_graph);
-
-	#if 0
-	agdelete(task->dt_graph, n);
-	#endif
-	return 1;
-}
+dtask_rollback(dtask_t *task) {
+	djournal_t *dj = task->dt_journal;
 
-dtask_t *
-dtask_read(FILE *file) {
-	if (!gvc) {
-		gvc = gvContext();
-	}
-	dtask_t *task = calloc(1, sizeof(dtask_t));
-	task->dt_graph = agread(file, NULL);
-	if (!task->dt_graph) {
-		goto bail;
+	if (!dj || !dj->dj_active) {
+		return 0;
 	}
-	
-	sprintf(task->dt_name, "%s", agnameof(task->dt_graph));
-	task->dt_period = atoi(agget(task->dt_graph, DT_PERIOD));
-	task->dt_deadline = atoi(agget(task->dt_graph, DT_DEADLINE));
-	task->dt_cpathlen = atoi(agget(task->dt_graph, DT_CPATHLEN));
-	task->dt_workload = atoi(agget(task->dt_graph, DT_WORKLOAD));
-	task->dt_collapsed = atoi(agget(task->dt_graph, DT_COLLAPSED));
-	dtask_source_workload(task);
-	
-	return task;
-bail:
-	if (task) {
-		dtask_free(task);
+	if (dj->dj_lost) {
+		dj_release(task, dj);
+		return 0;
 	}
-	return NULL;
-}
-
-dtask_t *
-dtask_read_path(char* path) {
-	dtask_t *task = NULL;
-	FILE *file = fopen(path, "r");
-	if (!file) {
-		goto bail;
+	while (dj->dj_nent) {
+		if (!dj_undo(task, dj, &dj->dj_ent[dj->dj_nent - 1])) {
+			/* Whatever is left is kept */
+			dj_release(task, dj);
+			task->dt_flags.dirty = 1;
+			task->dt_flags.lfull = 1;
+			task->dt_flags.reach = 0;
+			task->dt_flags.paths = 0;
+			return 0;
+		}
+		dj->dj_nent--;
 	}
-	task = dtask_read(file);
-	fclose(file);
-bail:
-	return task;
-}
-
-/**
- * Source must be valid before calling this function
- */
-static void
-dtask_find_cpathlen(dtask_t *task) {
-	dtask_unmark(task);
-	dnode_t **sorted = dag_maxd(task->dt_source);
-	int sink = agnnodes(task->dt_graph) - 1;
-	task->dt_cpathlen = sorted[sink]->dn_distance;
 
-	for (int i=0; sorted[i]; i++) {
-		dnode_free(sorted[i]);
+	/* Seeds of the transaction */
+	for (dnid_t i = 0; i < task->dt_nseed; i++) {
+		task->dt_mark[task->dt_seed[i]] &= ~DN_SEED;
 	}
-}
+	task->dt_nseed = 0;
 
-int
-dtask_update(dtask_t *task) {
-	char buff[DT_NAMELEN];	
-	if (task->dt_flags.dirty) {
-		dtask_source_workload(task);
+	task->dt_cpathlen = dj->dj_cpathlen;
+	task->dt_workload = dj->dj_workload;
+	task->dt_collapsed = dj->dj_collapsed;
+	task->dt_nnodes = dj->dj_nnodes;
+	task->dt_ncrit = dj->dj_ncrit;
+	task->dt_flags.lfull = 0;
+	task->dt_flags.ldec = 0;
+	task->dt_flags.reach = dj->dj_reach;
+	task->dt_flags.paths = dj->dj_paths;
+	dnode_free(task->dt_source);
+	task->dt_source = NULL;
+	if (dj->dj_source != DNID_NONE) {
+		task->dt_source = dtask_node_at(task, dj->dj_source);
 	}
-	dtask_find_cpathlen(task);
+	task->dt_flags.dirty = 0;
+	dj_release(task, dj);
 
-	/* Update the graph */
-	sprintf(buff, "%ld", task->dt_period);
-	agset(task->dt_graph, DT_PERIOD, buff);
-	sprintf(buff, "%ld", task->dt_deadline);
-	agset(task->dt_graph, DT_DEADLINE, buff);
-	sprintf(buff, "%ld", task->dt_workload);
-	agset(task->dt_graph, DT_WORKLOAD, buff);
-	sprintf(buff, "%ld", task->dt_cpathlen);
-	agset(task->dt_graph, DT_CPATHLEN, buff);
-	sprintf(buff, "%ld", task->dt_collapsed);
-	agset(task->dt_graph, DT_COLLAPSED, buff);
-	
 	return 1;
 }
 
@@ -457,48 +2820,40 @@ dtask_infeasible(dtask_t* task) {
 
 void
 dtask_unmark(dtask_t *task) {
-	char buff[DT_NAMELEN];
-	Agnode_t *n;
-	for (n = agfstnode(task->dt_graph); n; n = agnxtnode(task->dt_graph, n)) {
-		agset(n, DT_VISITED, "0");
-		agset(n, DT_MARKED, "0");		
+	for (dnid_t id = 0; id < task->dt_nids; id++) {
+		task->dt_mark[id] &= ~(DN_VISITED | DN_MARKED);
 	}
 	if (task->dt_source) {
-		sprintf(buff, "%s", agnameof(task->dt_source->dn_node));
-		dnode_free(task->dt_source);
-		task->dt_source = dtask_name_search(task, buff);
+		task->dt_source->dn_flags.visited = 0;
+		task->dt_source->dn_flags.marked = 0;
 	}
 }
 
 dnode_t *
 dtask_next_node(dtask_t *task, dnode_t *node) {
-	Agnode_t *agnext;
-	dnode_t *next;
+	dnid_t id = 0;
 	if (!task) {
 		return NULL;
 	}
 	if (node) {
-		agnext = agnxtnode(task->dt_graph, node->dn_node);
-	} else {
-		agnext = agfstnode(task->dt_graph);
+		id = node->dn_id + 1;
 	}
-	if (!agnext) {
-		return NULL;
+	while (id < task->dt_nids && !task->dt_nname[id]) {
+		id++;
 	}
-	next = dnode_alloc(agnameof(agnext));
-	agnode_to_dnode(agnext, next);
-	next->dn_task = task;
-	return next;
+	return dtask_node_at(task, id);
 }
 
 int
 dtask_max_object(dtask_t *task) {
 	int max = -1;
 
-	Agnode_t *n;
-	for (n = agfstnode(task->dt_graph); n;
-	     n = agnxtnode(task->dt_graph, n)) {
-		int v = atoi(agget(n, DT_OBJECT));
+	if (dtask_obj_build(task)) {
+		return task->dt_maxobj;
+	}
+	dnid_t id;
+	dtask_foreach_id(task, id) {
+		int v = task->dt_object[id];
 		if (v > max) {
 			max = v;
 		}
@@ -507,6 +2862,30 @@ dtask_max_object(dtask_t *task) {
 	return max;
 }
 
+dnid_t
+dtask_obj_first(dtask_t *task, tint_t object) {
+	if (!dtask_obj_build(task) || object >= task->dt_nobj) {
+		return DNID_NONE;
+	}
+	return task->dt_ohead[object];
+}
+
+dnid_t
+dtask_obj_next(dtask_t *task, dnid_t id) {
+	if (!dtask_node_live(task, id) || !dtask_obj_build(task)) {
+		return DNID_NONE;
+	}
+	return task->dt_onext[id];
+}
+
+dnid_t
+dtask_obj_count(dtask_t *task, tint_t object) {
+	if (!dtask_obj_build(task) || object >= task->dt_nobj) {
+		return 0;
+	}
+	return task->dt_ocount[object];
+}
+
 int
 dtask_implicit(dtask_t *task) {
 	return (task->dt_deadline == task->dt_period);
@@ -536,7 +2915,7 @@ dnode_t *
 dnode_copy(dnode_t *orig) {
 	dnode_t *copy = dnode_alloc(orig->dn_name);
 
-	copy->dn_node = orig->dn_node;
+	copy->dn_id = orig->dn_id;
 	copy->dn_task = orig->dn_task;
 	dnode_set_object(copy, dnode_get_object(orig));
 	dnode_set_threads(copy, dnode_get_threads(orig));
@@ -609,18 +2988,19 @@ dnode_to_agnode(dnode_t *src, Agnode_t *dst) {
 /**
  * Fills in the dnode with values from the Agnode
  */
-void
+static void
 agnode_to_dnode(Agnode_t *src, dnode_t *dst) {
-	dst->dn_object = atoi(agget(src, DT_OBJECT));
-	dst->dn_threads = atoi(agget(src, DT_THREADS));
-	dst->dn_wcet_one = atoi(agget(src, DT_WCET_ONE));
-	dst->dn_wcet = atoi(agget(src, DT_WCET));
-	dst->dn_factor = atof(agget(src, DT_FACTOR));
-	dnode_make_label(dst);
+	char *factor = agget(src, DT_FACTOR);
+
+	dst->dn_object = agget_tint(src, DT_OBJECT);
+	dst->dn_threads = agget_tint(src, DT_THREADS);
+	dst->dn_wcet_one = agget_tint(src, DT_WCET_ONE);
+	dst->dn_wcet = agget_tint(src, DT_WCET);
+	dst->dn_factor = factor ? atof(factor) : 0;
+	dst->dn_distance = agget_tint(src, DT_DISTANCE);
 	dst->dn_flags.dirty = 0;
-	dst->dn_flags.marked = atoi(agget(src, DT_MARKED));	
-	dst->dn_flags.visited = atoi(agget(src, DT_VISITED));
-	dst->dn_node = src;
+	dst->dn_flags.marked = agget_tint(src, DT_MARKED);
+	dst->dn_flags.visited = agget_tint(src, DT_VISITED);
 }
 
 /**
@@ -628,22 +3008,8 @@ agnode_to_dnode(Agnode_t *src, dnode_t *dst) {
  */
 static void
 dnode_calc_wcet(dnode_t *node) {
-	tint_t threads = node->dn_threads;
-	if (threads == 0) {
-		node->dn_wcet = 0;
-		return;
-	}
-	if (node->dn_wcet_one == 0) {
-		node->dn_wcet = 0;
-		return;
-	}
-		
-	tint_t wcet1 = node->dn_wcet_one;
-	float_t factor = node->dn_factor;
-
-	tint_t wcet = wcet1 + ceil((threads - 1) * wcet1 * factor);
-
-	node->dn_wcet = wcet;
+	node->dn_wcet = dnode_wcet_of(node->dn_wcet_one, node->dn_threads,
+				      node->dn_factor);
 }
 
 /**
@@ -713,19 +3079,36 @@ dnode_update(dnode_t *node) {
 		/* Cannot update a node that's not in a task */
 		return 0;
 	}
-	Agraph_t *ag_graph = node->dn_task->dt_graph;
-	Agnode_t *ag_node = agnode(ag_graph, node->dn_name, FALSE);
-	if (!ag_node) {
+	dnid_t id = dnode_id(node);
+	if (id == DNID_NONE) {
 		/* Does not exist */
 		return 0;
 	}
+	node->dn_id = id;
 	if (!node->dn_flags.dirty) {
 		/* Nothing dirty, nothing to do */
 		return 1;
 	}
+	dtask_t *task = node->dn_task;
+	tint_t wcet = task->dt_wcet[id];
+	djournal_t *dj = dtask_jnl(task);
+	djent_t *e = dj ? dj_push(task, dj, DJ_STORE, id) : NULL;
+	if (e) {
+		e->je_mark = task->dt_mark[id];
+		e->je_object = task->dt_object[id];
+		e->je_threads = task->dt_threads[id];
+		e->je_wcet_one = task->dt_wcet_one[id];
+		e->je_wcet = wcet;
+		e->je_factor = task->dt_factor[id];
+	}
 	dnode_calc_wcet(node);
-	dnode_to_agnode(node, ag_node);
+	dtask_store_node(task, id, node);
 	node->dn_flags.dirty = 0;
+	if (node->dn_wcet != wcet) {
+		task->dt_workload += node->dn_wcet - wcet;
+		task->dt_flags.ldec |= node->dn_wcet < wcet;
+		dtask_seed(task, id);
+	}
 
 	return 1;
 }
@@ -735,22 +3118,14 @@ dnode_indegree(dnode_t *node) {
 	if (!node) {
 		return -1;
 	}
-	if (!node->dn_task) {
-		return -1;
-	}
-	Agraph_t *g = node->dn_task->dt_graph;
-	if (!g) {
-		return -1;
-	}
-	Agnode_t *n = node->dn_node;
-	if (!n) {
-		return -1;
-	}
 	if (node->dn_flags.dirty) {
 		dnode_update(node);
-		n = node->dn_node;		
 	}
-	return agdegree(g, n, TRUE, FALSE);
+	dnid_t id = dnode_id(node);
+	if (id == DNID_NONE) {
+		return -1;
+	}
+	return dtask_indeg(node->dn_task, id);
 }
 
 int
@@ -758,22 +3133,14 @@ dnode_outdegree(dnode_t *node) {
 	if (!node) {
 		return -1;
 	}
-	if (!node->dn_task) {
-		return -1;
-	}
-	Agraph_t *g = node->dn_task->dt_graph;
-	if (!g) {
-		return -1;
-	}
-	Agnode_t *n = node->dn_node;
-	if (!n) {
-		return -1;
-	}
 	if (node->dn_flags.dirty) {
 		dnode_update(node);
-		n = node->dn_node;		
 	}
-	return agdegree(g, n, FALSE, TRUE);
+	dnid_t id = dnode_id(node);
+	if (id == DNID_NONE) {
+		return -1;
+	}
+	return dtask_outdeg(node->dn_task, id);
 }
 
 int
@@ -794,15 +3161,20 @@ dedge_alloc(char* name) {
 	return edge;
 }
 
+/**
+ * Fills in the dedge with the idx'th out edge of src
+ */
 static void
-agedge_to_dedge(Agedge_t *src, dedge_t *dst) {
-	snprintf(dst->de_name, DT_NAMELEN, "%s", agnameof(src));
-	Agnode_t *a = agtail(src); /* These are backwards ... */
-	Agnode_t *b = aghead(src); /* ... I don't know why */
-	dedge_set_src(dst, agnameof(a));
-	dedge_set_dst(dst, agnameof(b));
-	dst->de_edge = src;
-	dst->de_graph = agraphof(src); 
+dedge_fill(dedge_t *edge, dtask_t *task, dnid_t src, uint32_t idx) {
+	dnid_t dst = dtask_succs(task, src)[idx];
+	dedge_set_src(edge, task->dt_nname[src]);
+	dedge_set_dst(edge, task->dt_nname[dst]);
+	dedge_make_label(edge);
+	snprintf(edge->de_name, DT_NAMELEN, "%s", edge->de_label);
+	edge->de_task = task;
+	edge->de_src = src;
+	edge->de_dst = dst;
+	edge->de_idx = idx;
 }
 
 void
@@ -827,15 +3199,15 @@ dedge_make_label(dedge_t *edge) {
 
 dedge_t*
 dedge_out_first(dnode_t *node) {
-	if (!node->dn_node) {
+	dnid_t id = dnode_id(node);
+	if (id == DNID_NONE) {
 		return NULL;
 	}
-	Agedge_t *edge = agfstout(node->dn_task->dt_graph, node->dn_node);
-	if (!edge) {
+	if (dtask_outdeg(node->dn_task, id) == 0) {
 		return NULL;
 	}
-	dedge_t *e = dedge_alloc(agnameof(edge));
-	agedge_to_dedge(edge, e);
+	dedge_t *e = dedge_alloc("");
+	dedge_fill(e, node->dn_task, id, 0);
 
 	return e;
 }
@@ -845,17 +3217,20 @@ dedge_out_first_name(dtask_t *task, char *name) {
 	if (!node) {
 		return NULL;
 	}
-	return dedge_out_first(node);
+	dedge_t *e = dedge_out_first(node);
+	dnode_free(node);
 
+	return e;
 }
 dedge_t*
 dedge_out_next(dedge_t *edge) {
-	Agedge_t *next = agnxtout(edge->de_graph, edge->de_edge);
-	if (!next) {
+	dtask_t *task = edge->de_task;
+	uint32_t idx = edge->de_idx + 1;
+	if (idx >= dtask_outdeg(task, edge->de_src)) {
 		return NULL;
 	}
-	dedge_t *e = dedge_alloc("tmp");
-	agedge_to_dedge(next, e);
+	dedge_t *e = dedge_alloc("");
+	dedge_fill(e, task, edge->de_src, idx);
 
 	return e;
 }
@@ -1,7 +1,8 @@
 #ifndef DAG_TASK_H
 #define DAG_TASK_H
 
-#include <gvc.h>
+#include <stdint.h>
+#include <signal.h>
 #include "task.h"
 
 #define DT_NAMELEN	(TASK_NAMELEN * 4)
@@ -22,10 +23,57 @@
 #define DT_CPATHLEN	"cpathlen"	/** critical path length */
 #define DT_WORKLOAD	"workload"	/** workload */
 
+/**
+ * Node identifier, the index of a node in the arrays of its task
+ */
+typedef uint32_t dnid_t;
+#define DNID_NONE	UINT32_MAX
+
+/** First bytes of a binary task file, see dtask_write_bin() */
+#define DT_BIN_MAGIC	"\x89" "DTB\r\n\x1a\n"
+
+/** Largest task (in node ids) with a reachability index */
+#define DT_REACH_MAX	8192
+
+/** Node mark bits (dt_mark) */
+#define DN_VISITED	0x01
+#define DN_MARKED	0x02
+#define DN_SEED		0x04	/** Distance must be recalculated */
+#define DN_CONE		0x08	/** Scratch, reached from a seed */
+
 typedef struct dnode_s dnode_t;
 
+/**
+ * Bump allocator backing short lived task copies, see
+ * dtask_copy_arena()
+ */
+typedef struct darena_s darena_t;
+
+/**
+ * Undo journal of the changes to a task, see dtask_begin()
+ */
+typedef struct djournal_s djournal_t;
+
+/**
+ * Adjacency of the nodes of a task in compressed sparse row form
+ *
+ * The row of node i is da_adj[da_off[i]] .. da_adj[da_off[i] +
+ * da_deg[i] - 1] and is kept in edge insertion order. Rows have
+ * da_cap[i] slots, a row that outgrows them is moved to the end of
+ * da_adj.
+ */
+typedef struct {
+	uint32_t *da_off;	/** Start of each row in da_adj */
+	uint32_t *da_deg;	/** Length of each row */
+	uint32_t *da_cap;	/** Capacity of each row */
+	dnid_t	*da_adj;	/** Rows of neighbor node ids */
+	uint32_t da_len;	/** Used slots of da_adj */
+	uint32_t da_size;	/** Allocated slots of da_adj */
+	uint32_t da_edges;	/** Sum of the row lengths */
+	darena_t *da_arena;	/** Arena of the rows, NULL for the heap */
+} dadj_t;
+
 typedef struct {
-	Agraph_t *dt_graph;
 	char	dt_name[DT_NAMELEN];
 	tint_t	dt_period;	/** Period of the task, user settable */
 	tint_t	dt_deadline;	/** Relative deadline of the task, settable */
@@ -34,8 +82,86 @@ typedef struct {
 	tint_t	dt_collapsed;	/** Count of collapsed nodes, NOT settable */
 	dnode_t *dt_source;	/** Source node, NOT settable */
 	struct {
-		unsigned int dirty:1;
+		unsigned int dirty:1;	/** Source must be found again */
+		unsigned int lfull:1;	/** All distances are stale */
+		unsigned int ldec:1;	/** A distance may have decreased */
+		unsigned int indfs:1;	/** dt_dfs is in use by a walk */
+		unsigned int reach:1;	/** dt_desc and dt_far are valid */
+		unsigned int paths:1;	/** dt_tail, dt_cf, dt_cb are valid */
+		unsigned int objs:1;	/** The object index is valid */
 	} dt_flags;
+	darena_t *dt_arena;	/** Arena of the task, NULL for the heap */
+	void	*dt_map;	/** Mapped binary file, see dtask_map() */
+	size_t	dt_mapsize;
+	djournal_t *dt_journal;	/** Undo journal, see dtask_begin() */
+	/*
+	 * Nodes, indexed by dnid_t. Ids are handed out in insertion
+	 * order and are not reused, a removed node leaves a NULL name.
+	 */
+	dnid_t	dt_nnodes;	/** Number of nodes in the task */
+	dnid_t	dt_nids;	/** Number of ids handed out */
+	dnid_t	dt_ncap;	/** Allocated length of the node arrays */
+	char	**dt_nname;	/** Node names, NULL if removed */
+	tint_t	*dt_object;
+	tint_t	*dt_threads;
+	tint_t	*dt_wcet_one;
+	tint_t	*dt_wcet;
+	float_t	*dt_factor;
+	tint_t	*dt_distance;
+	uint8_t	*dt_mark;	/** DN_* bits */
+	dadj_t	dt_out;		/** Successors of each node */
+	dadj_t	dt_in;		/** Predecessors of each node */
+	/* Name to id hash table, chained through dt_hnext */
+	dnid_t	*dt_hbucket;
+	dnid_t	*dt_hnext;
+	uint32_t dt_hsize;
+	/*
+	 * Nodes whose distance (and those of their descendants) must
+	 * be recalculated before dt_cpathlen can be read, see
+	 * dtask_update()
+	 */
+	dnid_t	*dt_seed;
+	dnid_t	dt_nseed;
+	/* Scratch space for recalculating distances */
+	dnid_t	*dt_cone;
+	dnid_t	*dt_queue;
+	uint32_t *dt_cnt;
+	/* Stack of the DFS, node and index of its next successor */
+	dnid_t	*dt_dfs;
+	uint32_t *dt_dfs_next;
+	/*
+	 * Reachability index, a row of dt_rwords bits per node id:
+	 * descendants of each node, and nodes reached through paths of
+	 * more than one edge
+	 */
+	uint64_t *dt_desc;
+	uint64_t *dt_far;
+	uint32_t dt_rwords;
+	size_t	dt_rsize;
+	/*
+	 * Critical paths: topological order, longest path from each
+	 * node to a sink (tail), and the number of longest paths from a
+	 * source to each node (cf) and from each node to a sink (cb),
+	 * saturating at UINT64_MAX. dt_ncrit is the number of critical
+	 * paths of the task.
+	 */
+	dnid_t	*dt_order;
+	tint_t	*dt_tail;
+	uint64_t *dt_cf;
+	uint64_t *dt_cb;
+	uint64_t dt_ncrit;
+	tint_t	*dt_sdist;	/* Scratch distances */
+	/*
+	 * Object index, the live nodes of each object in id order,
+	 * linked through dt_onext and dt_oprev. Built on demand.
+	 */
+	dnid_t	*dt_ohead;
+	dnid_t	*dt_otail;
+	dnid_t	*dt_ocount;
+	tint_t	dt_nobj;	/** Length of dt_ohead, dt_otail, dt_ocount */
+	int	dt_maxobj;	/** Largest object of a node, -1 if none */
+	dnid_t	*dt_onext;
+	dnid_t	*dt_oprev;
 } dtask_t;
 
 struct dnode_s {
@@ -52,8 +178,8 @@ struct dnode_s {
 	float_t	dn_factor;
 	/** The last task this node was inserted into */
 	dtask_t		*dn_task;
-	/** This node in dn_graph */
-	Agnode_t	*dn_node;
+	/** The id of this node in dn_task */
+	dnid_t		dn_id;
 	/** Flags, these are ugly here but save more complex
 	    structures in the walks */
 	struct {
@@ -71,10 +197,36 @@ typedef struct {
 	char de_label[DT_NAMELEN * 2];
 	char de_sname[DT_NAMELEN]; /* Source node name */
 	char de_dname[DT_NAMELEN]; /* Destination node name */
-	Agedge_t *de_edge;
-	Agraph_t *de_graph;
+	dtask_t *de_task;
+	dnid_t	de_src;		/* Source node id */
+	dnid_t	de_dst;		/* Destination node id */
+	uint32_t de_idx;	/* Position in the out row of de_src */
 } dedge_t;
 
+/**
+ * Node array accessors
+ *
+ * Usage:
+ *    dnid_t id;
+ *    dtask_foreach_id(task, id) {
+ *        for (int i = 0; i < dtask_outdeg(task, id); i++) {
+ *            dnid_t succ = dtask_succs(task, id)[i];
+ *            ...
+ *        }
+ *    }
+ */
+#define dtask_node_live(task, id) \
+	((id) < (task)->dt_nids && (task)->dt_nname[(id)] != NULL)
+#define dtask_foreach_id(task, id) \
+	for ((id) = 0; (id) < (task)->dt_nids; (id)++) \
+		if ((task)->dt_nname[(id)] != NULL)
+#define dtask_outdeg(task, id) ((task)->dt_out.da_deg[(id)])
+#define dtask_indeg(task, id) ((task)->dt_in.da_deg[(id)])
+#define dtask_succs(task, id) \
+	((task)->dt_out.da_adj + (task)->dt_out.da_off[(id)])
+#define dtask_preds(task, id) \
+	((task)->dt_in.da_adj + (task)->dt_in.da_off[(id)])
+
 /**
  * Allocates a DAG Task
  *
@@ -90,7 +242,8 @@ dtask_t *dtask_alloc(char* name);
 void dtask_free(dtask_t *task);
 
 /**
- * Copies a DAG task
+ * Copies a DAG task, keeping the node ids, the source and the count
+ * of collapsed nodes
  *
  * @param[in] task the dag task being copied
  *
@@ -98,6 +251,41 @@ void dtask_free(dtask_t *task);
  */
 dtask_t *dtask_copy(dtask_t *task);
 
+/**
+ * Copies a DAG task into an arena
+ *
+ * The copy, and whatever it allocates while it is modified, lives in
+ * the arena. dtask_free() on the copy only releases the nodes it
+ * handed out, its memory is reclaimed by darena_reset(). Meant for
+ * trial copies that are thrown away right after.
+ *
+ * @param[in] task the dag task being copied
+ * @param[in] arena the arena holding the copy
+ *
+ * @return the new dag task upon success, NULL otherwise.
+ */
+dtask_t *dtask_copy_arena(dtask_t *task, darena_t *arena);
+
+/**
+ * Allocates an arena
+ *
+ * @param[in] size initial size in bytes, grown on demand
+ *
+ * @return the arena upon success, NULL otherwise
+ */
+darena_t *darena_alloc(size_t size);
+
+/**
+ * Releases everything handed out by the arena, the tasks copied into
+ * it must have been dtask_free()'d
+ */
+void darena_reset(darena_t *arena);
+
+/**
+ * Releases an arena
+ */
+void darena_free(darena_t *arena);
+
 
 /**
  * Inserts a node into the DAG
@@ -156,6 +344,126 @@ dnode_t *dtask_name_search(dtask_t *task, char *name);
  */
 dnode_t *dtask_name_match(dtask_t *task, char *name);
 
+/**
+ * Finds the id of a node in the DAG by name
+ *
+ * @param[in] task the dag task
+ * @param[in] name of the node
+ *
+ * @return the id of the node, DNID_NONE if not found
+ */
+dnid_t dtask_name_id(dtask_t *task, char *name);
+
+/**
+ * Gets a node of the DAG by id
+ *
+ * @param[in] task the dag task
+ * @param[in] id of the node
+ *
+ * @return the dnode_t (that must be dnode_free()'d), NULL if there
+ * is no node with the id
+ */
+dnode_t *dtask_node_at(dtask_t *task, dnid_t id);
+
+/**
+ * Fills in a caller provided node with the node of the DAG by id,
+ * the node is not allocated
+ *
+ * @param[in] task the dag task
+ * @param[in] id of the node
+ * @param[out] node the node to fill in
+ *
+ * @return node, NULL if there is no node with the id
+ */
+dnode_t *dtask_node_load(dtask_t *task, dnid_t id, dnode_t *node);
+
+/**
+ * Sorts the nodes of the DAG in topological order (Kahn)
+ *
+ * No memory is allocated, the sort uses scratch space of the task.
+ *
+ * @param[in] task the dag task
+ * @param[out] order the node ids in topological order, must hold at
+ *     least dtask_nnodes() ids
+ *
+ * @return the number of ids in order, less than dtask_nnodes() if the
+ * DAG has a cycle
+ */
+dnid_t dtask_topo_order(dtask_t *task, dnid_t *order);
+
+/**
+ * Longest path kernel, sets the distance (maximum completion time) of
+ * each of the n nodes of order from the distances of its predecessors
+ *
+ * The distances of predecessors that are not in order are taken from
+ * dist as they are.
+ *
+ * @param[in] task the dag task
+ * @param[in] order node ids in topological order
+ * @param[in] n the number of ids in order
+ * @param[in|out] dist distances indexed by node id
+ *
+ * @return the maximum distance of the nodes in order
+ */
+tint_t dtask_longest_path(dtask_t *task, const dnid_t *order, dnid_t n,
+			  tint_t *dist);
+
+/**
+ * Tells whether there is a path of more than one edge from a to b
+ *
+ * The answer comes from a reachability index of the task, built on
+ * the first call after the nodes or edges of the task have changed.
+ *
+ * @param[in] task the dag task
+ * @param[in] a the id of the first node of the path
+ * @param[in] b the id of the last node of the path
+ *
+ * @return 1 if there is such a path, 0 if there is not, -1 if the task
+ * cannot be indexed (it is larger than DT_REACH_MAX or has a cycle)
+ */
+int dtask_reach_far(dtask_t *task, dnid_t a, dnid_t b);
+
+/**
+ * Critical path length of the task if the nodes a and b were
+ * collapsed into one node of WCET wcet, the task is not changed
+ *
+ * There must not be a path of more than one edge between a and b (see
+ * dag_can_collapse()). The first call after the task has changed
+ * finds the longest paths to and from every node in O(V + E), then
+ * each call is O(deg(a) + deg(b)) unless every critical path goes
+ * through a or b and the collapse shortens it, which takes O(V + E).
+ *
+ * @param[in] task the dag task
+ * @param[in] a the id of a node
+ * @param[in] b the id of the node collapsed with a
+ * @param[in] wcet the WCET of the collapsed node
+ * @param[out] cpathlen the critical path length after the collapse
+ *
+ * @return non-zero upon success, zero otherwise (the task has a cycle)
+ */
+int dtask_merged_cpathlen(dtask_t *task, dnid_t a, dnid_t b, tint_t wcet,
+			  tint_t *cpathlen);
+
+/**
+ * Brings the critical paths of the task up to date: the longest paths
+ * to (dt_distance) and from (dt_tail) every node, and the counts of
+ * critical paths through them
+ *
+ * @param[in] task the dag task
+ *
+ * @return non-zero upon success, zero otherwise (the task has a cycle)
+ */
+int dtask_paths(dtask_t *task);
+
+/**
+ * Number of nodes in the DAG
+ *
+ * @param[in] task the dag task
+ *
+ * @return the number of nodes
+ */
+dnid_t dtask_nnodes(dtask_t *task);
+
 /**
  * Adds an edge into the DAG task
  *
@@ -178,6 +486,46 @@ int dtask_insert_edge(dtask_t *task, dnode_t *src, dnode_t *dst);
  */
 int dtask_remove_edge(dtask_t *task, dnode_t *src, dnode_t *dst);
 
+/**
+ * Starts journaling the changes to the task
+ *
+ * The nodes and edges inserted and removed, the nodes updated and the
+ * distances recalculated from here on are journaled until
+ * dtask_commit() keeps them or dtask_rollback() undoes them, each in
+ * O(changes). Transactions do not nest.
+ *
+ * Usage:
+ *    dtask_begin(task);
+ *    dag_collapse(a, b);
+ *    if (dtask_coresf(task) < m) {
+ *        dtask_commit(task);
+ *    } else {
+ *        dtask_rollback(task);
+ *    }
+ *
+ * @param[in|out] task the dag task
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+int dtask_begin(dtask_t *task);
+
+/**
+ * Keeps the changes made since dtask_begin()
+ *
+ * @return non-zero upon success, zero if there is no transaction
+ */
+int dtask_commit(dtask_t *task);
+
+/**
+ * Undoes the changes made since dtask_begin(), the task is as it was
+ * then, with the same node ids and edge order
+ *
+ * @return non-zero upon success, zero if there is no transaction or
+ * memory ran out journaling or undoing the changes, what could not be
+ * undone is then kept
+ */
+int dtask_rollback(dtask_t *task);
+
 /**
  * Finds an edge by names
  *
@@ -193,6 +541,9 @@ dedge_t* dtask_search_edge(dtask_t* task, char *sname, char *dname);
 /**
  * Writes the task to dot file
  *
+ * The file carries the attributes of the task and of its nodes but no
+ * layout, see dtask_write_layout().
+ *
  * @param[in] task the dag task
  * @param[in] file the open file for writing
  *
@@ -201,7 +552,50 @@ dedge_t* dtask_search_edge(dtask_t* task, char *sname, char *dname);
 int dtask_write(dtask_t *task, FILE *file);
 
 /**
- * Reads a task from a  dot file
+ * Writes the task to dot file, laid out by graphviz for drawing
+ *
+ * @param[in] task the dag task
+ * @param[in] file the open file for writing
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+int dtask_write_layout(dtask_t *task, FILE *file);
+
+/**
+ * Writes the task to a binary file
+ *
+ * The file holds the node arrays and the adjacency of the task as
+ * they are in memory, so that dtask_map() can use it without parsing.
+ * It is only readable on machines with the same byte order.
+ *
+ * @param[in] task the dag task
+ * @param[in] file the open file for writing
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+int dtask_write_bin(dtask_t *task, FILE *file);
+
+/**
+ * Maps a task written by dtask_write_bin()
+ *
+ * The task uses the mapping in place and may be modified like any
+ * other, changes are not written back. Memory the task releases is
+ * only reclaimed by dtask_free(). The descriptor may be closed once
+ * the task is mapped.
+ *
+ * @param[in] fd the descriptor of a regular file open for reading
+ *
+ * @return the task upon success, NULL otherwise.
+ */
+dtask_t *dtask_map(int fd);
+
+/**
+ * Reads a task from a  dot file, or from a binary file written by
+ * dtask_write_bin()
+ *
+ * A binary file is mapped in place when file is a regular file read
+ * from its start, otherwise (a pipe, stdin) the rest of the stream is
+ * copied to a temporary file which is mapped.
  *
  * @param[in] file being read
  *
@@ -210,7 +604,7 @@ int dtask_write(dtask_t *task, FILE *file);
 dtask_t* dtask_read(FILE *file);
 
 /**
- * Reads a task from a dot file by path
+ * Reads a task from a dot or binary file by path
  *
  * @param[in] path to file being read
  *
@@ -299,7 +693,12 @@ void dtask_unmark(dtask_t *task);
 dnode_t *dtask_next_node(dtask_t* task, dnode_t *node);
 
 /**
- * Updates the cgraph supporting the task
+ * Updates the source and critical path length of the task
+ *
+ * The workload is kept current by every change to the task. The
+ * source is found again only after the edges have changed, and the
+ * distances are recalculated only for the nodes downstream of a
+ * changed node or edge; when nothing has changed this is O(1).
  *
  * @param[in] the task
  *
@@ -317,6 +716,31 @@ int dtask_update(dtask_t *task);
  */
 int dtask_max_object(dtask_t *task);
 
+/**
+ * Walks the nodes of an object in id order
+ *
+ * @param[in] task the dag task
+ * @param[in] object the object
+ *
+ * @return the id of the first node of the object, DNID_NONE if there
+ * is none
+ */
+dnid_t dtask_obj_first(dtask_t *task, tint_t object);
+
+/**
+ * @param[in] task the dag task
+ * @param[in] id a node of the task
+ *
+ * @return the id of the node after id with the same object, DNID_NONE
+ * if there is none
+ */
+dnid_t dtask_obj_next(dtask_t *task, dnid_t id);
+
+/**
+ * @return the number of nodes of the object
+ */
+dnid_t dtask_obj_count(dtask_t *task, tint_t object);
+
 
 /**
  * Determines if the task has a deadline = period, ie it's an implicit deadline task
@@ -352,6 +776,20 @@ void dnode_free(dnode_t *node);
  */
 dnode_t *dnode_copy(dnode_t *node);
 
+/**
+ * WCET of a node of threads threads, each of WCET wcet_one, growing
+ * by factor per added thread
+ *
+ * wcet = wcet_one + ceil((threads - 1) * wcet_one * factor)
+ */
+static inline tint_t dnode_wcet_of(tint_t wcet_one, tint_t threads,
+				   float_t factor) {
+	if (threads == 0 || wcet_one == 0) {
+		return 0;
+	}
+	return wcet_one + ceil((threads - 1) * wcet_one * factor);
+}
+
 /**
  * Node getters and setters
  */
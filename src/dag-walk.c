@@ -7,36 +7,44 @@ typedef struct {
 } topo_data_t;
 
 static ddo_t
-topological_pre(dnode_t* node, void *userd) {
-	if (node->dn_flags.visited) {
+topological_pre(dtask_t *task, dnid_t id, void *userd) {
+	if (task->dt_mark[id] & DN_VISITED) {
 		return DFS_SKIP;
 	}
-	node->dn_flags.dirty = 1;
-	node->dn_flags.visited = 1;
-	dnode_update(node);
+	task->dt_mark[id] |= DN_VISITED;
 
 	return DFS_GOOD;	
 }
 
 static ddo_t
-topological_post(dnode_t* node, void *userd) {
+topological_post(dtask_t *task, dnid_t id, void *userd) {
 	topo_data_t *data = userd;
-	dnode_t *copy = dtask_name_search(node->dn_task, node->dn_name);
 
-	data->id_list[data->id_cur] = copy;
+	data->id_list[data->id_cur] = dtask_node_at(task, id);
 	data->id_cur--;
 	return DFS_GOOD;	
 }
 
 dnode_t **
 dag_topological(dnode_t* node) {
+	dtask_t *task = node->dn_task;
 	topo_data_t userd;
-	userd.id_count = agnnodes(node->dn_task->dt_graph);
+	userd.id_count = dtask_nnodes(task);
 	userd.id_list = calloc(userd.id_count + 1, sizeof(dnode_t*));
 	userd.id_cur = userd.id_count - 1;
 
-	int rv = ddfs(node, topological_pre, NULL, topological_post, &userd);
-	dtask_unmark(node->dn_task);
+	ddfs_id(task, dtask_name_id(task, node->dn_name), topological_pre,
+		NULL, topological_post, &userd);
+	dtask_unmark(task);
+
+	/* Not all nodes may be reachable, move the sorted ones first */
+	int first = userd.id_cur + 1;
+	if (first > 0) {
+		memmove(userd.id_list, userd.id_list + first,
+			(userd.id_count - first) * sizeof(dnode_t*));
+		memset(userd.id_list + userd.id_count - first, 0,
+		       first * sizeof(dnode_t*));
+	}
 
 	return userd.id_list;
 }
@@ -44,51 +52,32 @@ dag_topological(dnode_t* node) {
 dnode_t **
 dag_maxd(dnode_t *node) {
 	dtask_t *task = node->dn_task;
-	char buff[DT_NAMELEN];
 	dnode_t **topo = dag_topological(node);
-	Agraph_t *g = task->dt_graph;
 
 	for (int i=0; topo[i]; i++) {
-		Agnode_t *n = topo[i]->dn_node;
-		Agedge_t *e;
-		tint_t maxd = 0;
-		for (e = agfstin(g,n); e; e = agnxtin(g,e)) {
-			Agnode_t *a = agtail(e); /* These are backwards ... */
-			Agnode_t *b = aghead(e); /* ... I don't know why */
-			tint_t prec_d = atoi(agget(a, DT_DISTANCE));
-			if (prec_d > maxd) {
-				maxd = prec_d;
-			}
-		}
-		/* The distance of each node is the maximum completion time */
-		topo[i]->dn_distance = dnode_get_wcet(topo[i]) + maxd;
-
-		/* Update the task */
-		dnode_t *this = dtask_name_search(task, topo[i]->dn_name);
-		this->dn_distance = topo[i]->dn_distance;
-		this->dn_flags.dirty = 1;
-		dnode_update(this);
-		dnode_free(this);
+		dnid_t id = topo[i]->dn_id;
+		dtask_longest_path(task, &id, 1, task->dt_distance);
+		topo[i]->dn_distance = task->dt_distance[id];
 	}
 	return topo;
 }
 
 typedef struct {
-	dnode_t *pud_tgt;
+	dnid_t pud_tgt;
 	int pud_found;
 	int pud_len;
 } pathud_t;
 
 static ddo_t
-path_pre(dnode_t* node, void *userd) {
+path_pre(dtask_t *task, dnid_t id, void *userd) {
 	pathud_t *ud = userd;
 
-	if (node->dn_flags.visited) {
+	if (task->dt_mark[id] & DN_VISITED) {
 		return DFS_SKIP;
 	}
 
 	ud->pud_len++;
-	if (dnode_has_name(node, ud->pud_tgt->dn_name)) {
+	if (id == ud->pud_tgt) {
 		ud->pud_found = 1;
 		/* Error out, strange but works */
 		return DFS_ERR;
@@ -98,28 +87,77 @@ path_pre(dnode_t* node, void *userd) {
 }
 
 static ddo_t
-path_visit(dnode_t* node, void* userd) {
-	node->dn_flags.dirty = 1;
-	node->dn_flags.visited = 1;
-	dnode_update(node);
+path_visit(dtask_t *task, dnid_t id, void* userd) {
+	task->dt_mark[id] |= DN_VISITED;
+
+	return DFS_GOOD;
 }
 
 static ddo_t
-path_post(dnode_t* node, void* userd) {
+path_post(dtask_t *task, dnid_t id, void* userd) {
 	pathud_t *ud = userd;
 	ud->pud_len--;
+
+	return DFS_GOOD;
 }
 
 
 int
 dag_pathlen(dnode_t *a, dnode_t *b) {
+	dtask_t *task = a->dn_task;
 	pathud_t ud;
-	ud.pud_tgt = b;
+	ud.pud_tgt = dtask_name_id(task, b->dn_name);
 	ud.pud_len = 0;
 	ud.pud_found = 0;
 	
-	int rv = ddfs(a, path_pre, path_visit, path_post, &ud);
-	dtask_unmark(a->dn_task);
+	ddfs_id(task, dtask_name_id(task, a->dn_name), path_pre, path_visit,
+		path_post, &ud);
+	dtask_unmark(task);
 	
 	return ud.pud_len;
 }
+
+static ddo_t
+far_pre(dtask_t *task, dnid_t id, void *userd) {
+	dnid_t *tgt = userd;
+
+	if (task->dt_mark[id] & DN_VISITED) {
+		return DFS_SKIP;
+	}
+	task->dt_mark[id] |= DN_VISITED;
+	if (id == *tgt) {
+		/* Found, stop the walk */
+		return DFS_ERR;
+	}
+
+	return DFS_GOOD;
+}
+
+int
+dag_far_path(dnode_t *a, dnode_t *b) {
+	dtask_t *task = a->dn_task;
+	dnid_t ia = dtask_name_id(task, a->dn_name);
+	dnid_t ib = dtask_name_id(task, b->dn_name);
+	if (ia == DNID_NONE || ib == DNID_NONE) {
+		return 0;
+	}
+
+	int rv = dtask_reach_far(task, ia, ib);
+	if (rv >= 0) {
+		return rv;
+	}
+
+	/* No index, walk from the successors of a other than b */
+	rv = 0;
+	dnid_t *succs = dtask_succs(task, ia);
+	for (uint32_t i = 0; i < dtask_outdeg(task, ia) && !rv; i++) {
+		if (succs[i] == ib) {
+			continue;
+		}
+		rv = ddfs_id(task, succs[i], far_pre, NULL, NULL, &ib) ==
+		    DFS_ERR;
+	}
+	dtask_unmark(task);
+
+	return rv;
+}
@@ -30,4 +30,18 @@ dnode_t **dag_maxd(dnode_t* node);
  */
 int dag_pathlen(dnode_t *a, dnode_t *b);
 
+/**
+ * Tells whether there is a path of more than one edge from a to b,
+ * that is whether collapsing a and b would make a cycle
+ *
+ * Uses the reachability index of the task, or a walk when the task
+ * cannot be indexed.
+ *
+ * @param[in] a a node
+ * @param[in] b another node
+ *
+ * @return non-zero if there is such a path, zero otherwise
+ */
+int dag_far_path(dnode_t *a, dnode_t *b);
+
 #endif /* DAG_WALK_H */
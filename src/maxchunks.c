@@ -1,65 +1,55 @@
 #include "maxchunks.h"
+#include "taskset-demand.h"
+
+static void
+assign_chunk(task_t *task, int64_t D, int64_t slack) {
+	if (D != task->t_deadline) {
+		return;
+	}
+	task->t_chunk = slack;
+	if (task->t_chunk > task->wcet(task->t_threads)) {
+		task->t_chunk = task->wcet(task->t_threads);
+	}
+}
 
 static void
 assign_slack(task_set_t *ts, int64_t D, int64_t slack) {
 	task_link_t *cookie;
-	char *str;
 	for (cookie = ts_first(ts) ; cookie ; cookie = ts_next(ts, cookie)) {
-		task_t *task= ts_task(cookie);
-		if (D != task->t_deadline) {
-			continue;
-		}
-		task->t_chunk = slack;
-		if (task->t_chunk > task->wcet(task->t_threads)) {
-			task->t_chunk = task->wcet(task->t_threads);
-		}
+		assign_chunk(ts_task(cookie), D, slack);
 	}
 }
 
 /**
- * An unfortunate consequence of the tsearch API. Global (file static
- * works) variables are required
+ * State of the interval checks of maxchunks_dbg(), one per call
  */
-static struct {
-	int64_t 	ad_pslack;
+typedef struct {
+	int64_t 	ad_pslack;	/**< Smallest slack so far */
 	int		ad_infeasible;
-	task_set_t*	ad_tasks;
+	tsd_t*		ad_tsd;
 	FILE*		ad_dbg;
-} ad_parms;
+} ad_ctx_t;
 
 static void
-act_deadline(const void *cookie, const VISIT which, const int depth) {
-	ot_elem_t *elem = *(ot_elem_t**) cookie;
-
-	switch (which) {
-	case leaf:
-	case postorder:
-		break;
-	default:
-		return;
-	}
-
-	if (ad_parms.ad_infeasible) {
-		return;
-	}
-	fprintf(ad_parms.ad_dbg, "%08li: demand=", elem->ote_deadline);
-	fflush(ad_parms.ad_dbg);	
+act_deadline(ad_ctx_t *ctx, ot_elem_t *elem) {
+	fprintf(ctx->ad_dbg, "%08li: demand=", elem->ote_deadline);
+	fflush(ctx->ad_dbg);	
 	int64_t D = elem->ote_deadline;
-	int64_t demand = ts_demand(ad_parms.ad_tasks, D);
+	int64_t demand = tsd_demand(ctx->ad_tsd, D);
 	int64_t slack_d = D - demand;
-	fprintf(ad_parms.ad_dbg, "%08lu newslack=%08li", demand, slack_d);
-	fflush(ad_parms.ad_dbg);
-	if (slack_d < ad_parms.ad_pslack) {
-		ad_parms.ad_pslack = slack_d;
-	}
-	if (ad_parms.ad_pslack < 0) {
-		fprintf(ad_parms.ad_dbg, " infeasible, done\n");
-		ad_parms.ad_infeasible = 1;
+	fprintf(ctx->ad_dbg, "%08lu newslack=%08li", demand, slack_d);
+	fflush(ctx->ad_dbg);
+	if (slack_d < ctx->ad_pslack) {
+		ctx->ad_pslack = slack_d;
+	}
+	if (ctx->ad_pslack < 0) {
+		fprintf(ctx->ad_dbg, " infeasible, done\n");
+		ctx->ad_infeasible = 1;
 		return;
 	}
-	fprintf(ad_parms.ad_dbg, " assigning slack up to %08li\n", D);
-	fflush(ad_parms.ad_dbg);	
-	assign_slack(elem->ote_tasks, D, ad_parms.ad_pslack);
+	fprintf(ctx->ad_dbg, " assigning slack up to %08li\n", D);
+	fflush(ctx->ad_dbg);	
+	assign_slack(elem->ote_tasks, D, ctx->ad_pslack);
 }
 
 int
@@ -80,19 +70,35 @@ maxchunks_dbg(task_set_t *ts, FILE *dbg) {
 	fprintf(dbg, "Filled %lu deadlines\n", count);
 
 	fprintf(dbg, "Beginning interval checks...\n");
-	ad_parms.ad_pslack = INT64_MAX;
-	ad_parms.ad_infeasible = 0;
-	ad_parms.ad_tasks = ts;
-	ad_parms.ad_dbg = dbg;
-	twalk(head->ot_root, act_deadline);
-	
+	ad_ctx_t ctx = {
+		.ad_pslack = INT64_MAX,
+		.ad_infeasible = 0,
+		.ad_tsd = tsd_alloc(ts),
+		.ad_dbg = dbg,
+	};
+	if (!ctx.ad_tsd) {
+		fprintf(dbg, "Unable to allocate the demand context\n");
+		ctx.ad_infeasible = -1;
+		goto bail;
+	}
+	ot_iter_t it;
+	ot_elem_t *elem;
+	ot_foreach(head, &it, elem) {
+		act_deadline(&ctx, elem);
+		if (ctx.ad_infeasible) {
+			break;
+		}
+	}
+	tsd_free(ctx.ad_tsd);
+
+bail:
 	ot_empty(head);
 	ot_free(head);
 	if (closed) {
 		fclose(dbg);
 	}
 
-	return ad_parms.ad_infeasible;
+	return ctx.ad_infeasible;
 }
 
 int
@@ -106,21 +112,23 @@ max_chunks_dbg(task_set_t *ts, FILE *handle) {
 	uint64_t star = ts_star(ts);
 	fprintf(handle, "T* = %lu\n", star);
 
-	ordl_t head;
-	ordl_init(&head);
-	fprintf(handle, "Filling deadlines up to %lu\n", star);
-	int count = ts_fill_deadlines_dbg(ts, &head, star, handle);
-	fprintf(handle, "Filled %i deadlines\n", count);
-	
+	dlm_t dlm;
+	fprintf(handle, "Merging deadlines up to %lu\n", star);
+	if (!dlm_init(&dlm, ts, 0, star)) {
+		if (closeh) {
+			fclose(handle);
+		}
+		return -1;
+	}
 
 	fprintf(handle, "Beginning interval checks...\n");
 	int feasible = 1;
 	int64_t p_slack = INT64_MAX;
-	or_elem_t *cursor;
-	ordl_foreach(&head, cursor) {
-		fprintf(handle, "%08li: demand=", cursor->oe_deadline); fflush(handle);
-		int64_t D = cursor->oe_deadline;
-		int64_t demand = ts_demand(ts, D);
+	while (dlm_next(&dlm)) {
+		fprintf(handle, "%08li: demand=", dlm.dlm_deadline); fflush(handle);
+		int64_t D = dlm.dlm_deadline;
+		/* The merge started at 0, its running demand is the demand at D */
+		int64_t demand = dlm.dlm_demand;
 		int64_t slack_d = D - demand;
 		fprintf(handle, "%08lu newslack=%08li", demand, slack_d); fflush(handle);
 		if (slack_d < p_slack) {
@@ -132,17 +140,25 @@ max_chunks_dbg(task_set_t *ts, FILE *handle) {
 			break;
 		}
 		fprintf(handle, " assigning slack up to %08li\n", D); fflush(handle);
-		assign_slack(cursor->oe_tasks, D, p_slack);
+		for (size_t i = 0; i < dlm.dlm_ntasks; i++) {
+			assign_chunk(dlm.dlm_tasks[i], D, p_slack);
+		}
+	}
+	if (dlm.dlm_cancelled) {
+		fprintf(handle, "cancelled\n");
+		feasible = -1;
 	}
-	ordl_clear(&head);
+	dlm_fini(&dlm);
 
-	if (feasible) {
+	if (feasible > 0) {
 		fprintf(handle, "feasible\n");
 	}
 	if (closeh) {
 		fclose(handle);
 	}
-	if (feasible) {
+	if (feasible < 0) {
+		return -1;
+	} else if (feasible) {
 		return 0;
 	} else {
 		return 1;
@@ -12,8 +12,8 @@
  * @param[in|out] ts the task set
  *
  * @return 0 if the task set is well formed and feasible, less than
- * zero if the task set is poorly formed, greater than zero if the
- * task set is infeasible
+ * zero if the task set is poorly formed or the test was cancelled
+ * (see dlm_watch()), greater than zero if the task set is infeasible
  */
 int max_chunks(task_set_t *ts);
 
@@ -26,6 +26,16 @@ int max_chunks(task_set_t *ts);
  * @return see max_chunks()
  */
 int max_chunks_dbg(task_set_t *ts, FILE* handle);
+
+/**
+ * max_chunks_dbg() over the ordered tree of deadlines
+ *
+ * @param[in|out] ts the task set
+ * @param[out] handle file handle to write status
+ *
+ * @return 0 if the task set is feasible, 1 if it is not, less than
+ * zero if memory ran out
+ */
 int maxchunks_dbg(task_set_t *ts, FILE* handle);
 
 /**
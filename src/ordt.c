@@ -1,64 +1,282 @@
 #include "ordt.h"
 
-static int
-compare(const void *xa, const void *xb) {
-	const ot_elem_t *a = xa;
-	const ot_elem_t *b = xb;
+/**
+ * Finds the chunk a deadline belongs in, the last chunk whose first
+ * deadline is <= deadline (or the first chunk)
+ */
+static size_t
+ot_chunk_of(const ot_t *tree, tint_t deadline) {
+	size_t lo = 0, hi = tree->ot_nchunks;
 
-	if (a->ote_deadline < b->ote_deadline) {
-		return -1;
+	/* First chunk with ot_first > deadline */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (tree->ot_first[mid] <= deadline) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
 	}
-	if (a->ote_deadline > b->ote_deadline) {
-		return 1;
+	return lo ? lo - 1 : 0;
+}
+
+/**
+ * @return the index of the first key >= deadline in the chunk
+ */
+static size_t
+otc_lower(const ot_chunk_t *c, tint_t deadline) {
+	size_t lo = 0, hi = c->otc_n;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (c->otc_key[mid] < deadline) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
 	}
-	return 0;
+	return lo;
+}
+
+/**
+ * Makes room for a chunk at position at, and allocates it
+ */
+static ot_chunk_t *
+ot_chunk_ins(ot_t *tree, size_t at) {
+	ot_chunk_t *c;
+
+	if (tree->ot_nchunks == tree->ot_cap) {
+		size_t cap = tree->ot_cap ? 2 * tree->ot_cap : 4;
+		ot_chunk_t **chunks = realloc(tree->ot_chunks,
+		    cap * sizeof(ot_chunk_t *));
+		if (!chunks) {
+			return NULL;
+		}
+		tree->ot_chunks = chunks;
+		tint_t *first = realloc(tree->ot_first, cap * sizeof(tint_t));
+		if (!first) {
+			return NULL;
+		}
+		tree->ot_first = first;
+		tree->ot_cap = cap;
+	}
+	c = calloc(1, sizeof(ot_chunk_t));
+	if (!c) {
+		return NULL;
+	}
+	memmove(&tree->ot_chunks[at + 1], &tree->ot_chunks[at],
+	    (tree->ot_nchunks - at) * sizeof(ot_chunk_t *));
+	memmove(&tree->ot_first[at + 1], &tree->ot_first[at],
+	    (tree->ot_nchunks - at) * sizeof(tint_t));
+	tree->ot_chunks[at] = c;
+	tree->ot_nchunks++;
+	return c;
+}
+
+static void
+ot_chunk_rem(ot_t *tree, size_t at) {
+	free(tree->ot_chunks[at]);
+	memmove(&tree->ot_chunks[at], &tree->ot_chunks[at + 1],
+	    (tree->ot_nchunks - at - 1) * sizeof(ot_chunk_t *));
+	memmove(&tree->ot_first[at], &tree->ot_first[at + 1],
+	    (tree->ot_nchunks - at - 1) * sizeof(tint_t));
+	tree->ot_nchunks--;
 }
 
 ot_elem_t*
 ot_find(ot_t *tree, tint_t deadline) {
-	ot_elem_t key;
-	key.ote_deadline = deadline;
-	key.ote_tasks = NULL;
-
-	void *cookie  = tfind(&key, &tree->ot_root, compare);
-	if (!cookie) {
+	if (tree->ot_nchunks == 0) {
 		return NULL;
 	}
-	ot_elem_t *needle = *(ot_elem_t**) cookie;
-	return needle;
+	ot_chunk_t *c = tree->ot_chunks[ot_chunk_of(tree, deadline)];
+	size_t i = otc_lower(c, deadline);
+	if (i < c->otc_n && c->otc_key[i] == deadline) {
+		return c->otc_elem[i];
+	}
+	return NULL;
 }
-	
 
 int
 ot_ins(ot_t *tree, ot_elem_t *elem) {
-	void *cookie = tsearch(elem, &(tree->ot_root), compare);
-	ot_elem_t *needle = *(ot_elem_t**) cookie;
-	if (needle != elem) {
+	tint_t deadline = elem->ote_deadline;
+	size_t ci, i;
+	ot_chunk_t *c;
+
+	if (tree->ot_nchunks == 0) {
+		if (!ot_chunk_ins(tree, 0)) {
+			return -1;
+		}
+		tree->ot_first[0] = deadline;
+	}
+	ci = ot_chunk_of(tree, deadline);
+	c = tree->ot_chunks[ci];
+	i = otc_lower(c, deadline);
+	if (i < c->otc_n && c->otc_key[i] == deadline) {
 		return -1;
 	}
+
+	if (c->otc_n == OT_CHUNK) {
+		/* Split, the upper half moves to a new chunk after c */
+		size_t half = OT_CHUNK / 2;
+		ot_chunk_t *n = ot_chunk_ins(tree, ci + 1);
+		if (!n) {
+			return -1;
+		}
+		n->otc_n = OT_CHUNK - half;
+		memcpy(n->otc_key, &c->otc_key[half], n->otc_n * sizeof(tint_t));
+		memcpy(n->otc_elem, &c->otc_elem[half],
+		    n->otc_n * sizeof(ot_elem_t *));
+		c->otc_n = half;
+		tree->ot_first[ci + 1] = n->otc_key[0];
+		if (i > half) {
+			c = n;
+			ci++;
+			i -= half;
+		}
+	}
+
+	memmove(&c->otc_key[i + 1], &c->otc_key[i],
+	    (c->otc_n - i) * sizeof(tint_t));
+	memmove(&c->otc_elem[i + 1], &c->otc_elem[i],
+	    (c->otc_n - i) * sizeof(ot_elem_t *));
+	c->otc_key[i] = deadline;
+	c->otc_elem[i] = elem;
+	c->otc_n++;
+	if (i == 0) {
+		tree->ot_first[ci] = deadline;
+	}
 	tree->ot_count++;
 	return 0;
 }
+
 int
 ot_rem(ot_t *tree, ot_elem_t *elem) {
-	void *cookie = tdelete(elem, &(tree->ot_root), compare);
-	if (NULL == tree->ot_root) {
-		tree->ot_count--;		
-		return 0;
+	tint_t deadline = elem->ote_deadline;
+	size_t ci, i;
+	ot_chunk_t *c;
+
+	if (tree->ot_nchunks == 0) {
+		return -1;
 	}
-	ot_elem_t *needle = *(ot_elem_t**) cookie;
-	if (needle != elem) {
+	ci = ot_chunk_of(tree, deadline);
+	c = tree->ot_chunks[ci];
+	i = otc_lower(c, deadline);
+	if (i >= c->otc_n || c->otc_elem[i] != elem) {
 		return -1;
 	}
+
+	c->otc_n--;
+	memmove(&c->otc_key[i], &c->otc_key[i + 1],
+	    (c->otc_n - i) * sizeof(tint_t));
+	memmove(&c->otc_elem[i], &c->otc_elem[i + 1],
+	    (c->otc_n - i) * sizeof(ot_elem_t *));
 	tree->ot_count--;
+
+	if (c->otc_n == 0) {
+		ot_chunk_rem(tree, ci);
+		return 0;
+	}
+	tree->ot_first[ci] = c->otc_key[0];
+
+	/* Fold sparse neighbours together so removals keep chunks dense */
+	if (ci + 1 < tree->ot_nchunks) {
+		ot_chunk_t *n = tree->ot_chunks[ci + 1];
+		if (c->otc_n + n->otc_n <= OT_CHUNK / 2) {
+			memcpy(&c->otc_key[c->otc_n], n->otc_key,
+			    n->otc_n * sizeof(tint_t));
+			memcpy(&c->otc_elem[c->otc_n], n->otc_elem,
+			    n->otc_n * sizeof(ot_elem_t *));
+			c->otc_n += n->otc_n;
+			ot_chunk_rem(tree, ci + 1);
+		}
+	}
 	return 0;
 }
 
+ot_elem_t *
+ot_iter_elem(const ot_iter_t *it) {
+	const ot_t *tree = it->oti_tree;
+
+	if (it->oti_chunk >= tree->ot_nchunks) {
+		return NULL;
+	}
+	return tree->ot_chunks[it->oti_chunk]->otc_elem[it->oti_idx];
+}
+
+ot_elem_t *
+ot_iter_next(ot_iter_t *it) {
+	const ot_t *tree = it->oti_tree;
+
+	if (it->oti_chunk >= tree->ot_nchunks) {
+		return NULL;
+	}
+	if (++it->oti_idx == tree->ot_chunks[it->oti_chunk]->otc_n) {
+		it->oti_chunk++;
+		it->oti_idx = 0;
+	}
+	return ot_iter_elem(it);
+}
+
+ot_elem_t *
+ot_begin(const ot_t *tree, ot_iter_t *it) {
+	it->oti_tree = tree;
+	it->oti_chunk = 0;
+	it->oti_idx = 0;
+	return ot_iter_elem(it);
+}
+
+ot_elem_t *
+ot_lower_bound(const ot_t *tree, tint_t deadline, ot_iter_t *it) {
+	it->oti_tree = tree;
+	it->oti_chunk = 0;
+	it->oti_idx = 0;
+	if (tree->ot_nchunks == 0) {
+		return NULL;
+	}
+	it->oti_chunk = ot_chunk_of(tree, deadline);
+	it->oti_idx = otc_lower(tree->ot_chunks[it->oti_chunk], deadline);
+	if (it->oti_idx == tree->ot_chunks[it->oti_chunk]->otc_n) {
+		/* Past the end of the chunk, the next one starts above */
+		it->oti_chunk++;
+		it->oti_idx = 0;
+	}
+	return ot_iter_elem(it);
+}
+
+ot_elem_t *
+ot_upper_bound(const ot_t *tree, tint_t deadline, ot_iter_t *it) {
+	ot_elem_t *elem = ot_lower_bound(tree, deadline, it);
+
+	if (elem && elem->ote_deadline == deadline) {
+		elem = ot_iter_next(it);
+	}
+	return elem;
+}
+
 void
 ot_empty(ot_t *tree) {
-	tdestroy(tree->ot_root, (void(*)(void*))ote_free);
+	for (size_t ci = 0; ci < tree->ot_nchunks; ci++) {
+		ot_chunk_t *c = tree->ot_chunks[ci];
+		for (size_t i = 0; i < c->otc_n; i++) {
+			ote_free(c->otc_elem[i]);
+		}
+		free(c);
+	}
+	tree->ot_nchunks = 0;
 	tree->ot_count = 0;
-	tree->ot_root = NULL;
+}
+
+void
+ot_free(ot_t *tree) {
+	if (!tree) {
+		return;
+	}
+	for (size_t ci = 0; ci < tree->ot_nchunks; ci++) {
+		free(tree->ot_chunks[ci]);
+	}
+	free(tree->ot_chunks);
+	free(tree->ot_first);
+	free(tree);
 }
 
 void ote_free(ot_elem_t *elem) {
@@ -67,4 +285,3 @@ void ote_free(ot_elem_t *elem) {
 	free(elem);
 	elem = NULL;
 }
-
@@ -3,26 +3,62 @@
 
 #include <stdint.h>
 #include <stdlib.h>
-#include <search.h>
 #include "taskset.h"
 
 /**
  * @file ordt.h Ordered (Tree) Absolute Deadline Management
  */
 
-typedef struct {
-	void *ot_root;	/**< Root of the tree */
-	tint_t ot_count;	/**< Number of deadlines in the tree */
-} ot_t;
-
 typedef struct ot_elem {
 	tint_t ote_deadline;	/**< Absolute deadline */
 	task_set_t* ote_tasks;	/**< List of tasks which share the deadline */
 } ot_elem_t;
 
+/** Entries per chunk of the tree */
+#define OT_CHUNK 64
+
+/**
+ * A sorted run of up to OT_CHUNK deadlines, the keys are kept apart
+ * from the elements so a search only touches the keys
+ */
+typedef struct ot_chunk {
+	size_t otc_n;				/**< Entries in use */
+	tint_t otc_key[OT_CHUNK];		/**< Deadlines, increasing */
+	ot_elem_t *otc_elem[OT_CHUNK];		/**< Element of each deadline */
+} ot_chunk_t;
+
+/**
+ * The tree is a two level sorted-chunk structure, a sorted array of
+ * chunks with the first key of every chunk copied into a contiguous
+ * array. A lookup is a binary search over ot_first followed by one in
+ * the chunk, there is no per-element node allocation and an in-order
+ * walk is a linear scan.
+ */
+typedef struct {
+	ot_chunk_t **ot_chunks;	/**< Chunks, in deadline order */
+	tint_t *ot_first;	/**< First deadline of each chunk */
+	size_t ot_nchunks;	/**< Chunks in use */
+	size_t ot_cap;		/**< Chunks allocated */
+	tint_t ot_count;	/**< Number of deadlines in the tree */
+} ot_t;
+
+/**
+ * In-order iterator over the tree
+ *
+ * @note inserting or removing elements invalidates iterators
+ */
+typedef struct {
+	const ot_t *oti_tree;
+	size_t oti_chunk;	/**< Chunk of the current element */
+	size_t oti_idx;		/**< Index within the chunk */
+} ot_iter_t;
+
 /**
  * Allocates and releases a tree (root)
  *
+ * @note ot_free() releases the chunks of the tree but not the elements,
+ * ot_empty() the tree first to release those.
+ *
  * Usage:
  *     ot_t *tree = ot_alloc();
  *     ...
@@ -30,14 +66,9 @@ typedef struct ot_elem {
  */
 static inline ot_t *ot_alloc(void) {
 	ot_t *tree = calloc(1, sizeof(ot_t));
-	tree->ot_count = 0;
-	tree->ot_root = NULL;
-	
-}
-static inline void ot_free(ot_t *tree) {
-	free(tree);
-	tree = NULL;
+	return tree;
 }
+void ot_free(ot_t *tree);
 
 /**
  * Inserts an element into the tree
@@ -73,6 +104,58 @@ int ot_rem(ot_t *tree, ot_elem_t *elem);
  */
 ot_elem_t* ot_find(ot_t *tree, tint_t deadline);
 
+/**
+ * Positions an iterator in the tree
+ *
+ * ot_begin() positions it at the earliest deadline, ot_lower_bound()
+ * at the first deadline >= deadline and ot_upper_bound() at the first
+ * deadline > deadline.
+ *
+ * Usage:
+ *     ot_iter_t it;
+ *     ot_elem_t *elem;
+ *     for (ot_lower_bound(tree, 10, &it); (elem = ot_iter_elem(&it));
+ *         ot_iter_next(&it)) {
+ *         ... elem->ote_deadline >= 10, in increasing order
+ *     }
+ *
+ * @param[in] tree the tree
+ * @param[in] deadline the bound
+ * @param[out] it the iterator
+ *
+ * @return the element the iterator is at, NULL if it is at the end
+ */
+ot_elem_t *ot_begin(const ot_t *tree, ot_iter_t *it);
+ot_elem_t *ot_lower_bound(const ot_t *tree, tint_t deadline, ot_iter_t *it);
+ot_elem_t *ot_upper_bound(const ot_t *tree, tint_t deadline, ot_iter_t *it);
+
+/**
+ * @return the element of the iterator, NULL if it is at the end
+ */
+ot_elem_t *ot_iter_elem(const ot_iter_t *it);
+
+/**
+ * Steps the iterator to the next deadline
+ *
+ * @return the next element, NULL at the end
+ */
+ot_elem_t *ot_iter_next(ot_iter_t *it);
+
+/**
+ * Foreach element, in increasing deadline order
+ *
+ * Usage:
+ *    ot_iter_t it;
+ *    ot_elem_t *elem;
+ *
+ *    ot_foreach(tree, &it, elem) {
+ *        ... do stuff with elem
+ *            but don't insert or remove ...
+ *    }
+ */
+#define ot_foreach(tree, it, elem) \
+	for ((elem) = ot_begin(tree, it); (elem); (elem) = ot_iter_next(it))
+
 /**
  * Empties all items from the tree
  *
@@ -0,0 +1,54 @@
+#include "qpa.h"
+#include "taskset-demand.h"
+
+int
+qpa(task_set_t *ts, FILE *dbg) {
+	int doclose = 0;
+	int rv = -1;
+	tint_t t, steps = 0;
+	int64_t h;
+	tsd_t *tsd = NULL;
+
+	if (!dbg) {
+		dbg = fopen("/dev/null", "w");
+		doclose = 1;
+	}
+
+	uint64_t star = ts_star(ts);
+	fprintf(dbg, "T* = %lu\n", star);
+	tsd = tsd_alloc(ts);
+	if (!tsd) {
+		goto bail;
+	}
+
+	/* The latest absolute deadline <= T* */
+	if (!tsd_prev_deadline(tsd, star + 1, &t)) {
+		fprintf(dbg, "No deadlines up to T*, feasible\n");
+		rv = 0;
+		goto bail;
+	}
+
+	h = tsd_demand(tsd, t);
+	steps++;
+	fprintf(dbg, "%08lu: h(t)=%08li\n", t, h);
+	while (h <= t && h > tsd->tsd_dmin) {
+		if (h < t) {
+			t = h;
+		} else if (!tsd_prev_deadline(tsd, t, &t)) {
+			break;
+		}
+		h = tsd_demand(tsd, t);
+		steps++;
+		fprintf(dbg, "%08lu: h(t)=%08li\n", t, h);
+	}
+
+	rv = h > t ? 1 : 0;
+	fprintf(dbg, "%s after %lu demand evaluations\n",
+	    rv ? "infeasible" : "feasible", steps);
+bail:
+	tsd_free(tsd);
+	if (doclose) {
+		fclose(dbg);
+	}
+	return rv;
+}
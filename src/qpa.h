@@ -0,0 +1,27 @@
+#ifndef QPA_H
+#define QPA_H
+#include <stdio.h>
+#include "taskset.h"
+
+/**
+ * Quick Processor-demand Analysis (Zhang & Burns)
+ *
+ * Exact preemptive EDF feasibility test over the absolute deadlines up
+ * to and including T*, equivalent to checking demand(D) <= D at every
+ * one of them as max_chunks() does. Rather than enumerating them, it
+ * starts at the latest deadline and walks backwards with t <- h(t),
+ * where h(t) is the demand at t, falling back to the previous deadline
+ * when h(t) == t. Only a small fraction of the deadlines is visited.
+ *
+ * @note unlike max_chunks() this does not assign the non-preemptive
+ * chunks of the tasks, the task set is not modified.
+ *
+ * @param[in] ts the task set
+ * @param[out] dbg stream to send each step of the walk to, can be NULL.
+ *
+ * @return 0 if the task set is feasible, greater than zero if it is
+ * infeasible, less than zero on error
+ */
+int qpa(task_set_t *ts, FILE *dbg);
+
+#endif /* QPA_H */
@@ -1,5 +1,7 @@
 #include <task.h>
-static char BUFF[1024];
+
+/** Size of the strings built by task_string() and task_header() */
+#define TASK_STRLEN 1024
 
 task_t*
 task_alloc(tint_t period, tint_t deadline, tint_t threads) {
@@ -55,8 +57,9 @@ task_name(task_t* task, const char* name) {
 
 char *
 task_string(task_t *task) {
-	char *s = BUFF;
-	int n = sprintf(BUFF, "(p:%4lu, d:%4lu, m:%2lu)",
+	char buff[TASK_STRLEN];
+	char *s = buff;
+	int n = sprintf(buff, "(p:%4lu, d:%4lu, m:%2lu)",
 	    task->t_period, task->t_deadline, task->t_threads);
 	s += n;
 	n = sprintf(s, " [u:%.3f, q:%lu, %s]\twcet{", task_util(task), task->t_chunk,
@@ -72,14 +75,15 @@ task_string(task_t *task) {
 	s += n;
 	n = sprintf(s, "} ");
 	s += n;
-	return strdup(BUFF);
+	return strdup(buff);
 }
 
 char *
 task_header(task_t *task) {
-	sprintf(BUFF,
+	char buff[TASK_STRLEN];
+	sprintf(buff,
 	    "(period, dedlin, tpj.) [util(m) chunk name]\twcet{c(1), c(2), ..., c(m)}");
-	return strdup(BUFF);
+	return strdup(buff);
 }
 
 
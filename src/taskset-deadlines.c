@@ -1,29 +1,63 @@
 #include "taskset-deadlines.h"
 
-tint_t
-ts_fill_deadlines_dbg(task_set_t *ts, ordl_t *head, tint_t t, FILE *dbg) {
-	task_link_t *cookie;
-	task_t *task;
-	int doclose = 0;
+/**
+ * Merges the deadlines of all tasks from <= d <= to into the ordered
+ * list, walking the list once alongside the merge
+ *
+ * @return the number of (deadline, task) pairs added
+ */
+static tint_t
+ts_merge_deadlines(task_set_t *ts, ordl_t *head, tint_t from, tint_t to) {
+	or_elem_t *c = ordl_first(head), *prev = NULL, *D;
 	tint_t count = 0;
-	if (dbg == NULL) {
-		dbg = fopen("/dev/null", "w");
-		doclose = 1;
+	dlm_t dlm;
+
+	if (!dlm_init(&dlm, ts, from, to)) {
+		return 0;
 	}
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		task = ts_task(cookie);
-		fprintf(dbg, "%s: filling to %lu ... \n", task->t_name, t);
-		fflush(dbg);
-		tint_t thisc = ts_fill_deadlines_task_dbg(task, head, t, dbg);
-		fprintf(dbg, "%s: %lu deadlines added\n", task->t_name, thisc);
-		count += thisc;
+	while (dlm_next(&dlm)) {
+		while (c && c->oe_deadline < dlm.dlm_deadline) {
+			prev = c;
+			c = ordl_next(c);
+		}
+		if (c && c->oe_deadline == dlm.dlm_deadline) {
+			D = c;
+		} else {
+			D = oe_alloc();
+			D->oe_deadline = dlm.dlm_deadline;
+			if (c) {
+				ordl_insert_before(c, D);
+			} else if (prev) {
+				ordl_insert_after(prev, D);
+			} else {
+				ordl_insert_head(head, D);
+			}
+			prev = D;
+		}
+		for (size_t i = 0; i < dlm.dlm_ntasks; i++) {
+			ts_add(D->oe_tasks, dlm.dlm_tasks[i]);
+			count++;
+		}
 	}
+	dlm_fini(&dlm);
 
-	if (doclose) {
-		fclose(dbg);
-	}
 	return count;
+}
 
+tint_t
+ts_fill_deadlines_dbg(task_set_t *ts, ordl_t *head, tint_t t, FILE *dbg) {
+	tint_t count;
+
+	if (dbg) {
+		fprintf(dbg, "Merging the deadlines of %lu tasks up to %lu\n",
+		    ts_count(ts), t);
+		fflush(dbg);
+	}
+	count = ts_merge_deadlines(ts, head, 0, t);
+	if (dbg) {
+		fprintf(dbg, "%lu deadlines added\n", count);
+	}
+	return count;
 }
 tint_t
 ts_fill_deadlines(task_set_t *ts, ordl_t *head, tint_t t) {
@@ -84,22 +118,137 @@ ts_extend_deadlines(task_set_t *ts, ordl_t* head, tint_t prevb,
 	if (prevb >= newb) {
 		return 0;
 	}
+	return ts_merge_deadlines(ts, head, prevb + 1, newb);
+}
+
+/**
+ * Heap order, by deadline then by position in the task set so the
+ * tasks of a deadline come out in task set order
+ */
+static int
+dle_less(const dlm_ent_t *a, const dlm_ent_t *b) {
+	if (a->dle_deadline != b->dle_deadline) {
+		return a->dle_deadline < b->dle_deadline;
+	}
+	return a->dle_idx < b->dle_idx;
+}
+
+static void
+dlm_down(dlm_t *dlm, size_t i) {
+	dlm_ent_t *h = dlm->dlm_heap;
+	dlm_ent_t e = h[i];
+
+	for (;;) {
+		size_t c = 2 * i + 1;
+		if (c >= dlm->dlm_n) {
+			break;
+		}
+		if (c + 1 < dlm->dlm_n && dle_less(&h[c + 1], &h[c])) {
+			c++;
+		}
+		if (!dle_less(&h[c], &e)) {
+			break;
+		}
+		h[i] = h[c];
+		i = c;
+	}
+	h[i] = e;
+}
+
+int
+dlm_init(dlm_t *dlm, task_set_t *ts, tint_t from, tint_t to) {
 	task_link_t *cookie;
-	task_t *task;
-	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
+	size_t n = ts_count(ts), idx = 0;
+
+	memset(dlm, 0, sizeof(dlm_t));
+	dlm->dlm_to = to;
+	dlm->dlm_heap = calloc(sizeof(dlm_ent_t), n ? n : 1);
+	dlm->dlm_tasks = calloc(sizeof(task_t *), n ? n : 1);
+	if (!dlm->dlm_heap || !dlm->dlm_tasks) {
+		dlm_fini(dlm);
+		return 0;
+	}
+
+	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie), idx++) {
 		task_t *task = ts_task(cookie);
-		tint_t deadline, i=0;
-		do {
-			deadline = task->t_deadline + (i * task->t_period);
-			i++;
-			if (deadline <= prevb) {
+		tint_t d = task->t_deadline;
+
+		if (d < from) {
+			if (task->t_period == 0) {
 				continue;
 			}
-			if (deadline <= newb) {
-				or_elem_t *D = oe_alloc();
-				D->oe_deadline = deadline;
-				ordl_insert(head, D);
-			}
-		} while (deadline <= newb);
+			d += (from - d + task->t_period - 1) / task->t_period *
+			    task->t_period;
+		}
+		if (d > to) {
+			continue;
+		}
+		dlm_ent_t *e = &dlm->dlm_heap[dlm->dlm_n++];
+		e->dle_deadline = d;
+		e->dle_period = task->t_period;
+		e->dle_wcet = task->wcet(task->t_threads);
+		e->dle_idx = idx;
+		e->dle_task = task;
+	}
+	for (size_t i = dlm->dlm_n / 2; i-- > 0;) {
+		dlm_down(dlm, i);
+	}
+	return 1;
+}
+
+void
+dlm_fini(dlm_t *dlm) {
+	free(dlm->dlm_heap);
+	free(dlm->dlm_tasks);
+	memset(dlm, 0, sizeof(dlm_t));
+}
+
+/** Flag dlm_next() gives up on, per thread */
+static __thread atomic_int *dlm_flag;
+
+void
+dlm_watch(atomic_int *flag) {
+	dlm_flag = flag;
+}
+
+int
+dlm_next(dlm_t *dlm) {
+	dlm_ent_t *top;
+
+	dlm->dlm_ntasks = 0;
+	if (dlm->dlm_n == 0) {
+		return 0;
+	}
+	if (dlm_flag && atomic_load_explicit(dlm_flag, memory_order_relaxed)) {
+		dlm->dlm_cancelled = 1;
+		return 0;
+	}
+	dlm->dlm_deadline = dlm->dlm_heap[0].dle_deadline;
+	while (dlm->dlm_n > 0 &&
+	    (top = &dlm->dlm_heap[0])->dle_deadline == dlm->dlm_deadline) {
+		if (top->dle_task) {
+			dlm->dlm_tasks[dlm->dlm_ntasks++] = top->dle_task;
+		}
+		dlm->dlm_demand += top->dle_wcet;
+		/* Next deadline of the task, or it leaves the heap */
+		if (top->dle_period == 0 ||
+		    top->dle_period > dlm->dlm_to - top->dle_deadline) {
+			dlm->dlm_heap[0] = dlm->dlm_heap[--dlm->dlm_n];
+		} else {
+			top->dle_deadline += top->dle_period;
+		}
+		if (dlm->dlm_n > 0) {
+			dlm_down(dlm, 0);
+		}
+	}
+	return 1;
+}
+
+void
+dlm_forget(dlm_t *dlm, task_t *task) {
+	for (size_t i = 0; i < dlm->dlm_n; i++) {
+		if (dlm->dlm_heap[i].dle_task == task) {
+			dlm->dlm_heap[i].dle_task = NULL;
+		}
 	}
 }
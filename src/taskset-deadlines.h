@@ -1,5 +1,6 @@
 #ifndef TASKSET_DEADLINES_H
 #define TASKSET_DEADLINES_H
+#include <stdatomic.h>
 #include "taskset.h"
 #include "ordl.h"
 
@@ -42,4 +43,98 @@ tint_t ts_fill_deadlines_task_dbg(task_t *task, ordl_t *head, tint_t t, FILE *db
 tint_t ts_extend_deadlines(task_set_t *ts, ordl_t *head, tint_t prevb,
     tint_t newb);
 
+/**
+ * Streaming merge of the absolute deadlines of a task set
+ *
+ * Keeps one (next deadline, task) entry per task in a min-heap and
+ * yields the distinct absolute deadlines of all tasks in increasing
+ * order, each with the tasks that share it (in task set order). Memory
+ * is O(n) in the number of tasks and each step is O(log n) per task
+ * sharing the deadline, nothing is allocated per deadline.
+ *
+ * @note the tasks are read when the merge is initialized, tasks added
+ * to the set afterwards are not part of the merge.
+ *
+ * Usage:
+ *     dlm_t dlm;
+ *     dlm_init(&dlm, ts, 0, ts_star(ts));
+ *     while (dlm_next(&dlm)) {
+ *         for (size_t i = 0; i < dlm.dlm_ntasks; i++) {
+ *             task_t *task = dlm.dlm_tasks[i];
+ *             ... task has an absolute deadline at dlm.dlm_deadline
+ *         }
+ *     }
+ *     dlm_fini(&dlm);
+ */
+typedef struct {
+	tint_t		dle_deadline;	/**< Next absolute deadline of the task */
+	tint_t		dle_period;
+	tint_t		dle_wcet;	/**< wcet(m) of the task */
+	size_t		dle_idx;	/**< Position of the task in the set */
+	task_t		*dle_task;	/**< NULL once dlm_forget()'d */
+} dlm_ent_t;
+
+typedef struct {
+	dlm_ent_t	*dlm_heap;
+	size_t		dlm_n;		/**< Entries in the heap */
+	tint_t		dlm_to;		/**< Last deadline yielded, inclusive */
+	tint_t		dlm_deadline;	/**< Current absolute deadline */
+	task_t		**dlm_tasks;	/**< Tasks with dlm_deadline */
+	size_t		dlm_ntasks;
+	int64_t		dlm_demand;	/**< Running demand, see dlm_next() */
+	int		dlm_cancelled;	/**< Ended early, see dlm_watch() */
+} dlm_t;
+
+/**
+ * Starts a merge of the deadlines d with from <= d <= to
+ *
+ * @param[out] dlm the merge
+ * @param[in] ts the task set
+ * @param[in] from the first deadline to yield, inclusive
+ * @param[in] to the last deadline to yield, inclusive
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+int dlm_init(dlm_t *dlm, task_set_t *ts, tint_t from, tint_t to);
+void dlm_fini(dlm_t *dlm);
+
+/**
+ * Steps to the next distinct absolute deadline
+ *
+ * Every job whose deadline is passed adds the WCET of its task to
+ * dlm_demand, so a merge started at 0 carries ts_demand() at
+ * dlm_deadline for O(tasks at the deadline) instead of O(n). The WCET is
+ * read when the merge is initialized, forgotten tasks still add theirs.
+ *
+ * @param[in|out] dlm the merge, dlm_deadline, dlm_tasks and
+ *     dlm_ntasks describe the new deadline
+ *
+ * @return non-zero if there is a next deadline, zero at the end
+ */
+int dlm_next(dlm_t *dlm);
+
+/**
+ * Watches a cancellation flag in the merges of the calling thread
+ *
+ * Once *flag is non-zero dlm_next() ends every merge of the thread as
+ * if it were at the end, and sets dlm_cancelled. tpj() and max_chunks()
+ * walk a merge up to T*, a cancelled one makes them return a negative
+ * value. The flag may be raised from any thread.
+ *
+ * @param[in] flag the flag, NULL stops watching
+ */
+void dlm_watch(atomic_int *flag);
+
+/**
+ * Stops listing a task in the deadlines yet to come, the deadlines
+ * themselves are still yielded
+ *
+ * Use when the task is removed from the set (and possibly freed) while
+ * the merge is underway.
+ *
+ * @param[in|out] dlm the merge
+ * @param[in] task the task
+ */
+void dlm_forget(dlm_t *dlm, task_t *task);
+
 #endif /* TASKSET_DEADLINES_H */
@@ -0,0 +1,314 @@
+#include "taskset-demand.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TSD_X86 1
+#include <immintrin.h>
+#endif
+
+/** Vector width the padded arrays are rounded up to (AVX-512 doubles) */
+#define TSD_WIDTH 8
+/** Values the vector kernels handle exactly, well under 2^53 */
+#define TSD_EXACT ((tint_t) 1 << 50)
+/** Deadline of the padding lanes, t - D is always negative */
+#define TSD_PAD_DEADLINE ((double) ((tint_t) 1 << 60))
+
+/**
+ * The integer kernel, identical to task_dbf() summed over the tasks
+ */
+static int64_t
+tsd_at_scalar(const tsd_t *tsd, tint_t t) {
+	int64_t demand = 0;
+	for (size_t i = 0; i < tsd->tsd_n; i++) {
+		if (t < tsd->tsd_deadline[i]) {
+			continue;
+		}
+		tint_t j = (t - tsd->tsd_deadline[i]) / tsd->tsd_period[i];
+		demand += (j + 1) * tsd->tsd_wcet[i];
+	}
+	return demand;
+}
+
+static void
+tsd_kern_scalar(const tsd_t *tsd, const tint_t *t, int64_t *demand,
+    size_t n) {
+	for (size_t j = 0; j < n; j++) {
+		demand[j] = t[j] < tsd->tsd_dmin ? 0 : tsd_at_scalar(tsd, t[j]);
+	}
+}
+
+#ifdef TSD_X86
+/*
+ * Both vector kernels compute, for every lane,
+ *
+ *     x = t - D_i
+ *     dbf_i = x < 0 ? 0 : (floor(x / P_i) + 1) * C_i
+ *
+ * and sum the lanes. The padding lanes have C_i = 0 and a deadline far
+ * beyond any t, so they contribute nothing.
+ */
+__attribute__((target("avx2")))
+static int64_t
+tsd_at_avx2(const tsd_t *tsd, double t) {
+	const __m256d vt = _mm256_set1_pd(t);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d zero = _mm256_setzero_pd();
+	__m256d acc = zero;
+	double lane[4];
+
+	for (size_t i = 0; i < tsd->tsd_npad; i += 4) {
+		__m256d x = _mm256_sub_pd(vt,
+		    _mm256_load_pd(tsd->tsd_fdeadline + i));
+		__m256d q = _mm256_floor_pd(_mm256_div_pd(x,
+		    _mm256_load_pd(tsd->tsd_fperiod + i)));
+		__m256d d = _mm256_mul_pd(_mm256_add_pd(q, one),
+		    _mm256_load_pd(tsd->tsd_fwcet + i));
+		__m256d ge = _mm256_cmp_pd(x, zero, _CMP_GE_OQ);
+		acc = _mm256_add_pd(acc, _mm256_and_pd(ge, d));
+	}
+	_mm256_storeu_pd(lane, acc);
+	return (int64_t) (lane[0] + lane[1] + lane[2] + lane[3]);
+}
+
+__attribute__((target("avx2")))
+static void
+tsd_kern_avx2(const tsd_t *tsd, const tint_t *t, int64_t *demand,
+    size_t n) {
+	for (size_t j = 0; j < n; j++) {
+		if (t[j] < tsd->tsd_dmin) {
+			demand[j] = 0;
+		} else if (t[j] >= tsd->tsd_tlim) {
+			demand[j] = tsd_at_scalar(tsd, t[j]);
+		} else {
+			demand[j] = tsd_at_avx2(tsd, (double) t[j]);
+		}
+	}
+}
+
+__attribute__((target("avx512f")))
+static int64_t
+tsd_at_avx512(const tsd_t *tsd, double t) {
+	const __m512d vt = _mm512_set1_pd(t);
+	const __m512d one = _mm512_set1_pd(1.0);
+	const __m512d zero = _mm512_setzero_pd();
+	__m512d acc = zero;
+
+	for (size_t i = 0; i < tsd->tsd_npad; i += 8) {
+		__m512d x = _mm512_sub_pd(vt,
+		    _mm512_load_pd(tsd->tsd_fdeadline + i));
+		__m512d q = _mm512_roundscale_pd(_mm512_div_pd(x,
+		    _mm512_load_pd(tsd->tsd_fperiod + i)),
+		    _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+		__m512d d = _mm512_mul_pd(_mm512_add_pd(q, one),
+		    _mm512_load_pd(tsd->tsd_fwcet + i));
+		__mmask8 ge = _mm512_cmp_pd_mask(x, zero, _CMP_GE_OQ);
+		acc = _mm512_mask_add_pd(acc, ge, acc, d);
+	}
+	return (int64_t) _mm512_reduce_add_pd(acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+tsd_kern_avx512(const tsd_t *tsd, const tint_t *t, int64_t *demand,
+    size_t n) {
+	for (size_t j = 0; j < n; j++) {
+		if (t[j] < tsd->tsd_dmin) {
+			demand[j] = 0;
+		} else if (t[j] >= tsd->tsd_tlim) {
+			demand[j] = tsd_at_scalar(tsd, t[j]);
+		} else {
+			demand[j] = tsd_at_avx512(tsd, (double) t[j]);
+		}
+	}
+}
+#endif /* TSD_X86 */
+
+/**
+ * Lowers isa to the widest kernel the CPU supports
+ */
+static enum tsd_isa
+tsd_supported(enum tsd_isa isa) {
+#ifdef TSD_X86
+	__builtin_cpu_init();
+	if (isa >= TSD_AVX512 && __builtin_cpu_supports("avx512f")) {
+		return TSD_AVX512;
+	}
+	if (isa >= TSD_AVX2 && __builtin_cpu_supports("avx2")) {
+		return TSD_AVX2;
+	}
+#endif
+	return TSD_SCALAR;
+}
+
+/**
+ * Finds the bound below which the vector kernels are exact
+ *
+ * demand(t) <= sum (((t - D_i) / P_i) + 1) * C_i <= t * U + sum C_i, so
+ * keeping t * U + sum C_i below TSD_EXACT keeps every partial sum an
+ * exactly representable integer.
+ */
+static tint_t
+tsd_limit(const tsd_t *tsd) {
+	double util = 0, wcet = 0;
+
+	for (size_t i = 0; i < tsd->tsd_n; i++) {
+		if (tsd->tsd_deadline[i] >= TSD_EXACT ||
+		    tsd->tsd_period[i] >= TSD_EXACT ||
+		    tsd->tsd_wcet[i] >= TSD_EXACT ||
+		    tsd->tsd_period[i] == 0) {
+			return 0;
+		}
+		util += (double) tsd->tsd_wcet[i] / tsd->tsd_period[i];
+		wcet += tsd->tsd_wcet[i];
+	}
+	if (wcet >= TSD_EXACT) {
+		return 0;
+	}
+	if (util <= 0) {
+		return TSD_EXACT;
+	}
+	double lim = (TSD_EXACT - wcet) / util;
+	if (lim >= TSD_EXACT) {
+		return TSD_EXACT;
+	}
+	return (tint_t) lim;
+}
+
+tsd_t *
+tsd_alloc_isa(task_set_t *ts, enum tsd_isa isa) {
+	tsd_t *tsd = calloc(sizeof(tsd_t), 1);
+	task_link_t *cookie;
+	size_t i;
+
+	if (!tsd) {
+		return NULL;
+	}
+	tsd->tsd_n = ts_count(ts);
+	tsd->tsd_npad = (tsd->tsd_n + TSD_WIDTH - 1) / TSD_WIDTH * TSD_WIDTH;
+	if (tsd->tsd_npad == 0) {
+		tsd->tsd_npad = TSD_WIDTH;
+	}
+	tsd->tsd_deadline = calloc(sizeof(tint_t), tsd->tsd_npad);
+	tsd->tsd_period = calloc(sizeof(tint_t), tsd->tsd_npad);
+	tsd->tsd_wcet = calloc(sizeof(tint_t), tsd->tsd_npad);
+	tsd->tsd_fdeadline = aligned_alloc(TSD_WIDTH * sizeof(double),
+	    tsd->tsd_npad * sizeof(double));
+	tsd->tsd_fperiod = aligned_alloc(TSD_WIDTH * sizeof(double),
+	    tsd->tsd_npad * sizeof(double));
+	tsd->tsd_fwcet = aligned_alloc(TSD_WIDTH * sizeof(double),
+	    tsd->tsd_npad * sizeof(double));
+	if (!tsd->tsd_deadline || !tsd->tsd_period || !tsd->tsd_wcet ||
+	    !tsd->tsd_fdeadline || !tsd->tsd_fperiod || !tsd->tsd_fwcet) {
+		goto bail;
+	}
+
+	tsd->tsd_dmin = UINT64_MAX;
+	i = 0;
+	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie), i++) {
+		task_t *task = ts_task(cookie);
+		tsd->tsd_deadline[i] = task->t_deadline;
+		tsd->tsd_period[i] = task->t_period;
+		tsd->tsd_wcet[i] = task->wcet(task->t_threads);
+		if (task->t_deadline < tsd->tsd_dmin) {
+			tsd->tsd_dmin = task->t_deadline;
+		}
+	}
+	for (i = 0; i < tsd->tsd_npad; i++) {
+		if (i < tsd->tsd_n) {
+			tsd->tsd_fdeadline[i] = tsd->tsd_deadline[i];
+			tsd->tsd_fperiod[i] = tsd->tsd_period[i];
+			tsd->tsd_fwcet[i] = tsd->tsd_wcet[i];
+		} else {
+			tsd->tsd_fdeadline[i] = TSD_PAD_DEADLINE;
+			tsd->tsd_fperiod[i] = 1;
+			tsd->tsd_fwcet[i] = 0;
+		}
+	}
+	tsd->tsd_tlim = tsd_limit(tsd);
+
+	tsd->tsd_isa = tsd_supported(isa);
+	switch (tsd->tsd_isa) {
+#ifdef TSD_X86
+	case TSD_AVX512:
+		tsd->tsd_kern = tsd_kern_avx512;
+		break;
+	case TSD_AVX2:
+		tsd->tsd_kern = tsd_kern_avx2;
+		break;
+#endif
+	default:
+		tsd->tsd_isa = TSD_SCALAR;
+		tsd->tsd_kern = tsd_kern_scalar;
+		break;
+	}
+	return tsd;
+
+bail:
+	tsd_free(tsd);
+	return NULL;
+}
+
+tsd_t *
+tsd_alloc(task_set_t *ts) {
+	return tsd_alloc_isa(ts, TSD_AVX512);
+}
+
+void
+tsd_free(tsd_t *tsd) {
+	if (!tsd) {
+		return;
+	}
+	free(tsd->tsd_deadline);
+	free(tsd->tsd_period);
+	free(tsd->tsd_wcet);
+	free(tsd->tsd_fdeadline);
+	free(tsd->tsd_fperiod);
+	free(tsd->tsd_fwcet);
+	free(tsd);
+}
+
+int64_t
+tsd_demand(const tsd_t *tsd, tint_t t) {
+	int64_t demand;
+	tsd->tsd_kern(tsd, &t, &demand, 1);
+	return demand;
+}
+
+void
+tsd_demand_block(const tsd_t *tsd, const tint_t *t, int64_t *demand,
+    size_t n) {
+	tsd->tsd_kern(tsd, t, demand, n);
+}
+
+int
+tsd_prev_deadline(const tsd_t *tsd, tint_t t, tint_t *d) {
+	int found = 0;
+	tint_t prev = 0;
+
+	for (size_t i = 0; i < tsd->tsd_n; i++) {
+		if (t <= tsd->tsd_deadline[i]) {
+			continue;
+		}
+		tint_t k = (t - 1 - tsd->tsd_deadline[i]) / tsd->tsd_period[i];
+		tint_t di = tsd->tsd_deadline[i] + k * tsd->tsd_period[i];
+		if (!found || di > prev) {
+			prev = di;
+			found = 1;
+		}
+	}
+	if (found) {
+		*d = prev;
+	}
+	return found;
+}
+
+const char *
+tsd_isa_name(const tsd_t *tsd) {
+	switch (tsd->tsd_isa) {
+	case TSD_AVX512:
+		return "avx512";
+	case TSD_AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef TASKSET_DEMAND_H
+#define TASKSET_DEMAND_H
+#include "taskset.h"
+
+/**
+ * Prepared demand context
+ *
+ * ts_demand() walks the task list and divides once per task for every
+ * t it is asked about. The feasibility tests ask about every absolute
+ * deadline up to T*, so the context copies (D_i, P_i, C_i = wcet(m_i))
+ * of every task into packed arrays once and evaluates the demand bound
+ * function over those with a vector kernel chosen for the CPU.
+ *
+ * The vector kernels work in double precision, which is exact as long
+ * as t and the demand at t stay well below 2^53. The context computes
+ * the largest t for which that holds (tsd_tlim) and answers anything at
+ * or beyond it with the integer kernel, so every result is identical to
+ * ts_demand().
+ *
+ * @note the context is a snapshot, it must be rebuilt (tsd_free() and
+ * tsd_alloc()) when tasks are added, removed or modified.
+ *
+ * Usage:
+ *     tsd_t *tsd = tsd_alloc(ts);
+ *     for (each absolute deadline D) {
+ *         int64_t slack = D - tsd_demand(tsd, D);
+ *     }
+ *     tsd_free(tsd);
+ */
+enum tsd_isa {
+	TSD_SCALAR,
+	TSD_AVX2,
+	TSD_AVX512
+};
+
+typedef struct tsd_s tsd_t;
+typedef void (*tsd_kern_t)(const tsd_t *tsd, const tint_t *t,
+    int64_t *demand, size_t n);
+
+struct tsd_s {
+	size_t		tsd_n;		/**< Number of tasks */
+	size_t		tsd_npad;	/**< tsd_n padded to the vector width */
+	tint_t		*tsd_deadline;	/**< D_i */
+	tint_t		*tsd_period;	/**< P_i */
+	tint_t		*tsd_wcet;	/**< C_i = wcet(m_i) */
+	double		*tsd_fdeadline;	/**< D_i, padded, for the vector kernels */
+	double		*tsd_fperiod;	/**< P_i, padded */
+	double		*tsd_fwcet;	/**< C_i, padded (0 in the padding) */
+	tint_t		tsd_dmin;	/**< Smallest D_i, demand is 0 below */
+	tint_t		tsd_tlim;	/**< The vector kernel is exact below */
+	enum tsd_isa	tsd_isa;	/**< Kernel in use */
+	tsd_kern_t	tsd_kern;
+};
+
+/**
+ * Builds a demand context for a task set using the widest kernel the
+ * CPU supports
+ *
+ * @param[in] ts the task set
+ *
+ * @return a new context that must be tsd_free()'d, NULL otherwise
+ */
+tsd_t *tsd_alloc(task_set_t *ts);
+
+/**
+ * Builds a demand context with at most the given kernel
+ *
+ * The kernel is lowered to one the CPU supports, tsd->tsd_isa tells
+ * which one was picked.
+ *
+ * @param[in] ts the task set
+ * @param[in] isa the widest kernel to use
+ *
+ * @return a new context that must be tsd_free()'d, NULL otherwise
+ */
+tsd_t *tsd_alloc_isa(task_set_t *ts, enum tsd_isa isa);
+void tsd_free(tsd_t *tsd);
+
+/**
+ * Calculates the demand for an interval of length t
+ *
+ * @param[in] tsd the demand context
+ * @param[in] t the time
+ *
+ * @return the demand at time t, equal to ts_demand() of the task set
+ */
+int64_t tsd_demand(const tsd_t *tsd, tint_t t);
+
+/**
+ * Calculates the demand for a block of interval lengths
+ *
+ * @param[in] tsd the demand context
+ * @param[in] t the times
+ * @param[out] demand the demand at each of t
+ * @param[in] n the number of times
+ */
+void tsd_demand_block(const tsd_t *tsd, const tint_t *t, int64_t *demand,
+    size_t n);
+
+/**
+ * Finds the latest absolute deadline strictly before t
+ *
+ * @param[in] tsd the demand context
+ * @param[in] t the time
+ * @param[out] d the latest absolute deadline of any task that is < t
+ *
+ * @return non-zero if there is such a deadline, zero otherwise
+ */
+int tsd_prev_deadline(const tsd_t *tsd, tint_t t, tint_t *d);
+
+/**
+ * @return the name of the kernel in use, for diagnostics
+ */
+const char *tsd_isa_name(const tsd_t *tsd);
+
+#endif /* TASKSET_DEMAND_H */
@@ -10,7 +10,7 @@ ts_fill_ot_deadlines_dbg(task_set_t *ts, ot_t *head, tint_t t, FILE *dbg) {
 		dbg = fopen("/dev/null", "w");
 		doclose = 1;
 	}
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
+	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
 		task = ts_task(cookie);
 		fprintf(dbg, "%s: filling to %lu ... \n", task->t_name, t);
 		fflush(dbg);
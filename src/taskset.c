@@ -1,10 +1,12 @@
 #include "taskset.h"
-static char BUFF[8192];
+
+/** Size of the strings built by ts_string(), ts_header() and ts_permit() */
+#define TS_STRLEN 8192
 
 task_set_t*
 ts_alloc() {
 	task_set_t *ts = calloc(sizeof(task_set_t), 1);
-	/* calloc ensures ts_head is NULL */
+	/* calloc ensures the set is empty */
 	return ts;
 }
 
@@ -13,11 +15,7 @@ ts_free(task_set_t* ts) {
 	if (!ts) {
 		return;
 	}
-	task_link_t *cur, *next;
-	for (cur = ts->ts_head; cur; cur = next) {
-		next = cur->tl_next;
-		ts_rem(ts, cur);
-	}
+	free(ts->ts_links);
 	free(ts);
 	ts = NULL;
 }
@@ -25,12 +23,14 @@ ts_free(task_set_t* ts) {
 task_set_t*
 ts_dup(task_set_t *ts) {
 	task_set_t *rv = ts_alloc();
-	task_link_t *cookie;
 
-	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
-		task_t *orig = ts_task(cookie);
-		task_t *dup = task_dup(orig, orig->t_threads);
-		ts_add(rv, dup);
+	if (!rv || !ts_reserve(rv, ts->ts_n)) {
+		ts_free(rv);
+		return NULL;
+	}
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		task_t *orig = ts_at(ts, i);
+		ts_add(rv, task_dup(orig, orig->t_threads));
 	}
 
 	return rv;
@@ -41,70 +41,76 @@ ts_destroy(task_set_t* ts) {
 	if (!ts) {
 		return;
 	}
-	task_link_t *cur, *next;	
-	for (cur = ts->ts_head; cur; cur = next) {
-		next = cur->tl_next;
-		task_t *task = ts_rem(ts, cur);
-		task_free(task);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		task_free(ts_at(ts, i));
 	}
-	free(ts);
-	ts = NULL;
-	
+	ts_free(ts);
 }
 
 char *
 ts_string(task_set_t *ts) {
-	task_link_t *cursor = ts->ts_head;
-	char *s = BUFF;
-	memset(BUFF, 0, sizeof(BUFF));
-	int n=0,count=1;
-	for (cursor = ts->ts_head ; cursor ; cursor = cursor->tl_next, count++) {
-		char *t = task_string(cursor->tl_task);
-		if (cursor->tl_next) {
-			n = sprintf(s, "%2i: %s\n", count, t);
+	char buff[TS_STRLEN];
+	char *s = buff;
+	memset(buff, 0, sizeof(buff));
+	int n=0;
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		char *t = task_string(ts_at(ts, i));
+		if (i + 1 < ts->ts_n) {
+			n = sprintf(s, "%2zu: %s\n", i + 1, t);
 		} else {
-			n = sprintf(s, "%2i: %s", count, t);
+			n = sprintf(s, "%2zu: %s", i + 1, t);
 		}
 		free(t);
 		s += n;
 	}
-	return strdup(BUFF);
+	return strdup(buff);
 }
 
 char *
 ts_header(task_set_t *ts) {
+	char buff[TS_STRLEN];
 	char *t = task_header(NULL);
-	sprintf(BUFF, "#T: %s", t);
+	sprintf(buff, "#T: %s", t);
 	free(t);
 
-	return strdup(BUFF);
+	return strdup(buff);
 }
 
 
+int
+ts_reserve(task_set_t *ts, size_t n) {
+	if (n <= ts->ts_cap) {
+		return 1;
+	}
+	size_t cap = ts->ts_cap ? ts->ts_cap : 8;
+	while (cap < n) {
+		cap *= 2;
+	}
+	task_link_t *links = realloc(ts->ts_links, cap * sizeof(task_link_t));
+	if (!links) {
+		return 0;
+	}
+	ts->ts_links = links;
+	ts->ts_cap = cap;
+	return 1;
+}
+
 task_link_t*
 ts_add(task_set_t *ts, task_t *task) {
-	task_link_t *cookie = calloc(sizeof(task_link_t), 1);
+	if (!ts_reserve(ts, ts->ts_n + 1)) {
+		return NULL;
+	}
+	task_link_t *cookie = &ts->ts_links[ts->ts_n++];
 	cookie->tl_task = task;
 
-	if (!ts->ts_head) {
-		/* empty list */
-		ts->ts_head = cookie;
-		return cookie;
-	}
-	task_link_t *last = ts_last(ts);
-	insque(cookie, last);
-	
 	return cookie;
 }
 
 task_link_t*
 ts_find(task_set_t *ts, task_t *task) {
-	task_link_t *cookie;
-	task_t *t;
-	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
-		t = ts_task(cookie);
-		if (t == task) {
-			return cookie;
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		if (ts_at(ts, i) == task) {
+			return &ts->ts_links[i];
 		}
 	}
 	return NULL;
@@ -112,34 +118,30 @@ ts_find(task_set_t *ts, task_t *task) {
 
 task_t*
 ts_rem(task_set_t *ts, task_link_t *cookie) {
+	if (!cookie || cookie < ts->ts_links ||
+	    cookie >= ts->ts_links + ts->ts_n) {
+		return NULL;
+	}
+	size_t i = cookie - ts->ts_links;
 	task_t *task = cookie->tl_task;
-	if (ts->ts_head && ts->ts_head == cookie) {
-		ts->ts_head = cookie->tl_next;
-		free(cookie);
-		return task;
-	}	
-	remque(cookie); // frees the cookie .. unless it's the head.
-	free(cookie);
+	memmove(cookie, cookie + 1, (ts->ts_n - i - 1) * sizeof(task_link_t));
+	ts->ts_n--;
 	return task;
 }
 
 task_link_t*
 ts_last(task_set_t *ts) {
-	task_link_t *cursor;
-	for (cursor = ts->ts_head; cursor->tl_next; cursor = cursor->tl_next) {
-		/* do nothing */
-	}
-	return cursor;
+	return ts->ts_n ? &ts->ts_links[ts->ts_n - 1] : NULL;
 }
 
 task_link_t*
 ts_first(task_set_t *ts) {
-	return ts->ts_head;
+	return ts->ts_n ? ts->ts_links : NULL;
 }
 
 task_link_t*
 ts_next(task_set_t *ts, task_link_t *cookie) {
-	return cookie->tl_next;
+	return cookie + 1 < ts->ts_links + ts->ts_n ? cookie + 1 : NULL;
 }
 
 /**
@@ -180,17 +182,16 @@ lcm(tint_t a, tint_t b) {
 
 tint_t
 ts_hyperp(task_set_t *ts) {
-	task_link_t *cookie = ts_first(ts);
 	task_t *t;
 	tint_t P=0;
 
-	if (!cookie) {
+	if (!ts->ts_n) {
 		return 0;
 	}
 
-	P = ts_task(cookie)->t_period;
-	for (; cookie; cookie = cookie->tl_next) {
-		t = ts_task(cookie);
+	P = ts_at(ts, 0)->t_period;
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		t = ts_at(ts, i);
 		tint_t oldp = P;
 		P = lcm(P, t->t_period);
 		if (P == 0) {
@@ -203,17 +204,16 @@ ts_hyperp(task_set_t *ts) {
 
 tint_t
 ts_dmax(task_set_t *ts) {
-	task_link_t *cookie = ts_first(ts);
 	task_t *t;
 	tint_t dmax=0;
 
-	if (!cookie) {
+	if (!ts->ts_n) {
 		return 0;
 	}
 
-	dmax = ts_task(cookie)->t_deadline;
-	for (; cookie; cookie = cookie->tl_next) {
-		t = ts_task(cookie);
+	dmax = ts_at(ts, 0)->t_deadline;
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		t = ts_at(ts, i);
 		if (t->t_deadline > dmax) {
 			dmax = t->t_deadline;
 		}
@@ -224,12 +224,11 @@ ts_dmax(task_set_t *ts) {
 
 float_t
 ts_util(task_set_t *ts) {
-	task_link_t *cookie;
 	task_t *t;
 	float_t U=0.0;
 
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		t = ts_task(cookie);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		t = ts_at(ts, i);
 		U += task_util(t);
 	}
 
@@ -238,14 +237,13 @@ ts_util(task_set_t *ts) {
 
 uint64_t
 ts_star(task_set_t *ts) {
-	task_link_t *cookie;
 	task_t *t;
 	double_t upd = 0, updi;
 	tint_t maxd = ts_max_pdiff(ts);
 
 	double_t max_r = 1 / (1 - ts_util(ts));
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		t = ts_task(cookie);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		t = ts_at(ts, i);
 		updi = task_util(t) * maxd;
 		upd += updi;
 	}
@@ -270,7 +268,6 @@ ts_star(task_set_t *ts) {
 
 uint64_t
 ts_star_debug(task_set_t *ts, FILE *f) {
-	task_link_t *cookie;
 	task_t *t;
 	double_t upd = 0, updi;
 
@@ -292,8 +289,8 @@ ts_star_debug(task_set_t *ts, FILE *f) {
 
 
 	float_t sum = 0;
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		t = ts_task(cookie);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		t = ts_at(ts, i);
 		float_t util = task_util(t);
 		float_t s = util * diffmax;
 		fprintf(f, "\t\t+ %s %f * %li = %f\n", t->t_name, util, diffmax, s);
@@ -326,12 +323,11 @@ ts_star_debug(task_set_t *ts, FILE *f) {
 
 tint_t
 ts_max_pdiff(task_set_t * ts) {
-	task_link_t *cookie = NULL;
 	task_t *t;
 	tint_t maxd = 0, curd;
 
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		t = ts_task(cookie);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		t = ts_at(ts, i);
 		curd = t->t_period - t->t_deadline;
 		if (curd > maxd) {
 			maxd = curd;
@@ -344,17 +340,18 @@ ts_max_pdiff(task_set_t * ts) {
 
 char*
 ts_permit(task_set_t* ts) {
+	char buff[TS_STRLEN];
 	double_t u = ts_util(ts);
 	u = 1 / (1 - u);
 	if (isinf(u)) {
-		sprintf(BUFF, "1 / (1 - U) of task set is infinite");
-		return strdup(BUFF);
+		sprintf(buff, "1 / (1 - U) of task set is infinite");
+		return strdup(buff);
 	}
 
 	u = ts_util(ts);
 	if (u >= 1) {
-		sprintf(BUFF, "Utilization of the task set is >= 1, %f", u);
-		return strdup(BUFF);
+		sprintf(buff, "Utilization of the task set is >= 1, %f", u);
+		return strdup(buff);
 	}
 
 	return NULL;
@@ -362,32 +359,27 @@ ts_permit(task_set_t* ts) {
 
 int64_t
 ts_slack(task_set_t *ts, tint_t t) {
-	task_link_t *cookie;
 	int64_t demand = ts_demand(ts, t);
 	return 0;
 }
 
 int64_t
 ts_demand(task_set_t *ts, tint_t t) {
-	task_link_t *cookie;
-	task_t *task;
 	int64_t demand = 0;
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		task = ts_task(cookie);
-		demand += task_dbf(task, t);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		demand += task_dbf(ts_at(ts, i), t);
 	}
 	return demand;
 }
 
 int64_t
 ts_demand_debug(task_set_t *ts, tint_t t, FILE *f) {
-	task_link_t *cookie;
 	task_t *task;
 	int64_t demand = 0;
 	fprintf(f, "Task Set Demand at time %lu\n", t);
 	char *str = ts_string(ts); fprintf(f, "%s\n", str); free(str);
-	for (cookie = ts_first(ts); cookie; cookie = cookie->tl_next) {
-		task = ts_task(cookie);
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		task = ts_at(ts, i);
 		int64_t tdemand = task_dbf_debug(task, t, f);
 		demand += tdemand;
 		fprintf(f, "Total Demand: %li, %s adds %li demand\n",
@@ -405,37 +397,31 @@ ts_demand_debug(task_set_t *ts, tint_t t, FILE *f) {
 
 
 tint_t ts_count(task_set_t *ts) {
-	task_link_t *cursor;
-	tint_t count=0;
-
-	for (cursor = ts->ts_head ; cursor ; cursor = cursor->tl_next) {
-		count++;
-	}
-
-	return count;
+	return ts->ts_n;
 }
 
 tint_t ts_threads(task_set_t *ts) {
-	task_link_t *cursor;
 	tint_t count=0;
 
-	for (cursor = ts->ts_head ; cursor ; cursor = cursor->tl_next) {
-		count += ts_task(cursor)->t_threads;
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		count += ts_at(ts, i)->t_threads;
 	}
 
 	return count;
 }
 
-task_set_t *
-ts_divide(task_t *task, tint_t maxm) {
-	task_set_t *ts;
+/**
+ * Appends the division of a task into at most maxm threads per job
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+static int
+ts_divide_into(task_set_t *ts, task_t *task, tint_t maxm) {
 	tint_t m = task->t_threads;
-	
-	if ((task == NULL) || (m == 0)) {
-		return NULL;
-	}
 
-	ts = ts_alloc();
+	if (!ts_reserve(ts, ts->ts_n + (m + maxm - 1) / maxm)) {
+		return 0;
+	}
 	while (m > 0) {
 		task_t *t;
 		if (maxm < m) {
@@ -447,31 +433,44 @@ ts_divide(task_t *task, tint_t maxm) {
 		}
 		ts_add(ts, t);
 	}
+	return 1;
+}
+
+task_set_t *
+ts_divide(task_t *task, tint_t maxm) {
+	task_set_t *ts;
+
+	if ((task == NULL) || (task->t_threads == 0) || (maxm == 0)) {
+		return NULL;
+	}
+
+	ts = ts_alloc();
+	if (!ts || !ts_divide_into(ts, task, maxm)) {
+		ts_destroy(ts);
+		return NULL;
+	}
 	
 	return ts;
 }
 
 task_set_t *
 ts_divide_set(task_set_t *ts, tint_t maxm) {
-	task_set_t *rv, *tmp;
-	task_link_t *cookie;
+	task_set_t *rv;
 	
 	if ((ts == NULL) || (maxm == 0)) {
 		return NULL;
 	}
 
 	rv = ts_alloc();
-	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
-		task_t *t = ts_task(cookie);
-		char *str;
-		tmp = ts_divide(t, maxm);
-		if (!tmp) {
+	if (!rv) {
+		return NULL;
+	}
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		task_t *t = ts_at(ts, i);
+		if (t->t_threads == 0 || !ts_divide_into(rv, t, maxm)) {
 			ts_destroy(rv);
 			return NULL;
 		}
-		
-		ts_move(tmp, rv);
-		ts_destroy(tmp);
 	}
 	
 	return rv;
@@ -479,28 +478,29 @@ ts_divide_set(task_set_t *ts, tint_t maxm) {
 	
 int
 ts_move(task_set_t* src, task_set_t* dst) {
-	task_link_t *cookie, *next=NULL;
-	task_t* t;
-	char *s;
-	int i = 0;
+	size_t n = src->ts_n;
 
-	for (cookie = ts_first(src); cookie; cookie = next, i++) {
-		t = ts_task(cookie);
-		next = ts_next(src, cookie);
-		ts_rem(src, cookie);
-		ts_add(dst, t);
+	if (!ts_reserve(dst, dst->ts_n + n)) {
+		return 0;
 	}
-	return i;
+	memcpy(&dst->ts_links[dst->ts_n], src->ts_links,
+	    n * sizeof(task_link_t));
+	dst->ts_n += n;
+	src->ts_n = 0;
+	return n;
 }
 
 task_set_t *
 ts_merge(task_set_t *ts) {
 	task_set_t *rv = ts_alloc();
-	task_link_t *cookie;
 
-	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
+	if (!rv || !ts_reserve(rv, ts->ts_n)) {
+		ts_free(rv);
+		return NULL;
+	}
+	for (size_t i = 0; i < ts->ts_n; i++) {
 		task_t *t, *new_task;
-		t = ts_task(cookie);
+		t = ts_at(ts, i);
 		new_task = task_dup(t, t->t_threads);
 		task_merge(new_task);
 		ts_add(rv, new_task);
@@ -511,11 +511,8 @@ ts_merge(task_set_t *ts) {
 
 int
 ts_is_constrained(task_set_t *ts) {
-	task_link_t *cookie;
-
-	for (cookie = ts_first(ts); cookie; cookie = ts_next(ts, cookie)) {
-		task_t *t = ts_task(cookie);
-		if (!task_is_constrained(t)) {
+	for (size_t i = 0; i < ts->ts_n; i++) {
+		if (!task_is_constrained(ts_at(ts, i))) {
 			return 0;
 		}
 	}
@@ -3,7 +3,6 @@
 
 #include <math.h>
 #include "task.h"
-#include <search.h>
 
 /**
  * Feasibility constants for tests
@@ -15,16 +14,24 @@ typedef enum {
 } feas_t;
 
 /**
- * Doubly Linked List wrapping the tasks
+ * A slot of the task set, wrapping a task
  */
 typedef struct task_link {
-	struct task_link *tl_next;
-	struct task_link *tl_prev;
 	task_t *tl_task;
 } task_link_t;
 
+/**
+ * Contiguous array of the tasks, in the order they were added
+ *
+ * Appending, counting and indexing are O(1), and a walk over the set is
+ * a scan of ts_links. Tasks are never copied or moved by the set, the
+ * task_t pointers are the stable handles. A cookie points at the slot
+ * of a task and is only good until the set is modified (see ts_add()).
+ */
 typedef struct {
-	task_link_t *ts_head;
+	task_link_t *ts_links;	/**< ts_n slots in use */
+	size_t ts_n;
+	size_t ts_cap;		/**< Slots allocated */
 } task_set_t;
 
 task_set_t* ts_alloc();
@@ -64,7 +71,8 @@ char *ts_header(task_set_t *ts);
  * Adding and removing tasks from the task set.
  *
  * When a task is added, a cookie is produced. The cookie is valid
- * until the next call of tset_*. 
+ * until the set is next modified: ts_add() may grow the array and
+ * ts_rem() shifts the tasks after the one removed.
  *
  * Usage:
  *
@@ -76,14 +84,25 @@ char *ts_header(task_set_t *ts);
  */
 
 /**
- * Adds a task to the set
+ * Adds a task to the end of the set, amortized O(1)
  *
  * @param[in] task the task being added to the set
  *
- * @return a cookie tracking where the task has been added in the set
+ * @return a cookie tracking where the task has been added in the set,
+ * NULL if the set could not grow
  */
 task_link_t* ts_add(task_set_t *ts, task_t *task);
 
+/**
+ * Makes room for at least n tasks in the set
+ *
+ * @param[in|out] ts the task set
+ * @param[in] n the number of tasks
+ *
+ * @return non-zero upon success, zero otherwise
+ */
+int ts_reserve(task_set_t *ts, size_t n);
+
 /**
  * Finds a task in the set
  *
@@ -94,7 +113,7 @@ task_link_t* ts_add(task_set_t *ts, task_t *task);
 task_link_t* ts_find(task_set_t *ts, task_t *task);
 
 /**
- * Removes a task from the set
+ * Removes a task from the set, the tasks after it keep their order
  *
  * @param[in] cookie the cookie of the task in the set
  *
@@ -138,6 +157,16 @@ task_link_t* ts_next(task_set_t *ts, task_link_t *cookie);
  */
 #define ts_task(x) ((*x).tl_task)
 
+/**
+ * Gets the i-th task of the set, in O(1)
+ *
+ * @param[in] ts the task set
+ * @param[in] i the index, less than ts_count()
+ *
+ * @return pointer to the task (can be assigned)
+ */
+#define ts_at(ts, i) ((ts)->ts_links[i].tl_task)
+
 /**
  * Calculates the hyperperiod of the task set
  *
@@ -224,9 +253,7 @@ int64_t ts_demand_debug(task_set_t *ts, tint_t t, FILE *f);
 
 
 /**
- * Returns the number of tasks in the task set
- *
- * @note this is an O(n) walk.
+ * Returns the number of tasks in the task set, in O(1)
  *
  * @param[in] ts the task set
  *
@@ -236,8 +263,8 @@ tint_t ts_count(task_set_t *ts);
 
 /**
  * Returns the total number of therads in the task set
-
- * @note this is an O(n) walk.
+ *
+ * @note this is an O(n) scan, the tasks may change their threads.
  *
  * @param[in] ts the task set
  *
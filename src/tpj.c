@@ -1,4 +1,5 @@
 #include "tpj.h"
+#include "taskset-demand.h"
 /**
  * Modifies a task, such that the number of threads will complete
  * within slack amount of time.
@@ -7,19 +8,19 @@
  * contains the task is updated.
  *
  * @param[in|out] ts the task set, will be modified.
- * @param[in|out] head head of the ordered absolute deadline list
+ * @param[in|out] dlm the merge of absolute deadlines, at the deadline
+ *     of the task
  * @param[in|out] the task being divided will have its threads and
  *     WCET values updated
  * @param[in] slack the available slack
- * @param[in] star the T* to add deadlines of the ordered list to
+ * @param[in] star the T* the deadlines are merged up to
  * 
  * @return non-zero upon success, zero otherwise
  */
 static int
-divide(task_set_t *ts, ordl_t *head, task_t *task, tint_t slack, uint64_t star) {
+divide(task_set_t *ts, dlm_t *dlm, task_t *task, tint_t slack, uint64_t star) {
 	char namebuf[TASK_NAMELEN], needle[TASK_NAMELEN], *p;
 	task_link_t *ts_cursor = NULL;
-	or_elem_t *oe_cursor = NULL;
 	task_t *task_o,	*task_p;
 	tint_t threads;
 
@@ -42,12 +43,11 @@ divide(task_set_t *ts, ordl_t *head, task_t *task, tint_t slack, uint64_t star)
 	/* 
 	 * ASSUMPTION
 	 * TPJ will divide tasks *only* when encountering their
-	 * relative deadline as an absolute deadline in the ordered
-	 * list of deadlines. That is why it is safe to search with
-	 * the relative deadline of the task
+	 * relative deadline as an absolute deadline in the merge of
+	 * deadlines. That is why the merge must be at the relative
+	 * deadline of the task
 	 */
-	oe_cursor = ordl_find(head, task->t_deadline);
-	if (!oe_cursor) {
+	if (dlm->dlm_deadline != task->t_deadline) {
 		/* xxx-ct assert here. */
 		return 0;
 	}
@@ -75,8 +75,8 @@ divide(task_set_t *ts, ordl_t *head, task_t *task, tint_t slack, uint64_t star)
 		/* Add the tasks to the deadlines, necessary for
 		   demand */
 	}
-	/* Maintain the ordl set */
-	ordl_rem_deadlines_task(head, task);
+	/* The later deadlines of the merge no longer list the task */
+	dlm_forget(dlm, task);
 	task_free(task);
 	
 	return 1;
@@ -85,39 +85,43 @@ divide(task_set_t *ts, ordl_t *head, task_t *task, tint_t slack, uint64_t star)
 int
 tpj(task_set_t *ts, FILE *dbg) {
 	uint64_t star = ts_star(ts);
-	or_elem_t *cursor;
 	int infeasible = 0;
 	int doclose = 0;
-	
-	ordl_t head;
-	ordl_init(&head);
-	ts_fill_deadlines_dbg(ts, &head, star, dbg);
+	tsd_t *tsd = tsd_alloc(ts);
 
-	if (!dbg) {
+	if (!tsd) {
+		return -1;
+	}
+	dlm_t dlm;
+	if (dbg) {
+		fprintf(dbg, "Absolute Deadlines:\n");
+		dlm_init(&dlm, ts, 0, star);
+		while (dlm_next(&dlm)) {
+			fprintf(dbg, "%6lu", dlm.dlm_deadline);
+		}
+		dlm_fini(&dlm);
+		fprintf(dbg, "\n");
+	} else {
 		dbg = fopen("/dev/null", "w");
 		doclose = 1;
 	}
-	fprintf(dbg, "Absolute Deadlines:\n");
-	ordl_foreach(&head, cursor) {
-		fprintf(dbg, "%6lu", cursor->oe_deadline);
+	if (!dlm_init(&dlm, ts, 0, star)) {
+		infeasible = -1;
+		goto bail;
 	}
-	fprintf(dbg, "\n");
 
 	tint_t D_b = 0; 		/* Prev. interval */
 	int64_t slack_b = INT64_MAX;	/* Prev. interval slack */
-	ordl_foreach(&head, cursor) {
-		tint_t D_c = cursor->oe_deadline;	/* Cur. interval */
+	while (dlm_next(&dlm)) {
+		tint_t D_c = dlm.dlm_deadline;		/* Cur. interval */
 		int64_t slack_c, demand=0;
 		int64_t slackp = slack_b;
 		if (slackp == INT64_MAX) {
 			slackp = -1;
 		}
 
-		task_set_t *deadline_ts = cursor->oe_tasks;
-		task_link_t *cookie, *next;
-		for (cookie = ts_first(deadline_ts); cookie; cookie = next) {
-			next = ts_next(deadline_ts, cookie);
-			task_t *task = ts_task(cookie);
+		for (size_t i = 0; i < dlm.dlm_ntasks; i++) {
+			task_t *task = dlm.dlm_tasks[i];
 			tint_t wcet = task->wcet(task->t_threads);
 
 			fprintf(dbg,
@@ -145,13 +149,21 @@ tpj(task_set_t *ts, FILE *dbg) {
 			}
 			fprintf(dbg, "    WCET(%lu):%lu > Slack:%ld --> dividing %s\n",
 				task->t_threads, wcet, slackp, task->t_name);
-			divide(ts, &head, task, slack_b, star);
+			if (divide(ts, &dlm, task, slack_b, star)) {
+				/* The demand context is a snapshot of ts */
+				tsd_free(tsd);
+				tsd = tsd_alloc(ts);
+				if (!tsd) {
+					infeasible = -1;
+					break;
+				}
+			}
 		}
 		if (infeasible) {
 			break;
 		}
 		
-		slack_c = D_c - ts_demand(ts, D_c);
+		slack_c = D_c - tsd_demand(tsd, D_c);
 		if (slack_c < slack_b) {
 			slack_b = slack_c;
 		}
@@ -162,8 +174,12 @@ tpj(task_set_t *ts, FILE *dbg) {
 		}
 	}
 
-	/* Clean up the ORDL list, do *not* remove the tasks. */
-	ordl_clear(&head);
+	if (dlm.dlm_cancelled) {
+		infeasible = -1;
+	}
+	dlm_fini(&dlm);
+bail:
+	tsd_free(tsd);
 
 	fprintf(dbg, "\n");
 	if (doclose) {
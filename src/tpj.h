@@ -15,8 +15,9 @@
  * @param[out] debug stream to send debugging output, can be NULL.
  *
  * @return 0 if the task set is well formed and feasible, less than
- * zero if the task set is poorly formed, greater than zero if the
- * task set is infeasible
+ * zero if the task set is poorly formed, memory ran out or the test
+ * was cancelled (see dlm_watch()), greater than zero if the task set
+ * is infeasible
  */
 int tpj(task_set_t *ts, FILE *debug);
 
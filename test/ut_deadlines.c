@@ -7,16 +7,24 @@
 #include <libconfig.h>
 
 #include "taskset-deadlines.h"
+#include "tpj.h"
+#include "maxchunks.h"
 
 int ut_dl_init(void) { return 0; }
 int ut_dl_cleanup(void) { return 0; }
 
 static void dl_framework(void);
 static void dl_fill_deadlines(void);
+static void dl_merge(void);
+static void dl_running_demand(void);
+static void dl_watch(void);
 
 CU_TestInfo ut_dl_tests[] = {
     { "Test framework", dl_framework},
     { "Fill deadlines", dl_fill_deadlines},    
+    { "Merge deadlines", dl_merge},
+    { "Running demand", dl_running_demand},
+    { "Cancelled merge", dl_watch},
     CU_TEST_INFO_NULL
 };
 
@@ -55,3 +63,137 @@ dl_fill_deadlines(void) {
 	
 	ts_destroy(ts);
 }
+
+/**
+ * The merge yields every absolute deadline in a window once, in order,
+ * with the tasks that share it, and keeps yielding the deadlines of a
+ * forgotten task without listing it
+ */
+static void
+dl_merge(void) {
+	task_set_t *ts = ts_alloc();
+	task_t *tasks[4];
+	tint_t p[4] = {6, 4, 9, 0}, d[4] = {6, 2, 5, 7};
+	int ok = 1, n = 0;
+	tint_t prev = 0;
+	dlm_t dlm;
+
+	for (int i = 0; i < 4; i++) {
+		tasks[i] = task_alloc(p[i], d[i], 1);
+		tasks[i]->wcet(1) = 1;
+		ts_add(ts, tasks[i]);
+	}
+
+	CU_ASSERT_TRUE(dlm_init(&dlm, ts, 3, 40));
+	while (dlm_next(&dlm)) {
+		tint_t t = dlm.dlm_deadline;
+		size_t k = 0;
+
+		ok = ok && t >= 3 && t <= 40 && (n == 0 || t > prev);
+		for (int i = 0; i < 4; i++) {
+			int has = t >= d[i] &&
+			    (p[i] ? (t - d[i]) % p[i] == 0 : t == d[i]) &&
+			    !(i == 1 && t > 14);
+			if (has) {
+				ok = ok && k < dlm.dlm_ntasks &&
+				    dlm.dlm_tasks[k] == tasks[i];
+				k++;
+			}
+		}
+		ok = ok && k == dlm.dlm_ntasks;
+		if (t == 14) {
+			dlm_forget(&dlm, tasks[1]);
+		}
+		prev = t;
+		n++;
+	}
+	dlm_fini(&dlm);
+	CU_ASSERT_TRUE(ok);
+	/* 5 6 7 10 12 14 18 22 23 24 26 30 32 34 36 38 */
+	CU_ASSERT_EQUAL(n, 16);
+
+	/* Extending a filled list adds the new deadlines in order */
+	ordl_t head;
+	ordl_init(&head);
+	ts_fill_deadlines(ts, &head, 12);
+	CU_ASSERT_EQUAL(ts_extend_deadlines(ts, &head, 12, 24), 7);
+	or_elem_t *o_cursor;
+	prev = 0;
+	ok = 1;
+	ordl_foreach(&head, o_cursor) {
+		ok = ok && o_cursor->oe_deadline > prev;
+		prev = o_cursor->oe_deadline;
+	}
+	CU_ASSERT_TRUE(ok);
+	CU_ASSERT_EQUAL(prev, 24);
+	ordl_clear(&head);
+
+	ts_destroy(ts);
+}
+
+/**
+ * The running demand of a merge from 0 is the demand at each deadline
+ */
+static void
+dl_running_demand(void) {
+	task_set_t *ts = ts_alloc();
+	int ok = 1, n = 0;
+	dlm_t dlm;
+
+	for (int i = 0; i < 9; i++) {
+		task_t *task = task_alloc(10 + (7 * i) % 23, 5 + (5 * i) % 17, 2);
+		task->wcet(1) = 1 + i % 4;
+		task->wcet(2) = 2 + i % 5;
+		ts_add(ts, task);
+	}
+	CU_ASSERT_TRUE(dlm_init(&dlm, ts, 0, 1000));
+	while (dlm_next(&dlm)) {
+		ok = ok && dlm.dlm_demand == ts_demand(ts, dlm.dlm_deadline);
+		n++;
+	}
+	dlm_fini(&dlm);
+	CU_ASSERT_TRUE(ok);
+	CU_ASSERT_TRUE(n > 100);
+
+	ts_destroy(ts);
+}
+
+/**
+ * A raised flag ends the merge early, and the tests walking it say so
+ */
+static void
+dl_watch(void) {
+	task_set_t *ts = ts_alloc();
+	atomic_int flag = 0;
+	int n = 0;
+	dlm_t dlm;
+
+	for (int i = 0; i < 4; i++) {
+		task_t *task = task_alloc(10 + i, 8 + i, 1);
+		task->wcet(1) = 1;
+		ts_add(ts, task);
+	}
+	dlm_watch(&flag);
+	CU_ASSERT_TRUE(dlm_init(&dlm, ts, 0, 1000));
+	while (dlm_next(&dlm)) {
+		if (++n == 10) {
+			atomic_store(&flag, 1);
+		}
+	}
+	CU_ASSERT_EQUAL(n, 10);
+	CU_ASSERT_TRUE(dlm.dlm_cancelled);
+	dlm_fini(&dlm);
+
+	CU_ASSERT_TRUE(max_chunks(ts) < 0);
+	CU_ASSERT_TRUE(tpj(ts, NULL) < 0);
+
+	/* Lowered, or no longer watched, the tests run to the end */
+	atomic_store(&flag, 0);
+	CU_ASSERT_EQUAL(max_chunks(ts), 0);
+	atomic_store(&flag, 1);
+	dlm_watch(NULL);
+	CU_ASSERT_EQUAL(max_chunks(ts), 0);
+	CU_ASSERT_EQUAL(tpj(ts, NULL), 0);
+
+	ts_destroy(ts);
+}
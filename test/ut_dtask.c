@@ -6,6 +6,7 @@
 #include "dag-task.h"
 #include "dag-walk.h"
 #include "dag-collapse.h"
+#include "dag-candidate.h"
 
 int ut_dtask_init(void) { return 0; }
 int ut_dtask_cleanup(void) { return 0; }
@@ -26,6 +27,24 @@ static void dtask_2sharedc(void);
 static void dtask_path(void);
 static void dtask_2collapse(void);
 static void dtask_no_collapse(void);
+static void dtask_rw(void);
+static void dtask_remove_edges(void);
+static void dtask_incremental(void);
+static void dtask_deep(void);
+static void dtask_order(void);
+static void dtask_reach(void);
+static void dtask_delta_l(void);
+static void dtask_delta_c(void);
+static void dtask_arena(void);
+static void dtask_w_quoted(void);
+static void dtask_bin(void);
+static void dtask_objs(void);
+static void dtask_corder_jobs(void);
+static void dtask_ctab(void);
+static void dtask_collapse_all(void);
+static void dtask_collapse_stop(void);
+static void dtask_collapse_exhaustive(void);
+static void dtask_journal(void);
 
 
 CU_TestInfo ut_dtask_tests[] = {
@@ -45,6 +64,24 @@ CU_TestInfo ut_dtask_tests[] = {
     { "Multihop Path", dtask_path},
     { "No Collapse", dtask_no_collapse},
     { "Two Collapse", dtask_2collapse},
+    { "Write and Read", dtask_rw},
+    { "Remove with Edges", dtask_remove_edges},
+    { "Incremental Update", dtask_incremental},
+    { "Deep Chain", dtask_deep},
+    { "Topological Order and Longest Path", dtask_order},
+    { "Reachability", dtask_reach},
+    { "Critical Path Length Delta", dtask_delta_l},
+    { "Workload Delta", dtask_delta_c},
+    { "Copy into an Arena", dtask_arena},
+    { "Write Quoted Names", dtask_w_quoted},
+    { "Binary Write and Map", dtask_bin},
+    { "Object Index", dtask_objs},
+    { "Parallel Candidate Order", dtask_corder_jobs},
+    { "Candidate Table", dtask_ctab},
+    { "Greedy Collapse", dtask_collapse_all},
+    { "Greedy Collapse Stop", dtask_collapse_stop},
+    { "Greedy Collapse Exhaustive", dtask_collapse_exhaustive},
+    { "Begin, Commit and Rollback", dtask_journal},
     CU_TEST_INFO_NULL
 };
 
@@ -305,6 +342,7 @@ dtask_ut_copy(void) {
 
 	dnode_free(n0);
 	dnode_free(n1);
+	dtask_free(cp);
 	dtask_free(task);
 }
 
@@ -629,3 +667,1186 @@ dtask_2collapse(void) {
 
 	dtask_free(task);
 }
+
+static void
+dtask_rw(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[4];
+
+	for (int i = 0; i < 4; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], i + 1);
+		dnode_set_object(nodes[i], i % 2);
+		dnode_set_wcet_one(nodes[i], 10 * (i + 1));
+		dnode_set_factor(nodes[i], .5);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[3]);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+	task->dt_period = 200;
+	task->dt_deadline = 150;
+	dtask_update(task);
+
+	FILE *file = fopen("ut-dtask-rw.dot", "w+");
+	CU_ASSERT_TRUE(file != NULL);
+	CU_ASSERT_TRUE(dtask_write(task, file));
+	rewind(file);
+	dtask_t *rd = dtask_read(file);
+	fclose(file);
+	remove("ut-dtask-rw.dot");
+	CU_ASSERT_TRUE(rd != NULL);
+
+	CU_ASSERT_TRUE(dtask_nnodes(rd) == 4);
+	CU_ASSERT_TRUE(rd->dt_period == 200);
+	CU_ASSERT_TRUE(rd->dt_deadline == 150);
+	CU_ASSERT_TRUE(dtask_workload(rd) == dtask_workload(task));
+	CU_ASSERT_TRUE(dtask_cpathlen(rd) == dtask_cpathlen(task));
+
+	/* Nodes keep their values */
+	for (int i = 0; i < 4; i++) {
+		dnode_t *node = dtask_name_search(rd, nodes[i]->dn_name);
+		CU_ASSERT_TRUE(node != NULL);
+		CU_ASSERT_TRUE(dnode_get_threads(node) == i + 1);
+		CU_ASSERT_TRUE(dnode_get_object(node) == i % 2);
+		CU_ASSERT_TRUE(dnode_get_wcet(node) == dnode_get_wcet(nodes[i]));
+		dnode_free(node);
+	}
+
+	/* Edges keep their order */
+	dnid_t id = dtask_name_id(rd, "n_0");
+	CU_ASSERT_TRUE(dtask_outdeg(rd, id) == 2);
+	CU_ASSERT_TRUE(dtask_succs(rd, id)[0] == dtask_name_id(rd, "n_2"));
+	CU_ASSERT_TRUE(dtask_succs(rd, id)[1] == dtask_name_id(rd, "n_1"));
+	id = dtask_name_id(rd, "n_3");
+	CU_ASSERT_TRUE(dtask_indeg(rd, id) == 2);
+
+	for (int i = 0; i < 4; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(rd);
+	dtask_free(task);
+}
+
+static void
+dtask_remove_edges(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[3];
+
+	for (int i = 0; i < 3; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	CU_ASSERT_TRUE(dnode_outdegree(nodes[0]) == 2);
+	CU_ASSERT_TRUE(dnode_indegree(nodes[2]) == 2);
+
+	/* Removing n_1 removes its edges */
+	CU_ASSERT_TRUE(dtask_remove(task, nodes[1]));
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 2);
+	CU_ASSERT_TRUE(dnode_outdegree(nodes[0]) == 1);
+	CU_ASSERT_TRUE(dnode_indegree(nodes[2]) == 1);
+	dedge_t *e = dtask_search_edge(task, "n_0", "n_2");
+	CU_ASSERT_TRUE(e != NULL);
+	dedge_free(e);
+	e = dtask_search_edge(task, "n_0", "n_1");
+	CU_ASSERT_TRUE(e == NULL);
+
+	/* A node inserted again is a new node */
+	CU_ASSERT_TRUE(dtask_insert(task, nodes[1]));
+	CU_ASSERT_TRUE(dnode_indegree(nodes[1]) == 0);
+	CU_ASSERT_TRUE(dnode_outdegree(nodes[1]) == 0);
+
+	for (int i = 0; i < 3; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+/**
+ * Critical path length and workload follow every change to the task
+ */
+static void
+dtask_incremental(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[4];
+	tint_t wcet[4] = { 10, 20, 30, 5 };
+
+	for (int i = 0; i < 4; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], 1);
+		dnode_set_wcet_one(nodes[i], wcet[i]);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[3]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 60);
+	CU_ASSERT_TRUE(dtask_workload(task) == 65);
+
+	/* Longer node */
+	dnode_set_wcet_one(nodes[3], 50);
+	dnode_update(nodes[3]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 60);
+	CU_ASSERT_TRUE(dtask_workload(task) == 110);
+
+	/* Longer path through the new edge */
+	dtask_insert_edge(task, nodes[3], nodes[2]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 90);
+
+	/* Shorter node */
+	dnode_set_wcet_one(nodes[3], 5);
+	dnode_update(nodes[3]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 60);
+	CU_ASSERT_TRUE(dtask_workload(task) == 65);
+
+	/* Shorter path once the edge is gone */
+	dtask_remove_edge(task, nodes[0], nodes[1]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 50);
+
+	/* Removing the sink leaves the longest node */
+	dtask_remove(task, nodes[2]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 20);
+	CU_ASSERT_TRUE(dtask_workload(task) == 35);
+
+	for (int i = 0; i < 4; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+/**
+ * Walks of a chain far deeper than the call stack would allow
+ */
+#define UT_DEEP 200000
+static void
+dtask_deep(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *first = dnode_alloc("n_0");
+	dtask_insert(task, first);
+	dnode_t *prev = dnode_copy(first);
+
+	for (int i = 1; i < UT_DEEP; i++) {
+		sprintf(buff, "n_%d", i);
+		dnode_t *node = dnode_alloc(buff);
+		dtask_insert(task, node);
+		dtask_insert_edge(task, prev, node);
+		dnode_free(prev);
+		prev = node;
+	}
+	/* A node not reachable from n_0 */
+	dnode_t *other = dnode_alloc("other");
+	dtask_insert(task, other);
+	dtask_insert_edge(task, other, prev);
+
+	CU_ASSERT_TRUE(dag_pathlen(first, prev) == UT_DEEP);
+	CU_ASSERT_TRUE(dag_pathlen(prev, first) == 0);
+
+	dnode_t **topo = dag_topological(first);
+	int count = 0;
+	int ordered = 1;
+	for (int i = 0; topo[i] != NULL; i++) {
+		sprintf(buff, "n_%d", i);
+		ordered = ordered && dnode_has_name(topo[i], buff);
+		dnode_free(topo[i]);
+		count++;
+	}
+	free(topo);
+	CU_ASSERT_TRUE(ordered);
+	CU_ASSERT_TRUE(count == UT_DEEP);
+
+	dnode_free(first);
+	dnode_free(prev);
+	dnode_free(other);
+	dtask_free(task);
+}
+
+static void
+dtask_order(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[6];
+	for (int i = 0; i < 6; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_wcet_one(nodes[i], i+1);
+		dnode_set_threads(nodes[i], (i+1)*2);
+		dnode_set_factor(nodes[i], .75);
+		dtask_insert(task, nodes[i]);
+	}
+	/* Inserted backwards, ids are not in topological order */
+	dtask_insert_edge(task, nodes[4], nodes[5]);
+	dtask_insert_edge(task, nodes[3], nodes[4]);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+	dtask_insert_edge(task, nodes[1], nodes[3]);
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+
+	dnid_t order[6];
+	int pos[6];
+	dnid_t n = dtask_topo_order(task, order);
+	CU_ASSERT_TRUE(n == 6);
+	for (int i = 0; i < 6; i++) {
+		pos[order[i]] = i;
+	}
+	CU_ASSERT_TRUE(pos[0] < pos[1] && pos[0] < pos[2]);
+	CU_ASSERT_TRUE(pos[1] < pos[3] && pos[2] < pos[3]);
+	CU_ASSERT_TRUE(pos[3] < pos[4] && pos[4] < pos[5]);
+
+	tint_t dist[6] = { 0 };
+	CU_ASSERT_TRUE(dtask_longest_path(task, order, n, dist) == 137);
+	CU_ASSERT_TRUE(dist[5] == 137);
+	CU_ASSERT_TRUE(dist[0] == dnode_get_wcet(nodes[0]));
+
+	/* A cycle leaves nodes out of the order */
+	dtask_insert_edge(task, nodes[5], nodes[3]);
+	CU_ASSERT_TRUE(dtask_topo_order(task, order) < 6);
+
+	for (int i = 0; i < 6; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+/**
+ * n_0 -> n_1 -> n_2 and n_0 -> n_2, n_3 is not connected
+ */
+static void
+dtask_reach(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[4];
+	for (int i = 0; i < 4; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dtask_insert(task, nodes[i]);
+	}
+	/* The direct edge comes first */
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[2]);
+
+	CU_ASSERT_TRUE(dtask_reach_far(task, 0, 2) == 1);
+	CU_ASSERT_TRUE(dtask_reach_far(task, 0, 1) == 0);
+	CU_ASSERT_TRUE(dtask_reach_far(task, 2, 0) == 0);
+	CU_ASSERT_TRUE(dtask_reach_far(task, 0, 3) == 0);
+	CU_ASSERT_TRUE(dag_far_path(nodes[0], nodes[2]));
+	CU_ASSERT_FALSE(dag_far_path(nodes[1], nodes[2]));
+
+	/* The index follows changes of the edges */
+	dtask_remove_edge(task, nodes[1], nodes[2]);
+	CU_ASSERT_TRUE(dtask_reach_far(task, 0, 2) == 0);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+	CU_ASSERT_TRUE(dtask_reach_far(task, 0, 3) == 1);
+
+	/* With a cycle there is no index, the walk answers */
+	dtask_insert_edge(task, nodes[3], nodes[0]);
+	CU_ASSERT_TRUE(dtask_reach_far(task, 0, 3) == -1);
+	CU_ASSERT_TRUE(dag_far_path(nodes[0], nodes[3]));
+	CU_ASSERT_FALSE(dag_far_path(nodes[1], nodes[1]));
+
+	for (int i = 0; i < 4; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+/**
+ * n_0 -> n_1 -> n_3, n_0 -> n_2 -> n_3 and n_3 -> n_4, n_1 and n_2
+ * share an object, so do n_3 and n_4
+ */
+static void
+dtask_delta_l(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[5];
+	tint_t wcet[5] = { 10, 20, 30, 5, 5 };
+	tint_t object[5] = { 0, 1, 1, 2, 2 };
+
+	for (int i = 0; i < 5; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], 1);
+		dnode_set_wcet_one(nodes[i], wcet[i]);
+		dnode_set_object(nodes[i], object[i]);
+		dnode_set_factor(nodes[i], 1);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[1], nodes[3]);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+	dtask_insert_edge(task, nodes[3], nodes[4]);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 50);
+
+	/* Parallel nodes become one of two threads: 20 + 20 */
+	cand_t *c = cand_alloc();
+	c->c_a = dnode_copy(nodes[1]);
+	c->c_b = dnode_copy(nodes[2]);
+	CU_ASSERT_TRUE(dag_can_collapse(c->c_a, c->c_b));
+	CU_ASSERT_TRUE(cand_delta_l(c) == -10);
+	cand_free(c);
+
+	/* Both nodes of the critical path become one: 5 + 5 */
+	c = cand_alloc();
+	c->c_a = dnode_copy(nodes[3]);
+	c->c_b = dnode_copy(nodes[4]);
+	CU_ASSERT_TRUE(dag_can_collapse(c->c_a, c->c_b));
+	CU_ASSERT_TRUE(cand_delta_l(c) == 0);
+	dnode_set_factor(nodes[3], 0);
+	dnode_update(nodes[3]);
+	CU_ASSERT_TRUE(cand_delta_l(c) == 5);
+	cand_free(c);
+
+	/* The task is untouched */
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 50);
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 5);
+
+	for (int i = 0; i < 5; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+static void
+dtask_delta_c(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[4];
+	tint_t threads[4] = { 1, 2, 1, 3 };
+	float_t factor[4] = { .5, .25, 1, 0 };
+
+	for (int i = 0; i < 4; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], threads[i]);
+		dnode_set_wcet_one(nodes[i], 20);
+		dnode_set_factor(nodes[i], factor[i]);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[1], nodes[3]);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+
+	cand_list_t *list = cand_list_alloc();
+	cand_t *c = cand_alloc();
+	c->c_a = dnode_copy(nodes[1]);
+	c->c_b = dnode_copy(nodes[2]);
+	cand_insert_head(list, c);
+	c = cand_alloc();
+	c->c_a = dnode_copy(nodes[0]);
+	c->c_b = dnode_copy(nodes[3]);
+	cand_insert_head(list, c);
+
+	/* 20 + 20 - (20 + 3 * 10) */
+	CU_ASSERT_TRUE(cand_delta_c(c) == -10);
+	/* 25 + 20 - (20 + 2 * 5) */
+	CU_ASSERT_TRUE(cand_delta_c(cand_next(c)) == 15);
+
+	cand_foreach(list, c) {
+		c->c_delta_c = -1;
+	}
+	CU_ASSERT_TRUE(cand_delta_c_list(list) == 2);
+	c = cand_first(list);
+	CU_ASSERT_TRUE(c->c_delta_c == -10);
+	CU_ASSERT_TRUE(cand_next(c)->c_delta_c == 15);
+	CU_ASSERT_TRUE(dtask_workload(task) == 85);
+
+	cand_list_destroy(list);
+	for (int i = 0; i < 4; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+static void
+dtask_arena(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[4];
+
+	for (int i = 0; i < 4; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], 1);
+		dnode_set_wcet_one(nodes[i], 10 * (i + 1));
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[3]);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+	task->dt_collapsed = 3;
+	dtask_update(task);
+
+	/* Reference collapse on a heap copy */
+	dtask_t *cp = dtask_copy(task);
+	CU_ASSERT_TRUE(cp != NULL);
+	CU_ASSERT_TRUE(cp->dt_collapsed == 3);
+	CU_ASSERT_TRUE(dtask_name_id(cp, "n_3") == 3);
+	dnode_t *a = dtask_name_search(cp, "n_1");
+	dnode_t *b = dtask_name_search(cp, "n_2");
+	CU_ASSERT_TRUE(dag_collapse(a, b));
+	tint_t cpathlen = dtask_cpathlen(cp);
+	tint_t workload = dtask_workload(cp);
+	dnode_free(a);
+	dnode_free(b);
+	dtask_free(cp);
+
+	darena_t *arena = darena_alloc(256);
+	CU_ASSERT_TRUE(arena != NULL);
+	int same = 1;
+	for (int i = 0; i < 64; i++) {
+		cp = dtask_copy_arena(task, arena);
+		if (!cp) {
+			same = 0;
+			break;
+		}
+		dnode_t *src = dtask_source(cp);
+		same = same && src && dnode_has_name(src, "n_0");
+		dnode_free(src);
+		same = same && cp->dt_collapsed == 3;
+		same = same && dtask_cpathlen(cp) == dtask_cpathlen(task);
+		same = same && dtask_workload(cp) == dtask_workload(task);
+		/* Edges keep their order */
+		same = same && dtask_succs(cp, 0)[0] == 2;
+		same = same && dtask_succs(cp, 0)[1] == 1;
+
+		a = dtask_name_search(cp, "n_1");
+		b = dtask_name_search(cp, "n_2");
+		same = same && dag_collapse(a, b);
+		same = same && dtask_cpathlen(cp) == cpathlen;
+		same = same && dtask_workload(cp) == workload;
+		dnode_free(a);
+		dnode_free(b);
+		dtask_free(cp);
+		darena_reset(arena);
+	}
+	CU_ASSERT_TRUE(same);
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 4);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == 80);
+
+	darena_free(arena);
+	for (int i = 0; i < 4; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+static void
+dtask_w_quoted(void) {
+	char *names[4] = { "node", "n_0,n_4", "2x", "say \"hi\"" };
+	dtask_t *task = dtask_alloc("Task{n=4}");
+	dnode_t *nodes[4];
+
+	for (int i = 0; i < 4; i++) {
+		nodes[i] = dnode_alloc(names[i]);
+		dnode_set_threads(nodes[i], 1);
+		dnode_set_wcet_one(nodes[i], i + 1);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[3], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[2]);
+	dtask_insert_edge(task, nodes[2], nodes[0]);
+
+	FILE *file = fopen("ut-dtask-quoted.dot", "w+");
+	CU_ASSERT_TRUE(file != NULL);
+	CU_ASSERT_TRUE(dtask_write(task, file));
+	rewind(file);
+	dtask_t *rd = dtask_read(file);
+	fclose(file);
+	remove("ut-dtask-quoted.dot");
+	CU_ASSERT_TRUE(rd != NULL);
+
+	CU_ASSERT_TRUE(strcmp(rd->dt_name, task->dt_name) == 0);
+	CU_ASSERT_TRUE(dtask_nnodes(rd) == 4);
+	/* Nodes are read back in the order of their ids */
+	int same = 1;
+	for (int i = 0; i < 4; i++) {
+		same = same && dtask_name_id(rd, names[i]) == (dnid_t) i;
+	}
+	CU_ASSERT_TRUE(same);
+	CU_ASSERT_TRUE(dtask_cpathlen(rd) == 10);
+
+	for (int i = 0; i < 4; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(rd);
+	dtask_free(task);
+}
+
+/**
+ * The task written by dtask_write_bin() and mapped again
+ */
+static dtask_t *
+dtask_bin_back(dtask_t *task) {
+	FILE *file = tmpfile();
+	dtask_t *rv;
+
+	dtask_write_bin(task, file);
+	rewind(file);
+	rv = dtask_map(fileno(file));
+	fclose(file);
+	return rv;
+}
+
+static void
+dtask_bin(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[5];
+
+	for (int i = 0; i < 5; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], i + 1);
+		dnode_set_object(nodes[i], i % 2);
+		dnode_set_wcet_one(nodes[i], 10 * (i + 1));
+		dnode_set_factor(nodes[i], .5);
+		dtask_insert(task, nodes[i]);
+	}
+	dtask_insert_edge(task, nodes[0], nodes[2]);
+	dtask_insert_edge(task, nodes[0], nodes[1]);
+	dtask_insert_edge(task, nodes[1], nodes[3]);
+	dtask_insert_edge(task, nodes[2], nodes[3]);
+	dtask_insert_edge(task, nodes[3], nodes[4]);
+	/* Leaves a hole in the ids */
+	dtask_remove(task, nodes[4]);
+	task->dt_period = 200;
+	task->dt_deadline = 150;
+	task->dt_collapsed = 2;
+
+	FILE *file = fopen("ut-dtask-bin.dtb", "w+");
+	CU_ASSERT_TRUE(file != NULL);
+	CU_ASSERT_TRUE(dtask_write_bin(task, file));
+	fclose(file);
+	dtask_t *rd = dtask_read_path("ut-dtask-bin.dtb");
+	remove("ut-dtask-bin.dtb");
+	CU_ASSERT_TRUE(rd != NULL);
+
+	CU_ASSERT_TRUE(strcmp(rd->dt_name, "test") == 0);
+	CU_ASSERT_TRUE(dtask_nnodes(rd) == 4);
+	CU_ASSERT_TRUE(rd->dt_period == 200);
+	CU_ASSERT_TRUE(rd->dt_deadline == 150);
+	CU_ASSERT_TRUE(rd->dt_collapsed == 2);
+	CU_ASSERT_TRUE(dtask_workload(rd) == dtask_workload(task));
+	CU_ASSERT_TRUE(dtask_cpathlen(rd) == dtask_cpathlen(task));
+	dnode_t *src = dtask_source(rd);
+	CU_ASSERT_TRUE(src && dnode_has_name(src, "n_0"));
+	dnode_free(src);
+
+	int same = 1;
+	for (int i = 0; i < 4; i++) {
+		dnode_t *node = dtask_name_search(rd, nodes[i]->dn_name);
+		same = same && node && node->dn_id == (dnid_t) i;
+		same = same && node && dnode_get_wcet(node) ==
+		    dnode_get_wcet(nodes[i]);
+		same = same && node && dnode_get_factor(node) ==
+		    dnode_get_factor(nodes[i]);
+		dnode_free(node);
+	}
+	CU_ASSERT_TRUE(same);
+	CU_ASSERT_TRUE(dtask_name_id(rd, "n_4") == DNID_NONE);
+	CU_ASSERT_TRUE(dtask_succs(rd, 0)[0] == 2);
+	CU_ASSERT_TRUE(dtask_succs(rd, 0)[1] == 1);
+
+	/* From a pipe, and from a file read past its start */
+	int fds[2];
+	CU_ASSERT_TRUE(pipe(fds) == 0);
+	file = fdopen(fds[1], "w");
+	CU_ASSERT_TRUE(dtask_write_bin(task, file));
+	fclose(file);
+	file = fdopen(fds[0], "r");
+	dtask_t *piped = dtask_read(file);
+	fclose(file);
+	CU_ASSERT_TRUE(piped && dtask_nnodes(piped) == 4);
+	dtask_free(piped);
+	file = tmpfile();
+	fputs("dag", file);
+	CU_ASSERT_TRUE(dtask_write_bin(task, file));
+	fseek(file, 3, SEEK_SET);
+	dtask_t *past = dtask_read(file);
+	fclose(file);
+	CU_ASSERT_TRUE(past && dtask_nnodes(past) == 4);
+	dtask_free(past);
+
+	/* Hash chains that loop or go through a removed node are refused */
+	uint32_t b = 0;
+	while (task->dt_hbucket[b] == DNID_NONE) {
+		b++;
+	}
+	dnid_t head = task->dt_hbucket[b];
+	dnid_t next = task->dt_hnext[head];
+	task->dt_hnext[head] = head;
+	CU_ASSERT_TRUE(dtask_bin_back(task) == NULL);
+	task->dt_hnext[head] = 4;
+	CU_ASSERT_TRUE(dtask_bin_back(task) == NULL);
+	task->dt_hnext[head] = next;
+	dtask_t *back = dtask_bin_back(task);
+	CU_ASSERT_TRUE(back != NULL);
+	dtask_free(back);
+
+	/* The mapped task grows like any other */
+	for (int i = 5; i < 40; i++) {
+		sprintf(buff, "n_%d", i);
+		dnode_t *node = dnode_alloc(buff);
+		dnode_set_threads(node, 1);
+		dnode_set_wcet_one(node, 1);
+		dtask_insert(rd, node);
+		dnode_t *prev = dtask_node_at(rd, dtask_name_id(rd, "n_3"));
+		dtask_insert_edge(rd, prev, node);
+		dnode_free(prev);
+		dnode_free(node);
+	}
+	CU_ASSERT_TRUE(dtask_nnodes(rd) == 39);
+	CU_ASSERT_TRUE(dtask_cpathlen(rd) == dtask_cpathlen(task) + 1);
+
+	for (int i = 0; i < 5; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(rd);
+	dtask_free(task);
+}
+
+/**
+ * Whether the object index walks the nodes of each object in id order
+ */
+static int
+dtask_objs_ordered(dtask_t *task) {
+	dnid_t id;
+	int max = -1;
+
+	dtask_foreach_id(task, id) {
+		if ((int) task->dt_object[id] > max) {
+			max = task->dt_object[id];
+		}
+	}
+	if (dtask_max_object(task) != max) {
+		return 0;
+	}
+	for (int o = 0; o <= max; o++) {
+		dnid_t count = 0;
+		dnid_t next = dtask_obj_first(task, o);
+		dtask_foreach_id(task, id) {
+			if (task->dt_object[id] != o) {
+				continue;
+			}
+			if (next != id) {
+				return 0;
+			}
+			next = dtask_obj_next(task, id);
+			count++;
+		}
+		if (next != DNID_NONE || dtask_obj_count(task, o) != count) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void
+dtask_objs(void) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+	dnode_t *nodes[90];
+
+	/* 30 nodes for each of the objects 0, 2 and 4 */
+	for (int i = 0; i < 90; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], 1);
+		dnode_set_object(nodes[i], 2 * (i % 3));
+		dtask_insert(task, nodes[i]);
+	}
+	CU_ASSERT_TRUE(dtask_count_cand(task) == 3 * 435);
+	CU_ASSERT_TRUE(dtask_objs_ordered(task));
+
+	/* The first node of each object with each of the others */
+	int ncand = 0, ok = 1;
+	cand_t *c = NULL;
+	while ((c = task_cand_next(task, c))) {
+		tint_t o = dnode_get_object(c->c_a);
+		ok = ok && dnode_has_name(c->c_a, nodes[o / 2]->dn_name);
+		ok = ok && dnode_get_object(c->c_b) == o;
+		ncand++;
+	}
+	CU_ASSERT_TRUE(ok);
+	CU_ASSERT_TRUE(ncand == 3 * 29);
+
+	/* Kept up to date on update, remove and insert */
+	dnode_set_object(nodes[3], 7);
+	dnode_update(nodes[3]);
+	dnode_set_object(nodes[87], 0);
+	dnode_update(nodes[87]);
+	dtask_remove(task, nodes[0]);
+	dtask_remove(task, nodes[89]);
+	CU_ASSERT_TRUE(dtask_objs_ordered(task));
+	CU_ASSERT_TRUE(dtask_max_object(task) == 7);
+	CU_ASSERT_TRUE(dtask_obj_first(task, 0) == 6);
+	dtask_remove(task, nodes[3]);
+	CU_ASSERT_TRUE(dtask_max_object(task) == 4);
+	dnode_t *node = dnode_alloc("n_90");
+	dnode_set_object(node, 2);
+	dtask_insert(task, node);
+	CU_ASSERT_TRUE(dtask_objs_ordered(task));
+	CU_ASSERT_TRUE(dtask_obj_count(task, 2) == 31);
+	dnode_free(node);
+
+	for (int i = 0; i < 90; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+/**
+ * Non-zero if both lists have the same candidates in the same order
+ */
+static int
+cand_list_same(cand_list_t *l1, cand_list_t *l2) {
+	cand_t *c1 = cand_first(l1), *c2 = cand_first(l2);
+
+	for (; c1 && c2; c1 = cand_next(c1), c2 = cand_next(c2)) {
+		if (!dnode_has_name(c1->c_a, c2->c_a->dn_name) ||
+		    !dnode_has_name(c1->c_b, c2->c_b->dn_name) ||
+		    c1->c_delta_c != c2->c_delta_c ||
+		    c1->c_delta_l != c2->c_delta_l) {
+			return 0;
+		}
+	}
+	return !c1 && !c2;
+}
+
+/**
+ * Layers of 4 nodes of 3 objects, fully connected to the next layer
+ */
+static dtask_t*
+dtask_layers(dnode_t *nodes[40]) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("test");
+
+	for (int i = 0; i < 40; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], 1);
+		dnode_set_wcet_one(nodes[i], 5 + (7 * i) % 13);
+		dnode_set_factor(nodes[i], 0.5);
+		dnode_set_object(nodes[i], i % 3);
+		dtask_insert(task, nodes[i]);
+	}
+	for (int i = 0; i < 36; i++) {
+		for (int j = 4 * (i / 4 + 1); j < 4 * (i / 4 + 2); j++) {
+			dtask_insert_edge(task, nodes[i], nodes[j]);
+		}
+	}
+	return task;
+}
+
+static void
+dtask_corder_jobs(void) {
+	dnode_t *nodes[40];
+	dtask_t *task = dtask_layers(nodes);
+
+	cand_list_t *(*order[3])(dtask_t *, int) = {
+		corder_arb, corder_maxb, corder_minp
+	};
+	for (int k = 0; k < 3; k++) {
+		cand_list_t *serial = order[k](task, 1);
+		CU_ASSERT_FALSE(cand_list_empty(serial));
+		for (int jobs = 2; jobs <= 5; jobs += 3) {
+			cand_list_t *par = order[k](task, jobs);
+			CU_ASSERT_TRUE(cand_list_same(serial, par));
+			cand_list_destroy(par);
+		}
+		cand_list_destroy(serial);
+	}
+	/* The task is untouched */
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 40);
+
+	for (int i = 0; i < 40; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+static void
+dtask_ctab(void) {
+	dnode_t *nodes[40];
+	dtask_t *task = dtask_layers(nodes);
+	ctab_t *ct = ctab_build(task, CTAB_DELTA_C | CTAB_DELTA_L, 2);
+	CU_ASSERT_TRUE(ct != NULL);
+	CU_ASSERT_TRUE(ct->ct_n > 2);
+
+	/* Sorted, with ties in the order of the task */
+	int ok = 1;
+	CU_ASSERT_TRUE(ctab_sort(ct, CORDER_MAXB));
+	CU_ASSERT_TRUE(ct->ct_norder == ct->ct_n);
+	for (uint32_t i = 1; i < ct->ct_n; i++) {
+		uint32_t p = ct->ct_order[i - 1], c = ct->ct_order[i];
+		ok = ok && (ct->ct_delta_c[p] > ct->ct_delta_c[c] ||
+		    (ct->ct_delta_c[p] == ct->ct_delta_c[c] && p < c));
+	}
+	CU_ASSERT_TRUE(ok);
+
+	/* The top k are the first k of the sort */
+	uint32_t *sorted = malloc(ct->ct_n * sizeof(uint32_t));
+	CU_ASSERT_TRUE(ctab_sort(ct, CORDER_MINP));
+	memcpy(sorted, ct->ct_order, ct->ct_n * sizeof(uint32_t));
+	for (uint32_t k = 1; k <= ct->ct_n + 1; k++) {
+		CU_ASSERT_TRUE(ctab_top(ct, CORDER_MINP, k));
+		ok = ok && ct->ct_norder == (k < ct->ct_n ? k : ct->ct_n);
+		ok = ok && !memcmp(sorted, ct->ct_order,
+		    ct->ct_norder * sizeof(uint32_t));
+	}
+	CU_ASSERT_TRUE(ok);
+	free(sorted);
+
+	/* The list has the same candidates as corder_minp() */
+	ctab_t *lt = ctab_build(task, CTAB_DELTA_L, 1);
+	CU_ASSERT_TRUE(ctab_sort(lt, CORDER_MINP));
+	cand_list_t *list = ctab_list(lt);
+	cand_list_t *minp = corder_minp(task, 1);
+	CU_ASSERT_TRUE(cand_list_same(list, minp));
+	cand_list_destroy(list);
+	cand_list_destroy(minp);
+	ctab_free(lt);
+
+	/* Arbitrary is the last found first */
+	CU_ASSERT_TRUE(ctab_sort(ct, CORDER_ARB));
+	CU_ASSERT_TRUE(ct->ct_order[0] == ct->ct_n - 1);
+	CU_ASSERT_TRUE(ct->ct_order[ct->ct_n - 1] == 0);
+	ctab_free(ct);
+
+	for (int i = 0; i < 40; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+static void
+dtask_collapse_all(void) {
+	dnode_t *nodes[40];
+	dtask_t *task = dtask_layers(nodes);
+	dcollapse_stat_t stat;
+
+	task->dt_deadline = task->dt_period = 400;
+	float_t m = dtask_coresf(task);
+	int n = dag_collapse_all(task, &stat);
+	CU_ASSERT_TRUE(n > 0);
+	CU_ASSERT_TRUE(stat.dcs_collapses == n);
+	CU_ASSERT_TRUE(task->dt_collapsed == n);
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 40 - n);
+
+	/* Fewer cores, within the deadline */
+	CU_ASSERT_TRUE(stat.dcs_cores < m);
+	CU_ASSERT_TRUE(stat.dcs_cores == dtask_coresf(task));
+	CU_ASSERT_TRUE(stat.dcs_cpathlen == dtask_cpathlen(task));
+	CU_ASSERT_TRUE(stat.dcs_workload == dtask_workload(task));
+	CU_ASSERT_TRUE(stat.dcs_cpathlen <= task->dt_deadline);
+
+	/* Nothing left to gain from the candidates of the first nodes */
+	cand_t *c = NULL;
+	while ((c = task_cand_next(task, c))) {
+		if (!dag_can_collapse(c->c_a, c->c_b)) {
+			continue;
+		}
+		dtask_t *copy = dtask_copy(task);
+		dnode_t *a = dtask_name_search(copy, c->c_a->dn_name);
+		dnode_t *b = dtask_name_search(copy, c->c_b->dn_name);
+		dag_collapse(a, b);
+		CU_ASSERT_FALSE(dtask_cpathlen(copy) <= task->dt_deadline &&
+		    dtask_coresf(copy) < stat.dcs_cores);
+		dnode_free(a);
+		dnode_free(b);
+		dtask_free(copy);
+	}
+
+	for (int i = 0; i < 40; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
+
+/**
+ * Next number of a linear congruential generator, the same everywhere
+ */
+static uint32_t
+dtask_lcg(uint32_t *seed) {
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7fff;
+}
+
+/**
+ * A task of n nodes of up to nobj objects with random WCETs and edges
+ */
+static dtask_t*
+dtask_random(uint32_t seed, int n, int nobj) {
+	char buff[DT_NAMELEN];
+	dtask_t *task = dtask_alloc("random");
+	dnode_t **nodes = calloc(n, sizeof(dnode_t *));
+
+	for (int i = 0; i < n; i++) {
+		sprintf(buff, "n_%d", i);
+		nodes[i] = dnode_alloc(buff);
+		dnode_set_threads(nodes[i], 1 + dtask_lcg(&seed) % 2);
+		dnode_set_wcet_one(nodes[i], 1 + dtask_lcg(&seed) % 20);
+		dnode_set_factor(nodes[i], 0.3 + (dtask_lcg(&seed) % 7) / 10.0);
+		dnode_set_object(nodes[i], dtask_lcg(&seed) % nobj);
+		dtask_insert(task, nodes[i]);
+	}
+	for (int i = 0; i < n; i++) {
+		for (int j = i + 1; j < n; j++) {
+			if (dtask_lcg(&seed) % 100 < 8) {
+				dtask_insert_edge(task, nodes[i], nodes[j]);
+			}
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		dnode_free(nodes[i]);
+	}
+	free(nodes);
+
+	tint_t L = dtask_cpathlen(task);
+	task->dt_deadline = task->dt_period = L + dtask_lcg(&seed) % (2 * L + 1);
+	return task;
+}
+
+/**
+ * The greedy collapse only stops when no pair of the task, scored
+ * against the task as it ends up, decreases the cores
+ */
+static void
+dtask_collapse_stop(void) {
+	int ok = 1;
+
+	for (uint32_t seed = 1; seed <= 40; seed++) {
+		dtask_t *task = dtask_random(seed, 10 + seed % 40, 1 + seed % 5);
+		dcollapse_stat_t stat;
+		CU_ASSERT_TRUE(dag_collapse_all(task, &stat) >= 0);
+
+		for (dnid_t a = 0; a < task->dt_nids; a++) {
+			for (dnid_t b = a + 1; b < task->dt_nids; b++) {
+				if (!dtask_node_live(task, a) ||
+				    !dtask_node_live(task, b)) {
+					continue;
+				}
+				dnode_t *na = dtask_node_at(task, a);
+				dnode_t *nb = dtask_node_at(task, b);
+				if (dag_can_collapse(na, nb)) {
+					dtask_t *copy = dtask_copy(task);
+					dnode_t *ca = dtask_name_search(copy,
+					    na->dn_name);
+					dnode_t *cb = dtask_name_search(copy,
+					    nb->dn_name);
+					dag_collapse(ca, cb);
+					ok = ok && !(dtask_cpathlen(copy) <=
+					    task->dt_deadline &&
+					    dtask_coresf(copy) < stat.dcs_cores);
+					dnode_free(ca);
+					dnode_free(cb);
+					dtask_free(copy);
+				}
+				dnode_free(na);
+				dnode_free(nb);
+			}
+		}
+		dtask_free(task);
+	}
+	CU_ASSERT_TRUE(ok);
+}
+
+/**
+ * Collapses greedily by collapsing every pair in a copy of the task,
+ * the largest decrease of the cores first and ties to the lower ids
+ */
+static void
+dtask_greedy_exhaustive(dtask_t *task) {
+	for (;;) {
+		float_t m = dtask_coresf(task);
+		float_t best = 0;
+		dnid_t ba = DNID_NONE, bb = DNID_NONE;
+
+		for (dnid_t a = 0; a < task->dt_nids; a++) {
+			for (dnid_t b = a + 1; b < task->dt_nids; b++) {
+				if (!dtask_node_live(task, a) ||
+				    !dtask_node_live(task, b)) {
+					continue;
+				}
+				dnode_t *na = dtask_node_at(task, a);
+				dnode_t *nb = dtask_node_at(task, b);
+				if (dag_can_collapse(na, nb)) {
+					dtask_t *copy = dtask_copy(task);
+					dnode_t *ca = dtask_name_search(copy,
+					    na->dn_name);
+					dnode_t *cb = dtask_name_search(copy,
+					    nb->dn_name);
+					dag_collapse(ca, cb);
+					float_t gain = m - dtask_coresf(copy);
+					if (dtask_cpathlen(copy) <=
+					    task->dt_deadline && gain > best) {
+						best = gain;
+						ba = a;
+						bb = b;
+					}
+					dnode_free(ca);
+					dnode_free(cb);
+					dtask_free(copy);
+				}
+				dnode_free(na);
+				dnode_free(nb);
+			}
+		}
+		if (ba == DNID_NONE) {
+			return;
+		}
+		dnode_t *a = dtask_node_at(task, ba);
+		dnode_t *b = dtask_node_at(task, bb);
+		dag_collapse(a, b);
+		task->dt_collapsed++;
+		dnode_free(a);
+		dnode_free(b);
+	}
+}
+
+/**
+ * The greedy collapse takes the same candidates, in the same order, as
+ * trying every pair after each collapse
+ */
+static void
+dtask_collapse_exhaustive(void) {
+	int same = 1;
+
+	for (uint32_t seed = 1; seed <= 60; seed++) {
+		int n = 10 + seed % 16;
+		int nobj = 1 + seed % 4;
+		dtask_t *task = dtask_random(seed, n, nobj);
+		dtask_t *ref = dtask_random(seed, n, nobj);
+
+		CU_ASSERT_TRUE(dag_collapse_all(task, NULL) >= 0);
+		dtask_greedy_exhaustive(ref);
+
+		/* The collapsed nodes get their ids in collapse order */
+		same = same && task->dt_nids == ref->dt_nids &&
+		    task->dt_collapsed == ref->dt_collapsed;
+		for (dnid_t id = 0; same && id < task->dt_nids; id++) {
+			same = dtask_node_live(task, id) ==
+			    dtask_node_live(ref, id) &&
+			    (!dtask_node_live(task, id) ||
+			    !strcmp(task->dt_nname[id], ref->dt_nname[id]));
+		}
+		dtask_free(task);
+		dtask_free(ref);
+	}
+	CU_ASSERT_TRUE(same);
+}
+
+/**
+ * The task as written by dtask_write(), must be free()'d
+ */
+static char *
+dtask_text(dtask_t *task) {
+	char *text = NULL;
+	size_t len;
+	FILE *file = open_memstream(&text, &len);
+
+	dtask_write(task, file);
+	fclose(file);
+	return text;
+}
+
+static void
+dtask_journal(void) {
+	dnode_t *nodes[40];
+	dtask_t *task = dtask_layers(nodes);
+	task->dt_deadline = task->dt_period = 400;
+
+	char *before = dtask_text(task);
+	tint_t l = dtask_cpathlen(task);
+	tint_t c = dtask_workload(task);
+	dnid_t nids = task->dt_nids;
+	CU_ASSERT_FALSE(dtask_commit(task));
+	CU_ASSERT_FALSE(dtask_rollback(task));
+
+	/* Collapse, remove an edge and update a node, then undo them */
+	CU_ASSERT_TRUE(dtask_begin(task));
+	CU_ASSERT_FALSE(dtask_begin(task));
+	dnode_t *a = dtask_name_search(task, "n_5");
+	dnode_t *b = dtask_name_search(task, "n_8");
+	CU_ASSERT_TRUE(dag_can_collapse(a, b));
+	dag_collapse(a, b);
+	dtask_remove_edge(task, nodes[0], nodes[4]);
+	dnode_set_threads(nodes[20], 3);
+	dnode_set_object(nodes[20], 5);
+	dnode_update(nodes[20]);
+	dtask_remove(task, nodes[39]);
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 38);
+	CU_ASSERT_TRUE(dtask_max_object(task) == 5);
+	dtask_update(task);
+	CU_ASSERT_TRUE(dtask_rollback(task));
+
+	char *after = dtask_text(task);
+	CU_ASSERT_TRUE(strcmp(before, after) == 0);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == l);
+	CU_ASSERT_TRUE(dtask_workload(task) == c);
+	CU_ASSERT_TRUE(dtask_nnodes(task) == 40);
+	CU_ASSERT_TRUE(task->dt_nids == nids);
+	CU_ASSERT_TRUE(dtask_max_object(task) == 2);
+	CU_ASSERT_TRUE(dtask_objs_ordered(task));
+	free(after);
+
+	/* Committed, the same as without a transaction */
+	dtask_t *copy = dtask_copy(task);
+	dnode_t *ca = dtask_name_search(copy, "n_5");
+	dnode_t *cb = dtask_name_search(copy, "n_8");
+	dag_collapse(ca, cb);
+	/* Collapsed nodes are out of the task, even after the rollback */
+	dnode_free(a);
+	dnode_free(b);
+	a = dtask_name_search(task, "n_5");
+	b = dtask_name_search(task, "n_8");
+	CU_ASSERT_TRUE(dtask_begin(task));
+	dag_collapse(a, b);
+	CU_ASSERT_TRUE(dtask_commit(task));
+	char *ctext = dtask_text(copy);
+	after = dtask_text(task);
+	CU_ASSERT_TRUE(strcmp(ctext, after) == 0);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == dtask_cpathlen(copy));
+	free(ctext);
+	free(after);
+
+	/* And back again from there */
+	dnode_t *cands[2] = { dtask_name_search(task, "n_5,n_8"),
+			      dtask_name_search(task, "n_11") };
+	before = (free(before), dtask_text(task));
+	CU_ASSERT_TRUE(dtask_begin(task));
+	CU_ASSERT_TRUE(dag_can_collapse(cands[0], cands[1]));
+	dag_collapse(cands[0], cands[1]);
+	CU_ASSERT_TRUE(dtask_rollback(task));
+	after = dtask_text(task);
+	CU_ASSERT_TRUE(strcmp(before, after) == 0);
+	CU_ASSERT_TRUE(dtask_cpathlen(task) == dtask_cpathlen(copy));
+	free(after);
+	free(before);
+
+	dnode_free(cands[0]);
+	dnode_free(cands[1]);
+	dnode_free(a);
+	dnode_free(b);
+	dnode_free(ca);
+	dnode_free(cb);
+	dtask_free(copy);
+	for (int i = 0; i < 40; i++) {
+		dnode_free(nodes[i]);
+	}
+	dtask_free(task);
+}
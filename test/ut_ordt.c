@@ -17,6 +17,7 @@ static void ordt_basic_add(void);
 static void ordt_add_two(void);
 static void ordt_clear(void);
 static void ordt_inorder(void);
+static void ordt_bounds(void);
 
 CU_TestInfo ordt_tests[] = {
     { "Allocate and Deallocate", ordt_allocate},
@@ -25,6 +26,7 @@ CU_TestInfo ordt_tests[] = {
     { "Add Two", ordt_add_two},
     { "Clearing the Tree", ordt_clear},
     { "Inorder Walk", ordt_inorder},    
+    { "Bounds over Many Chunks", ordt_bounds},
     CU_TEST_INFO_NULL
 };
 
@@ -36,7 +38,7 @@ ordt_allocate(void) {
 	ot_t *tree = ot_alloc();
 	CU_ASSERT_TRUE(tree != NULL);
 	CU_ASSERT_TRUE(tree->ot_count == 0);
-	CU_ASSERT_TRUE(tree->ot_root == NULL);
+	CU_ASSERT_TRUE(tree->ot_nchunks == 0);
 	ot_free(tree);
 }
 
@@ -93,7 +95,7 @@ ordt_add_two(void) {
 	CU_ASSERT_TRUE(e == 0);
 	CU_ASSERT_TRUE(tree->ot_count == 1);
 
-	e = ot_ins(tree, one);
+	e = ot_ins(tree, two);
 	CU_ASSERT_TRUE(e == 0);
 	CU_ASSERT_TRUE(tree->ot_count == 2);
 
@@ -132,21 +134,6 @@ ordt_clear(void) {
 	ot_free(tree);
 }
 
-static void
-print_inorder(const void *cookie, const VISIT which, const int depth) {
-	ot_elem_t *elem = *(ot_elem_t**) cookie;
-
-	switch (which) {
-	case postorder:
-		break;
-	default:
-		return;
-	}
-
-	printf("%lu ", elem->ote_deadline);
-	       
-}
-
 static void
 ordt_inorder(void) {
 	ot_t *tree = ot_alloc();
@@ -159,10 +146,70 @@ ordt_inorder(void) {
 		CU_ASSERT_TRUE(e == 0);
 	}
 
-	twalk(tree->ot_root, print_inorder);
-	printf("\n");
+	ot_iter_t it;
+	ot_elem_t *elem;
+	tint_t expect = 0;
+	ot_foreach(tree, &it, elem) {
+		CU_ASSERT_EQUAL(elem->ote_deadline, expect);
+		expect += 5;
+	}
+	CU_ASSERT_EQUAL(expect, 50);
 	
 	ot_empty(tree);
 	/* Should be safe */
 	ot_free(tree);
 }
+
+/**
+ * Enough deadlines, in scrambled order, to split and fold chunks, with
+ * the bounds checked against the arithmetic
+ */
+static void
+ordt_bounds(void) {
+	ot_t *tree = ot_alloc();
+	ot_elem_t *elems[1000];
+	ot_iter_t it;
+	ot_elem_t *elem;
+	int ok = 1;
+
+	/* Deadlines 3 * k, inserted in the order of 7 * k mod 1000 */
+	for (int k = 0; k < 1000; k++) {
+		elems[k] = ote_alloc();
+		elems[k]->ote_deadline = 3 * ((7 * k) % 1000);
+		ok = ok && ot_ins(tree, elems[k]) == 0;
+	}
+	CU_ASSERT_TRUE(ok);
+	CU_ASSERT_EQUAL(tree->ot_count, 1000);
+	CU_ASSERT_TRUE(tree->ot_nchunks > 1);
+
+	for (tint_t d = 0; d < 3010; d++) {
+		tint_t lb = (d + 2) / 3 * 3, ub = d / 3 * 3 + 3;
+		elem = ot_lower_bound(tree, d, &it);
+		ok = ok && (lb < 3000 ? elem && elem->ote_deadline == lb : !elem);
+		elem = ot_upper_bound(tree, d, &it);
+		ok = ok && (ub < 3000 ? elem && elem->ote_deadline == ub : !elem);
+		elem = ot_find(tree, d);
+		ok = ok && (d % 3 == 0 && d < 3000 ? elem != NULL : elem == NULL);
+	}
+	CU_ASSERT_TRUE(ok);
+
+	/* Remove all but every tenth deadline, the rest stays in order */
+	for (int k = 0; k < 1000; k++) {
+		if (elems[k]->ote_deadline % 30 != 0) {
+			ok = ok && ot_rem(tree, elems[k]) == 0;
+			ote_free(elems[k]);
+		}
+	}
+	CU_ASSERT_TRUE(ok);
+	CU_ASSERT_EQUAL(tree->ot_count, 100);
+	tint_t expect = 0;
+	ot_foreach(tree, &it, elem) {
+		ok = ok && elem->ote_deadline == expect;
+		expect += 30;
+	}
+	CU_ASSERT_TRUE(ok);
+	CU_ASSERT_EQUAL(expect, 3000);
+
+	ot_empty(tree);
+	ot_free(tree);
+}
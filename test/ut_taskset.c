@@ -5,12 +5,21 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <libconfig.h>
+#include <pthread.h>
 
 #include "taskset.h"
+#include "taskset-demand.h"
+#include "maxchunks.h"
+#include "qpa.h"
 
 /* Individual tests */
 static void t_allocate(void);
 static void t_star(void);
+static void t_demand_ctx(void);
+static void t_qpa(void);
+static void t_maxchunks_threads(void);
+static void t_string_threads(void);
+static void t_array(void);
 
 static void t_add_tasks_8866();
 
@@ -20,6 +29,11 @@ int taskset_cleanup(void) { return 0; }
 CU_TestInfo taskset_tests[] = {
     { "Allocate and deallocate", t_allocate},
     { "T*", t_star},
+    { "Demand Context", t_demand_ctx},
+    { "QPA", t_qpa},
+    { "Concurrent maxchunks", t_maxchunks_threads},
+    { "Concurrent ts_string", t_string_threads},
+    { "Array set", t_array},
     CU_TEST_INFO_NULL
 };
 
@@ -70,3 +84,267 @@ t_add_tasks_8866(task_set_t *ts) {
 	t->wcet(1) = 50;
 	ts_add(ts, t);
 }
+
+/**
+ * Every kernel of the demand context must agree with ts_demand(),
+ * below and beyond the bound where the vector kernels are exact
+ */
+static void
+t_demand_ctx(void) {
+	task_set_t *ts = ts_alloc();
+	tint_t t[64];
+	int64_t demand[64];
+
+	for (int i = 0; i < 21; i++) {
+		task_t *task = task_alloc(50 + (37 * i) % 211, 20 + (13 * i) % 97,
+		    1 + i % 3);
+		for (int m = 1; m <= task->t_threads; m++) {
+			task->wcet(m) = 1 + (7 * i + m) % 19;
+		}
+		ts_add(ts, task);
+	}
+
+	for (int isa = TSD_SCALAR; isa <= TSD_AVX512; isa++) {
+		tsd_t *tsd = tsd_alloc_isa(ts, isa);
+		int same = 1;
+
+		CU_ASSERT_TRUE(tsd != NULL);
+		CU_ASSERT_TRUE(tsd->tsd_isa <= isa);
+		for (tint_t d = 0; d < 5000; d++) {
+			same = same && tsd_demand(tsd, d) == ts_demand(ts, d);
+		}
+		for (int j = 0; j < 64; j++) {
+			t[j] = tsd->tsd_tlim - 32 + j;
+		}
+		tsd_demand_block(tsd, t, demand, 64);
+		for (int j = 0; j < 64; j++) {
+			same = same && demand[j] == ts_demand(ts, t[j]);
+		}
+		CU_ASSERT_TRUE(same);
+		tsd_free(tsd);
+	}
+
+	ts_destroy(ts);
+}
+
+/**
+ * QPA must agree with the exhaustive test of max_chunks() on feasible
+ * and infeasible sets alike
+ */
+static void
+t_qpa(void) {
+	uint32_t seed = 12345;
+	int same = 1, feasible = 0, infeasible = 0;
+
+	for (int k = 0; k < 200; k++) {
+		task_set_t *ts = ts_alloc();
+		for (int i = 0; i < 2 + k % 7; i++) {
+			seed = seed * 1103515245 + 12345;
+			tint_t p = 20 + (seed >> 8) % 400;
+			seed = seed * 1103515245 + 12345;
+			tint_t d = p / 4 + (seed >> 8) % (p - p / 4 + 1);
+			seed = seed * 1103515245 + 12345;
+			task_t *task = task_alloc(p, d, 1);
+			task->wcet(1) = 1 + (seed >> 8) % (p / (2 + k % 7) + 4);
+			ts_add(ts, task);
+		}
+		if (ts_util(ts) < 1) {
+			int q = qpa(ts, NULL);
+			int m = max_chunks(ts);
+			same = same && q == m;
+			feasible += q == 0;
+			infeasible += q == 1;
+		}
+		ts_destroy(ts);
+	}
+	CU_ASSERT_TRUE(same);
+	CU_ASSERT_TRUE(feasible > 0);
+	CU_ASSERT_TRUE(infeasible > 0);
+}
+
+#define MC_THREADS 8
+
+typedef struct {
+	task_set_t *mc_ts;
+	int mc_feas;
+	int mc_same;		/**< Every run assigned the same chunks */
+} mc_job_t;
+
+/**
+ * A feasible set with distinct chunk sizes per seed
+ */
+static task_set_t *
+mc_task_set(int seed) {
+	task_set_t *ts = ts_alloc();
+	for (int i = 0; i < 6; i++) {
+		tint_t p = 40 + 11 * i + seed;
+		task_t *task = task_alloc(p, p - 3 - (i + seed) % 7, 1);
+		task->wcet(1) = 2 + (i * 5 + seed) % 6;
+		ts_add(ts, task);
+	}
+	return ts;
+}
+
+static void *
+mc_run(void *arg) {
+	mc_job_t *job = arg;
+	tint_t chunks[6];
+	int i;
+	task_link_t *cookie;
+
+	job->mc_same = 1;
+	for (int r = 0; r < 50; r++) {
+		int feas = maxchunks_dbg(job->mc_ts, NULL);
+		i = 0;
+		for (cookie = ts_first(job->mc_ts); cookie;
+		    cookie = ts_next(job->mc_ts, cookie), i++) {
+			if (r == 0) {
+				chunks[i] = ts_task(cookie)->t_chunk;
+			} else if (chunks[i] != ts_task(cookie)->t_chunk) {
+				job->mc_same = 0;
+			}
+		}
+		if (r == 0) {
+			job->mc_feas = feas;
+		} else if (feas != job->mc_feas) {
+			job->mc_same = 0;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * maxchunks_dbg() on different task sets from several threads at once
+ * gives what it gives on each set alone
+ */
+static void
+t_maxchunks_threads(void) {
+	mc_job_t jobs[MC_THREADS];
+	pthread_t threads[MC_THREADS];
+	int ok = 1;
+
+	for (int k = 0; k < MC_THREADS; k++) {
+		jobs[k].mc_ts = mc_task_set(k);
+		CU_ASSERT_EQUAL(pthread_create(&threads[k], NULL, mc_run,
+		    &jobs[k]), 0);
+	}
+	for (int k = 0; k < MC_THREADS; k++) {
+		pthread_join(threads[k], NULL);
+		ok = ok && jobs[k].mc_same;
+	}
+	CU_ASSERT_TRUE(ok);
+
+	/* And the same as a lone call on a fresh copy */
+	for (int k = 0; k < MC_THREADS; k++) {
+		task_set_t *ts = mc_task_set(k);
+		task_link_t *a, *b;
+		ok = ok && maxchunks_dbg(ts, NULL) == jobs[k].mc_feas;
+		for (a = ts_first(ts), b = ts_first(jobs[k].mc_ts); a && b;
+		    a = ts_next(ts, a), b = ts_next(jobs[k].mc_ts, b)) {
+			ok = ok && ts_task(a)->t_chunk == ts_task(b)->t_chunk;
+		}
+		ts_destroy(ts);
+		ts_destroy(jobs[k].mc_ts);
+	}
+	CU_ASSERT_TRUE(ok);
+}
+
+typedef struct {
+	task_set_t *st_ts;
+	char *st_expect;	/**< ts_string() of the set on its own */
+	int st_same;		/**< Every call rendered st_expect */
+} st_job_t;
+
+static void *
+st_run(void *arg) {
+	st_job_t *job = arg;
+
+	job->st_same = 1;
+	for (int r = 0; r < 200; r++) {
+		char *s = ts_string(job->st_ts);
+		job->st_same = job->st_same && !strcmp(s, job->st_expect);
+		free(s);
+	}
+	return NULL;
+}
+
+/**
+ * ts_string() from several threads at once, each thread must see its
+ * own set rendered and nothing of the others
+ */
+static void
+t_string_threads(void) {
+	st_job_t jobs[MC_THREADS];
+	pthread_t threads[MC_THREADS];
+	int ok = 1;
+
+	for (int k = 0; k < MC_THREADS; k++) {
+		jobs[k].st_ts = mc_task_set(k);
+		jobs[k].st_expect = ts_string(jobs[k].st_ts);
+	}
+	for (int k = 0; k < MC_THREADS; k++) {
+		CU_ASSERT_EQUAL(pthread_create(&threads[k], NULL, st_run,
+		    &jobs[k]), 0);
+	}
+	for (int k = 0; k < MC_THREADS; k++) {
+		pthread_join(threads[k], NULL);
+		ok = ok && jobs[k].st_same;
+		free(jobs[k].st_expect);
+		ts_destroy(jobs[k].st_ts);
+	}
+	CU_ASSERT_TRUE(ok);
+}
+
+#define AR_TASKS 1000
+
+/**
+ * Adds, indexes, removes and moves tasks across the growth of the set,
+ * order must be kept throughout
+ */
+static void
+t_array(void) {
+	task_set_t *ts = ts_alloc();
+	task_set_t *dst = ts_alloc();
+	task_set_t *div;
+	task_t *tasks[AR_TASKS];
+	int ordered = 1;
+
+	CU_ASSERT_EQUAL(ts_count(ts), 0);
+	CU_ASSERT_TRUE(ts_first(ts) == NULL);
+	CU_ASSERT_TRUE(ts_last(ts) == NULL);
+	for (int i = 0; i < AR_TASKS; i++) {
+		tasks[i] = task_alloc(100 + i, 50 + i, 1 + i % 3);
+		for (int m = 1; m <= tasks[i]->t_threads; m++) {
+			tasks[i]->wcet(m) = 10;
+		}
+		CU_ASSERT_TRUE(ts_add(ts, tasks[i]) != NULL);
+	}
+	CU_ASSERT_EQUAL(ts_count(ts), AR_TASKS);
+	for (int i = 0; i < AR_TASKS; i++) {
+		ordered = ordered && ts_at(ts, i) == tasks[i];
+	}
+	CU_ASSERT_TRUE(ordered);
+	CU_ASSERT_TRUE(ts_task(ts_last(ts)) == tasks[AR_TASKS - 1]);
+
+	/* 1 + i % 3 threads divided into single threads */
+	div = ts_divide_set(ts, 1);
+	CU_ASSERT_TRUE(div != NULL);
+	CU_ASSERT_EQUAL(ts_count(div), 334 * 1 + 333 * 2 + 333 * 3);
+	ts_destroy(div);
+
+	/* Removing from the middle keeps the remaining order */
+	CU_ASSERT_TRUE(ts_rem(ts, ts_find(ts, tasks[10])) == tasks[10]);
+	CU_ASSERT_EQUAL(ts_count(ts), AR_TASKS - 1);
+	CU_ASSERT_TRUE(ts_at(ts, 9) == tasks[9]);
+	CU_ASSERT_TRUE(ts_at(ts, 10) == tasks[11]);
+	CU_ASSERT_TRUE(ts_find(ts, tasks[10]) == NULL);
+	task_free(tasks[10]);
+
+	CU_ASSERT_EQUAL(ts_move(ts, dst), AR_TASKS - 1);
+	CU_ASSERT_EQUAL(ts_count(ts), 0);
+	CU_ASSERT_EQUAL(ts_count(dst), AR_TASKS - 1);
+	CU_ASSERT_TRUE(ts_at(dst, AR_TASKS - 2) == tasks[AR_TASKS - 1]);
+
+	ts_free(ts);
+	ts_destroy(dst);
+}